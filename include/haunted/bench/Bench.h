@@ -0,0 +1,149 @@
+#ifndef HAUNTED_BENCH_BENCH_H_
+#define HAUNTED_BENCH_BENCH_H_
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Haunted::Bench {
+	/** Summary statistics of a benchmark's repetitions, in nanoseconds per operation. */
+	struct Stats {
+		double mean = 0, median = 0, stddev = 0, min = 0, max = 0;
+	};
+
+	struct Result {
+		std::string name;
+
+		/** The number of operations each call of the benchmark function performs. */
+		size_t operations = 1;
+
+		/** The number of calls timed together in each repetition. */
+		size_t batch = 1;
+
+		size_t repetitions = 0;
+		Stats nanos;
+
+		double operationsPerSecond() const { return nanos.mean == 0? 0 : 1e9 / nanos.mean; }
+	};
+
+	/** What an end-to-end scenario cost. Times are medians over the repetitions; the counts come from the last
+	 *  repetition, since a scripted scenario does the same work every time. */
+	struct ScenarioResult {
+		std::string name;
+		size_t repetitions = 0;
+		double cpuMillis = 0, wallMillis = 0;
+
+		/** The number of frames the scenario flushed to the terminal. */
+		size_t frames = 0;
+
+		/** The number of bytes the scenario wrote to the terminal. */
+		size_t bytes = 0;
+
+		size_t allocations = 0, allocatedBytes = 0;
+
+		/** Starts measuring. A scenario calls this once its setup is done, so that the setup isn't counted. */
+		void begin();
+
+		/** Stops measuring and fills in the times and allocations since begin(). A scenario calls this before its
+		 *  teardown; if it doesn't, the measurement ends when it returns. */
+		void end();
+
+		private:
+			size_t startAllocations = 0, startAllocated = 0;
+			double startCPU = 0;
+			std::chrono::steady_clock::time_point startWall;
+			bool measuring = false;
+
+			friend class Runner;
+	};
+
+	/**
+	 * Runs benchmarks and collects their results. Each benchmark is first called repeatedly to find how many calls
+	 * take at least the minimum time, and that many calls are then timed together for each warm-up run and each
+	 * repetition. Only the repetitions count toward the results.
+	 *
+	 * A benchmark function may mutate state as long as the cost of a call stays steady. If the state has to be put
+	 * back between repetitions, pass a setup function, which runs before each timed batch without being timed.
+	 */
+	class Runner {
+		public:
+			using Function = std::function<void()>;
+
+			size_t warmups = 2;
+			size_t repetitions = 10;
+
+			/** The minimum time each repetition should take. */
+			std::chrono::nanoseconds minTime = std::chrono::milliseconds(10);
+
+			/** Only benchmarks whose names contain this string are run. */
+			std::string filter;
+
+			/** Where progress is reported as each benchmark finishes, if anywhere. */
+			std::ostream *progress = nullptr;
+
+		private:
+			std::vector<Result> results;
+			std::vector<ScenarioResult> scenarioResults;
+			std::vector<std::string> skippedNames;
+
+			/** Times a batch of calls and returns the elapsed time in nanoseconds. */
+			static double timeBatch(const Function &, size_t batch);
+
+			static Stats summarize(std::vector<double> samples);
+
+		public:
+			/** Returns whether a benchmark with a given name passes the filter. */
+			bool selected(const std::string &name) const;
+
+			/** Measures a function that performs a given number of operations per call. Does nothing if the name
+			 *  doesn't pass the filter. */
+			void run(const std::string &name, const Function &, size_t operations = 1, const Function &setup = {});
+
+			/** Runs a scripted scenario repeatedly and measures its CPU time, wall time and allocations between the
+			 *  calls it makes to begin() and end() on the result it's given. The function fills in the frames and
+			 *  bytes of the result itself. Does nothing if the name doesn't pass the filter. */
+			void scenario(const std::string &name, const std::function<void(ScenarioResult &)> &);
+
+			/** Records that a benchmark couldn't be run in this build and reports why. Does nothing if the name
+			 *  doesn't pass the filter. */
+			void skip(const std::string &name, const std::string &reason);
+
+			const std::vector<Result> & getResults() const { return results; }
+			const std::vector<ScenarioResult> & getScenarioResults() const { return scenarioResults; }
+
+			/** Writes the results as a JSON object with the run's settings, an array of results, an array of scenario
+			 *  results and an array of the names of skipped benchmarks. */
+			void writeJSON(std::ostream &) const;
+
+			/** Writes the results as an aligned table for reading. */
+			void writeTable(std::ostream &) const;
+	};
+
+	/** Returns the number of allocations made with operator new since the program started. Only the benchmark
+	 *  binary counts them. */
+	size_t allocationCount();
+
+	/** Returns the number of bytes allocated with operator new since the program started. */
+	size_t allocatedBytes();
+
+	/** Returns the number of allocations made with operator new that haven't been freed yet. */
+	size_t liveAllocations();
+
+	/** Keeps the compiler from optimizing away the computation of a value. */
+	template <typename T>
+	inline void keep(const T &value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	void textbox(Runner &);
+	void textLine(Runner &);
+	void ustring(Runner &);
+	void parsing(Runner &);
+	void coloration(Runner &);
+	void keys(Runner &);
+	void scenarios(Runner &);
+}
+
+#endif
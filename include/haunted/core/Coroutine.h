@@ -0,0 +1,223 @@
+#ifndef HAUNTED_CORE_COROUTINE_H_
+#define HAUNTED_CORE_COROUTINE_H_
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Haunted {
+	template <typename T>
+	class Task;
+
+	void spawn(Task<void>);
+
+	namespace Detail {
+		template <typename T>
+		class TaskPromise;
+
+		/** The parts of a task's promise that don't depend on its result type. */
+		class TaskPromiseBase {
+			template <typename T>
+			friend class Haunted::Task;
+			friend void Haunted::spawn(Task<void>);
+
+			protected:
+				/** The coroutine awaiting this one, if any. */
+				std::coroutine_handle<> continuation;
+
+				/** Whether the task was spawned. Spawned tasks destroy themselves when they finish. */
+				bool detached = false;
+
+				std::exception_ptr error;
+
+			public:
+				struct FinalAwaiter {
+					bool await_ready() const noexcept { return false; }
+
+					template <typename P>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+						TaskPromiseBase &promise = handle.promise();
+						if (promise.continuation)
+							return promise.continuation;
+						if (promise.detached)
+							handle.destroy();
+						return std::noop_coroutine();
+					}
+
+					void await_resume() const noexcept {}
+				};
+
+				std::suspend_always initial_suspend() const noexcept { return {}; }
+				FinalAwaiter final_suspend() const noexcept { return {}; }
+
+				void unhandled_exception() {
+					// Nothing is waiting to receive the exception from a spawned task. Letting it escape would leave
+					// the frame suspended at its final point with nothing to destroy it, so treat it the way an
+					// exception escaping a std::thread is treated.
+					if (detached)
+						std::terminate();
+					error = std::current_exception();
+				}
+		};
+
+		template <typename T>
+		class TaskPromise: public TaskPromiseBase {
+			template <typename>
+			friend class Haunted::Task;
+
+			private:
+				std::optional<T> value;
+
+			public:
+				Task<T> get_return_object();
+
+				template <typename U>
+				void return_value(U &&result) { value.emplace(std::forward<U>(result)); }
+		};
+
+		template <>
+		class TaskPromise<void>: public TaskPromiseBase {
+			public:
+				Task<void> get_return_object();
+				void return_void() const noexcept {}
+		};
+	}
+
+	/**
+	 * A coroutine that produces a value of type T. Tasks are lazy: a task doesn't start until another coroutine awaits
+	 * it or it's passed to spawn(). Awaiting a task resumes the awaiting coroutine as soon as the task finishes and
+	 * rethrows any exception the task threw.
+	 *
+	 * Together with the awaitables provided by Terminal and TextInput, tasks let interactive flows be written as
+	 * straight-line code that runs on the UI thread without a thread of its own:
+	 *
+	 *     Task<> confirm(Terminal &term, TextInput &input) {
+	 *         std::string name = co_await input.submitted();
+	 *         co_await term.sleep(std::chrono::milliseconds(500));
+	 *         Key key = co_await term.nextKey();
+	 *         ...
+	 *     }
+	 *
+	 * A coroutine suspended on an awaitable holds a pointer to whatever it's waiting on, so the terminal and controls
+	 * involved have to outlive it.
+	 */
+	template <typename T = void>
+	class Task {
+		public:
+			using promise_type = Detail::TaskPromise<T>;
+
+		private:
+			friend promise_type;
+			friend void spawn(Task<void>);
+
+			std::coroutine_handle<promise_type> handle;
+
+			explicit Task(std::coroutine_handle<promise_type> handle_): handle(handle_) {}
+
+		public:
+			Task(const Task &) = delete;
+			Task(Task &&other) noexcept: handle(std::exchange(other.handle, {})) {}
+
+			Task & operator=(const Task &) = delete;
+			Task & operator=(Task &&other) noexcept {
+				if (this != &other) {
+					if (handle)
+						handle.destroy();
+					handle = std::exchange(other.handle, {});
+				}
+				return *this;
+			}
+
+			~Task() {
+				if (handle)
+					handle.destroy();
+			}
+
+			/** Returns whether the task has run to completion. */
+			bool isDone() const { return handle && handle.done(); }
+
+			bool await_ready() const noexcept { return !handle || handle.done(); }
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				handle.promise().continuation = awaiting;
+				return handle;
+			}
+
+			T await_resume() {
+				promise_type &promise = handle.promise();
+				if (promise.error)
+					std::rethrow_exception(promise.error);
+				if constexpr (!std::is_void_v<T>)
+					return std::move(*promise.value);
+			}
+	};
+
+	template <typename T>
+	Task<T> Detail::TaskPromise<T>::get_return_object() {
+		return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+	}
+
+	inline Task<void> Detail::TaskPromise<void>::get_return_object() {
+		return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+	}
+
+	/** Starts a task on the calling thread and lets it run on its own. The task destroys itself when it finishes. An
+	 *  exception that escapes the task calls std::terminate(), so a task that can fail should catch its exceptions. */
+	inline void spawn(Task<void> task) {
+		auto handle = std::exchange(task.handle, {});
+		handle.promise().detached = true;
+		handle.resume();
+	}
+
+	/**
+	 * A list of coroutines waiting for a value, such as the next key press. Every coroutine waiting when a value is
+	 * emitted gets a copy of it; coroutines that start waiting while the waiters are being resumed wait for the next
+	 * value instead.
+	 */
+	template <typename T>
+	class Signal {
+		private:
+			struct Waiter {
+				std::coroutine_handle<> handle;
+				std::optional<T> *slot;
+			};
+
+			std::vector<Waiter> waiters;
+
+		public:
+			class Awaiter {
+				private:
+					Signal &signal;
+					std::optional<T> value;
+
+				public:
+					explicit Awaiter(Signal &signal_): signal(signal_) {}
+
+					bool await_ready() const noexcept { return false; }
+					void await_suspend(std::coroutine_handle<> handle) { signal.waiters.push_back({handle, &value}); }
+					T await_resume() { return std::move(*value); }
+			};
+
+			/** Returns an awaitable that resumes the awaiting coroutine with the next value emitted. */
+			Awaiter wait() { return Awaiter(*this); }
+
+			/** Returns whether any coroutines are waiting. */
+			bool empty() const { return waiters.empty(); }
+
+			/** Resumes every waiting coroutine with a value. Returns the number resumed. */
+			size_t emit(const T &value) {
+				std::vector<Waiter> current;
+				current.swap(waiters);
+				for (Waiter &waiter: current) {
+					waiter.slot->emplace(value);
+					waiter.handle.resume();
+				}
+				return current.size();
+			}
+	};
+}
+
+#endif
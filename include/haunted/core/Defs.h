@@ -50,6 +50,15 @@ namespace Haunted {
 		/** Returns the bottommost column of the position. */
 		int bottom() const;
 
+		/** Returns whether another position lies entirely within this one. */
+		bool contains(const Position &) const;
+
+		/** Returns whether this position and another one share at least one cell. */
+		bool intersects(const Position &) const;
+
+		/** Returns the cells shared by this position and another one. The result is empty if they don't intersect. */
+		Position intersect(const Position &) const;
+
 		bool operator==(const Position &) const;
 		bool operator!=(const Position &) const;
 
@@ -21,6 +21,11 @@ namespace Haunted {
 				suppressOutput = true;
 			}
 
+			/** Creates a dummy terminal with fixed dimensions that doesn't need a TTY. */
+			DummyTerminal(int rows_, int cols_): Terminal(std::cin, ansi::out, rows_, cols_) {
+				suppressOutput = true;
+			}
+
 			~DummyTerminal() {}
 
 			void cbreak() override {}
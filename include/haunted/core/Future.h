@@ -0,0 +1,207 @@
+#ifndef HAUNTED_CORE_FUTURE_H_
+#define HAUNTED_CORE_FUTURE_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "haunted/core/Terminal.h"
+
+namespace Haunted {
+	template <typename T>
+	class Future;
+
+	template <typename T>
+	class Promise;
+
+	namespace Detail {
+		/** The state shared by a promise and its futures. Futures of void hold a std::monostate. */
+		template <typename T>
+		struct FutureState {
+			using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+			std::mutex mutex;
+			std::condition_variable ready;
+			std::optional<Value> value;
+			std::exception_ptr error;
+			bool done = false;
+
+			/** Functions to call once the state is done. They run on whichever thread completes it. */
+			std::vector<std::function<void()>> continuations;
+
+			void finish() {
+				std::vector<std::function<void()>> to_run;
+				{
+					std::unique_lock lock(mutex);
+					done = true;
+					to_run.swap(continuations);
+				}
+
+				ready.notify_all();
+				for (auto &fn: to_run)
+					fn();
+			}
+
+			/** Calls a function once the state is done, immediately if it already is. */
+			void whenDone(std::function<void()> fn) {
+				{
+					std::unique_lock lock(mutex);
+					if (!done) {
+						continuations.push_back(std::move(fn));
+						return;
+					}
+				}
+
+				fn();
+			}
+		};
+
+		/** Calls a function with a future's value (or with nothing if the future is void) and stores the result in a
+		 *  promise, catching anything it throws. */
+		template <typename R, typename T, typename F>
+		void fulfil(Promise<R> &promise, FutureState<T> &state, F &fn) {
+			try {
+				if constexpr (std::is_void_v<R>) {
+					if constexpr (std::is_void_v<T>)
+						fn();
+					else
+						fn(std::move(*state.value));
+					promise.set();
+				} else {
+					if constexpr (std::is_void_v<T>)
+						promise.set(fn());
+					else
+						promise.set(fn(std::move(*state.value)));
+				}
+			} catch (...) {
+				promise.fail(std::current_exception());
+			}
+		}
+
+		template <typename T, typename F>
+		struct ContinuationResult {
+			using type = std::invoke_result_t<F, T>;
+		};
+
+		template <typename F>
+		struct ContinuationResult<void, F> {
+			using type = std::invoke_result_t<F>;
+		};
+	}
+
+	/**
+	 * The receiving end of an asynchronous result. A future becomes ready once its promise is given a value or an
+	 * exception. Rather than blocking in get(), callers can attach continuations with then(), either to run on the
+	 * thread that completes the future or to be posted to a terminal's UI thread.
+	 *
+	 * Continuations consume the value, so a future should have at most one continuation or get() call.
+	 */
+	template <typename T>
+	class Future {
+		friend class Promise<T>;
+
+		private:
+			std::shared_ptr<Detail::FutureState<T>> state;
+
+			Future(std::shared_ptr<Detail::FutureState<T>> state_): state(std::move(state_)) {}
+
+		public:
+			Future() = default;
+
+			/** Returns whether the future refers to a promise at all. */
+			bool valid() const { return state != nullptr; }
+
+			bool isReady() const {
+				std::unique_lock lock(state->mutex);
+				return state->done;
+			}
+
+			/** Blocks until the future is ready. */
+			void wait() const {
+				std::unique_lock lock(state->mutex);
+				state->ready.wait(lock, [this] { return state->done; });
+			}
+
+			/** Blocks until the future is ready and returns its value, or rethrows the exception it failed with. */
+			T get() {
+				wait();
+				if (state->error)
+					std::rethrow_exception(state->error);
+				if constexpr (!std::is_void_v<T>)
+					return std::move(*state->value);
+			}
+
+			/** Calls a function with the value once the future is ready, on the thread that completes it (or right
+			 *  away if it's already ready). Returns a future for the function's result. If this future fails, the
+			 *  function isn't called and the returned future fails with the same exception. */
+			template <typename F, typename R = typename Detail::ContinuationResult<T, F>::type>
+			Future<R> then(F fn) {
+				Promise<R> promise;
+				Future<R> result = promise.getFuture();
+				state->whenDone([state = state, promise, fn = std::move(fn)]() mutable {
+					if (state->error)
+						promise.fail(state->error);
+					else
+						Detail::fulfil(promise, *state, fn);
+				});
+				return result;
+			}
+
+			/** Like then(), but the function is posted to a terminal's UI thread. The terminal has to be draining its
+			 *  posted tasks (with run() or runPending()) for the function to be called. */
+			template <typename F, typename R = typename Detail::ContinuationResult<T, F>::type>
+			Future<R> then(Terminal &terminal, F fn) {
+				Promise<R> promise;
+				Future<R> result = promise.getFuture();
+				state->whenDone([&terminal, state = state, promise, fn = std::move(fn)]() mutable {
+					if (state->error) {
+						promise.fail(state->error);
+						return;
+					}
+
+					terminal.post([state = std::move(state), promise, fn = std::move(fn)]() mutable {
+						Detail::fulfil(promise, *state, fn);
+					});
+				});
+				return result;
+			}
+	};
+
+	/** The sending end of an asynchronous result. Copies of a promise share the same state. */
+	template <typename T>
+	class Promise {
+		private:
+			std::shared_ptr<Detail::FutureState<T>> state = std::make_shared<Detail::FutureState<T>>();
+
+		public:
+			Future<T> getFuture() const { return Future<T>(state); }
+
+			/** Stores a value and makes the future ready. */
+			template <typename... Args>
+			void set(Args &&...args) {
+				{
+					std::unique_lock lock(state->mutex);
+					state->value.emplace(std::forward<Args>(args)...);
+				}
+				state->finish();
+			}
+
+			/** Stores an exception and makes the future ready. */
+			void fail(std::exception_ptr error) {
+				{
+					std::unique_lock lock(state->mutex);
+					state->error = std::move(error);
+				}
+				state->finish();
+			}
+	};
+}
+
+#endif
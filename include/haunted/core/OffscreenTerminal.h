@@ -0,0 +1,115 @@
+#ifndef HAUNTED_CORE_OFFSCREENTERMINAL_H_
+#define HAUNTED_CORE_OFFSCREENTERMINAL_H_
+
+#include <cstddef>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "haunted/core/Terminal.h"
+
+namespace Haunted {
+	/**
+	 * A stream buffer that keeps everything written to it in a string. Once the string would grow past a limit, the
+	 * contents are discarded and all further output is ignored until the buffer is cleared.
+	 */
+	class RecordingBuffer: public std::streambuf {
+		private:
+			std::string recording;
+			size_t limit;
+			bool overflowed = false;
+
+			/** The number of bytes written since the buffer was created, including any that were discarded. */
+			size_t total = 0;
+
+		protected:
+			int_type overflow(int_type) override;
+			std::streamsize xsputn(const char *, std::streamsize) override;
+
+		public:
+			RecordingBuffer(size_t limit_): limit(limit_) {}
+
+			const std::string & getRecording() const { return recording; }
+			bool hasOverflowed() const { return overflowed; }
+			size_t getTotal() const { return total; }
+			size_t getLimit() const { return limit; }
+			void setLimit(size_t);
+			void clear();
+	};
+
+	/**
+	 * Holds the streams of an OffscreenTerminal. It's a separate base class so that the streams are constructed before
+	 * the Terminal that writes to them.
+	 */
+	class OffscreenStreams {
+		protected:
+			RecordingBuffer buffer;
+			std::ostream bufferStream;
+			ansi::ansistream recordingStream;
+			std::istringstream emptyInput;
+
+			OffscreenStreams(size_t limit): buffer(limit), bufferStream(&buffer), recordingStream(bufferStream,
+				bufferStream) {}
+	};
+
+	/**
+	 * Represents a terminal whose output is recorded in memory instead of being written to a TTY. Replaying the
+	 * recording on a real terminal reproduces everything drawn on the offscreen one. An offscreen terminal can follow a
+	 * source terminal, in which case it takes its dimensions and focus from the source so that controls draw on it
+	 * exactly as they would on the source.
+	 */
+	class OffscreenTerminal: private OffscreenStreams, public Terminal {
+		private:
+			Terminal *source = nullptr;
+
+			void apply() override {}
+			void reset() override {}
+			void winch(int, int) override {}
+
+		public:
+			static constexpr size_t UNLIMITED = static_cast<size_t>(-1);
+
+			/** Creates an offscreen terminal with fixed dimensions. */
+			OffscreenTerminal(int rows_, int cols_, size_t limit = UNLIMITED);
+
+			/** Creates an offscreen terminal that follows a source terminal. */
+			OffscreenTerminal(Terminal &source_, size_t limit = UNLIMITED);
+
+			~OffscreenTerminal();
+
+			Terminal * getSource() const { return source; }
+
+			/** Returns everything written since the recording was last cleared. */
+			const std::string & getRecording() const { return buffer.getRecording(); }
+
+			/** Returns whether more than the limit was written since the recording was last cleared, in which case the
+			 *  recording is empty and incomplete. */
+			bool hasOverflowed() const { return buffer.hasOverflowed(); }
+
+			size_t getLimit() const { return buffer.getLimit(); }
+			void setLimit(size_t limit) { buffer.setLimit(limit); }
+
+			/** Returns the number of bytes written over the terminal's lifetime, whether or not they were recorded. */
+			size_t getBytesWritten() const { return buffer.getTotal(); }
+
+			/** Changes the terminal's dimensions as though its window had been resized and redraws it. If the terminal
+			 *  has a UI thread, this happens when the UI thread runs its pending tasks. Terminals that follow a source
+			 *  can't be resized. */
+			void setSize(int rows_, int cols_);
+
+			/** Discards the recording and forgets the current colors, so that the next recording starts from the
+			 *  terminal's default colors. */
+			void clearRecording();
+
+			void cbreak() override {}
+			void watchSize() override {}
+			void startInput() override {}
+			void jumpToFocused() override {}
+
+			bool hasFocus(const UI::Control *) const override;
+			int getRows() const override;
+			int getCols() const override;
+	};
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef HAUNTED_CORE_TASKQUEUE_H_
+#define HAUNTED_CORE_TASKQUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace Haunted {
+	/**
+	 * A lock-free queue of tasks with any number of producers and a single consumer. Pushing is a single atomic
+	 * exchange, so it never blocks on other producers or on the consumer. Only one thread may pop at a time.
+	 *
+	 * The consumer can sleep in wait() or waitUntil() until a task arrives. Producers only touch the mutex behind the
+	 * sleep when the consumer is actually asleep, so pushing to a busy consumer stays lock-free.
+	 */
+	class TaskQueue {
+		public:
+			using Task = std::function<void()>;
+
+		private:
+			struct Node {
+				std::atomic<Node *> next {nullptr};
+				Task task;
+			};
+
+			/** The most recently pushed node. Producers swap themselves in here. */
+			std::atomic<Node *> head;
+
+			/** The oldest node, which only the consumer touches. */
+			Node *tail;
+
+			/** A placeholder node that keeps the list from ever being empty. */
+			Node stub;
+
+			/** The number of tasks pushed but not yet popped. */
+			std::atomic<size_t> pending {0};
+
+			/** Incremented whenever a task is pushed or wake() is called, for the consumer to wait on. */
+			std::atomic<uint32_t> signals {0};
+
+			/** Whether the consumer is asleep (or about to be) and has to be notified. */
+			std::atomic<bool> sleeping {false};
+			std::mutex sleepMutex;
+			std::condition_variable sleeper;
+
+			void pushNode(Node *);
+
+			/** Increments the signal count and wakes the consumer if it's asleep. */
+			void signal();
+
+		public:
+			TaskQueue();
+			TaskQueue(const TaskQueue &) = delete;
+			TaskQueue & operator=(const TaskQueue &) = delete;
+
+			/** Destroys any tasks that were never run. */
+			~TaskQueue();
+
+			/** Adds a task to the end of the queue. Safe to call from any thread. */
+			void push(Task);
+
+			/** Removes the oldest task and moves it into the argument. Returns false if the queue is empty or if the
+			 *  oldest task is still being pushed, in which case the consumer should try again later. */
+			bool pop(Task &);
+
+			/** Returns the number of tasks pushed but not yet popped. */
+			size_t size() const { return pending.load(std::memory_order_acquire); }
+			bool empty() const { return size() == 0; }
+
+			/** Blocks until the queue isn't empty or wake() is called. */
+			void wait();
+
+			/** Like wait(), but gives up at a deadline. Returns false if the deadline passed with nothing to do. */
+			bool waitUntil(std::chrono::steady_clock::time_point);
+
+			/** Makes a call to wait() return even if the queue is empty. */
+			void wake();
+	};
+}
+
+#endif
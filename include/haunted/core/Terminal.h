@@ -1,6 +1,7 @@
 #ifndef HAUNTED_CORE_TERMINAL_H_
 #define HAUNTED_CORE_TERMINAL_H_
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -10,10 +11,14 @@
 
 #include <termios.h>
 
+#include "haunted/core/Coroutine.h"
 #include "haunted/core/Key.h"
 #include "haunted/core/Mouse.h"
+#include "haunted/core/TaskQueue.h"
+#include "haunted/core/TimerWheel.h"
 #include "haunted/ui/Coloration.h"
 #include "haunted/ui/Container.h"
+#include "haunted/ui/HitIndex.h"
 
 #include "lib/formicine/ansi.h"
 #include "lib/formicine/performance.h"
@@ -22,6 +27,23 @@ namespace Haunted {
 	/**
 	 * This class enables interaction with terminals. It uses termios to change terminal modes.
 	 * When the destructor is called, it resets the modes to their original values.
+	 *
+	 * Besides the root control, a terminal can show overlays: controls drawn above the root in order of their z-index,
+	 * such as popups and completion menus. Controls hidden entirely behind an opaque overlay don't draw at all, and
+	 * controls that draw with a PaintContext are clipped around the opaque overlays above them. Removing an overlay
+	 * redraws only the controls that were under it.
+	 *
+	 * By default, any thread can draw and the terminal serializes output with locks. A terminal can instead be given a
+	 * UI thread with setUIThread(). Other threads then hand work to it with post(), the input thread posts key presses
+	 * instead of dispatching them itself, and rendering and output skip their locks entirely. Debug builds assert that
+	 * rendering only happens on the UI thread.
+	 *
+	 * The UI thread also runs the terminal's timers, which are meant for animations, debouncing and cursor blinking.
+	 * run() sleeps until the next timer is due or a task is posted, so an idle terminal doesn't wake up at all, and
+	 * tasks and timers that are ready at the same time are drawn with a single flush.
+	 *
+	 * Coroutines (see Task) running on the UI thread can await the terminal's next key press, a delay or the next
+	 * frame. They're resumed by the run loop, so any number of them can wait at once without a thread apiece.
 	 */
 	class Terminal: public UI::Container {
 		private:
@@ -40,6 +62,27 @@ namespace Haunted {
 
 			int rows, cols;
 
+			/** Tasks posted for the UI thread. */
+			TaskQueue tasks;
+
+			/** Timers set with setTimeout() and setInterval(), run by the UI thread. */
+			TimerWheel timers;
+
+			/** Coroutines waiting for the next key press. */
+			Signal<Key> keyWaiters;
+
+			/** The UI thread, or a default-constructed ID if there isn't one. */
+			std::atomic<std::thread::id> uiThread {};
+
+			struct Overlay {
+				UI::Control *control;
+				int z;
+				bool opaque;
+			};
+
+			/** The overlays from bottom to top. Overlays with equal z-indices are kept in the order they were added. */
+			std::vector<Overlay> overlays;
+
 			/** Applies the attributes in `attrs` to the terminal. */
 			virtual void apply();
 
@@ -49,16 +92,37 @@ namespace Haunted {
 			/** Repeatedly reads from the terminal in a loop and dispatches the key presses to the focused control. */
 			virtual void workInput();
 
-			/** Handles window resizes. */
-			virtual void winch(int, int);
-
 			// signal() takes a pointer to a static function. To get around this, every terminal object whose
 			// watch_size() method is called adds itself to a static vector of terminal pointers. When the WINCH signal
 			// handler is called, it notifies all the listening terminal objects of the terminal's new dimensions.
 
-			/** Notifies terminal objects of a window resize. */
+			/** Handles the WINCH signal by writing to winchPipe. Writing to a pipe is one of the few things a signal
+			 *  handler can safely do; resizing and redrawing happen on the thread that reads the pipe. */
 			static void winchHandler(int);
 			static std::vector<Terminal *> winchTargets;
+			static std::mutex winchTargetsMutex;
+			static int winchPipe[2];
+
+			/** Waits for the WINCH handler to write to winchPipe and notifies the terminals in winchTargets of the new
+			 *  size. Runs on a thread of its own for the life of the program. */
+			static void watchWinch();
+
+			/** Handles a key press on the UI thread: ^C runs the interrupt handler, and other keys go to the coroutines
+			 *  waiting for a key or, if there are none, to the controls. */
+			void handleKey(const Key &);
+
+			/** Returns the index of the overlay a control belongs to, or -1 if it belongs to the root control's tree
+			 *  (or to no tree at all). */
+			ssize_t layerOf(const UI::Control *) const;
+
+			/** Resizes the hit index if the terminal's dimensions have changed and rebuilds it if it's stale. */
+			void refreshHits() const;
+
+			/** Redraws whatever is left in a region after an overlay is removed from it. */
+			void restore(const Position &);
+
+			/** Returns a lock on the output mutex, or an empty lock if the terminal has a UI thread. */
+			std::unique_lock<std::mutex> lockOutput();
 
 			/** Returns the terminal attributes from tcgetaddr. */
 			static termios getattr();
@@ -66,15 +130,46 @@ namespace Haunted {
 			/** Sets the terminal attributes with tcsetaddr. */
 			static void setattr(const termios &);
 
+		protected:
+			/** Handles window resizes. */
+			virtual void winch(int, int);
+
+			/** Creates a terminal with fixed dimensions that isn't attached to a TTY. Its attributes are never read or
+			 *  applied, so subclasses using it must override apply() and reset(). */
+			Terminal(std::istream &, ansi::ansistream &, int rows_, int cols_);
+
 		public:
+			/** Resumes a coroutine on the UI thread after a delay. */
+			class SleepAwaiter {
+				private:
+					Terminal &terminal;
+					TimerWheel::Clock::duration delay;
+
+				public:
+					SleepAwaiter(Terminal &terminal_, TimerWheel::Clock::duration delay_):
+						terminal(terminal_), delay(delay_) {}
+
+					bool await_ready() const noexcept { return false; }
+					void await_suspend(std::coroutine_handle<>);
+					void await_resume() const noexcept {}
+			};
+
 			termios attrs;
 			bool raw = false;
 			bool suppressOutput = false;
-			bool alive = true;
+
+			/** Whether the terminal supports horizontal margins (DECLRMM and DECSLRM). Many don't, so controls only use
+			 *  them to speed up scrolling when this is set, and never rely on them to keep their output in place. */
+			bool hmarginsSupported = false;
+			std::atomic<bool> alive = true;
 			std::istream &inStream;
 			ansi::ansistream &outStream;
 			UI::Coloration colors;
 
+			/** Maps screen cells to the controls on them for mouse hit-testing. It's kept up to date by controls as they're
+			 *  resized and rebuilt lazily when the tree changes. */
+			mutable UI::HitIndex hitIndex;
+
 			bool dragging = false;
 			MouseButton dragButton = MouseButton::Left;
 
@@ -113,8 +208,25 @@ namespace Haunted {
 			 *  parameter is `true`, this function deletes the old root. */
 			virtual void setRoot(UI::Control *, bool delete_old = true);
 			
-			/** Draws the root control if one exists. */
+			/** Draws the root control if one exists, followed by the overlays. */
 			virtual void draw();
+
+			/** Shows a control above the root control. The control becomes a child of the terminal and should already
+			 *  have its position. Overlays with higher z-indices are drawn above those with lower ones. An overlay that
+			 *  isn't opaque may leave some of its cells unpainted, so nothing below it is hidden or clipped. */
+			virtual void addOverlay(UI::Control *, int z = 0, bool opaque = true);
+
+			/** Removes an overlay and redraws the region it covered. If the `delete_old` parameter is `true`, the
+			 *  control is deleted as well. Returns false if the control isn't an overlay. */
+			virtual bool removeOverlay(UI::Control *, bool delete_old = true);
+
+			bool hasOverlays() const { return !overlays.empty(); }
+
+			/** Returns whether a control is hidden entirely behind a single opaque overlay above it. */
+			bool isOccluded(const UI::Control *) const;
+
+			/** Returns the parts of a region that are covered by opaque overlays above a control's layer. */
+			std::vector<Position> getCovers(const UI::Control *, const Position &) const;
 			
 			/** Sends a key press to whichever control is most appropriate and willing to receive it.
 			 *  Returns a pointer to the control or container that ended up handling the key press. */
@@ -157,8 +269,8 @@ namespace Haunted {
 			/** Returns a (0, 0)-based position representing the terminal. */
 			virtual Position getPosition() const override;
 
-			/** Recursively searches the all children within the terminal until a non-container control that contains
-			 *  the given coordinate is found. */
+			/** Returns the non-container control at a given coordinate, or nullptr if there isn't one. Overlays are
+			 *  checked before the root control. */
 			virtual UI::Control * childAtOffset(int x, int y) const override;
 
 			/** Jumps to the focused widget. */
@@ -210,9 +322,64 @@ namespace Haunted {
 			/** Disables origin mode. */
 			virtual void resetOrigin();
 
-			/** Returns a lock that gives the current thread exclusive permission to render components. */
+			/** Returns a lock that gives the current thread exclusive permission to render components. If the terminal
+			 *  has a UI thread, nothing is locked. */
 			virtual std::unique_lock<std::recursive_mutex> lockRender();
 
+			/** Makes the calling thread the terminal's UI thread. From then on, controls must only be changed and drawn
+			 *  on this thread. */
+			void setUIThread();
+
+			/** Returns whether the terminal has a UI thread. */
+			bool isSingleThreaded() const { return uiThread.load(std::memory_order_relaxed) != std::thread::id(); }
+
+			/** Returns whether the calling thread is the UI thread. Without a UI thread, every thread counts. */
+			bool onUIThread() const;
+
+			/** Queues a function to run on the UI thread. Safe to call from any thread, including the UI thread. */
+			void post(TaskQueue::Task);
+
+			/** Runs every posted task, including ones posted while running. Returns the number of tasks run. Must be
+			 *  called on the UI thread. */
+			size_t runPending();
+
+			/** Runs a function on the UI thread once after a delay. Returns a handle for cancelTimer(). */
+			TimerWheel::Handle setTimeout(TimerWheel::Clock::duration, TimerWheel::Callback);
+
+			/** Runs a function on the UI thread repeatedly. Missed repetitions are skipped rather than run late. */
+			TimerWheel::Handle setInterval(TimerWheel::Clock::duration, TimerWheel::Callback);
+
+			/** Cancels a timer. Returns false if it already fired (and doesn't repeat) or was cancelled. */
+			bool cancelTimer(TimerWheel::Handle);
+
+			/** Runs the timers that are due. Returns the number of callbacks run. Must be called on the UI thread. */
+			size_t runTimers();
+
+			/** Runs posted tasks and timers on the calling thread, which becomes the UI thread, until the terminal stops
+			 *  being alive. Tasks and timers are run in batches with one flush after each batch. */
+			void run();
+
+			/** Makes run() return after its current batch. */
+			void stop();
+
+			/** Queues a key press for the UI thread as though it had been read from the terminal. Safe to call from
+			 *  any thread. */
+			void postKey(const Key &);
+
+			/** Returns an awaitable that resumes the awaiting coroutine with the next key press. While coroutines are
+			 *  waiting, key presses go to them instead of to the controls. The terminal must have a UI thread, and this
+			 *  must be awaited on it. */
+			Signal<Key>::Awaiter nextKey();
+
+			/** Returns an awaitable that resumes the awaiting coroutine after a delay. The terminal must have a UI
+			 *  thread, and this must be awaited on it. */
+			SleepAwaiter sleep(TimerWheel::Clock::duration);
+
+			/** Returns an awaitable that resumes the awaiting coroutine at the next tick of the terminal's timers.
+			 *  Every coroutine waiting for the same frame is resumed in the same batch, so their drawing is flushed
+			 *  together. The terminal must have a UI thread, and this must be awaited on it. */
+			SleepAwaiter nextFrame();
+
 			/** Returns true if in_stream is in a valid state. */
 			virtual operator bool() const;
 			/** Reads a single raw character from the terminal as an int. */
@@ -229,7 +396,7 @@ namespace Haunted {
 			Terminal & operator<<(const T &t) {
 				auto w = formicine::perf.watch("template <T> operator<<(Terminal, T)");
 				if (!suppressOutput) {
-					std::unique_lock uniq(outputMutex);
+					auto uniq = lockOutput();
 					outStream << t;
 				}
 
@@ -239,7 +406,7 @@ namespace Haunted {
 			/** Deactivates a formicine style or color. */
 			template <typename T>
 			Terminal & operator>>(const T &t) {
-				std::unique_lock uniq(outputMutex);
+				auto uniq = lockOutput();
 				outStream >> t;
 				return *this;
 			}
@@ -0,0 +1,101 @@
+#ifndef HAUNTED_CORE_THREADPOOL_H_
+#define HAUNTED_CORE_THREADPOOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "haunted/core/Future.h"
+
+namespace Haunted {
+	/**
+	 * A pool of worker threads for pure computations that shouldn't hold up the UI thread. Each worker has its own
+	 * queue of tasks: a worker takes the newest task from its own queue and, when that's empty, steals the oldest task
+	 * from another worker's. Tasks submitted from a worker go to that worker's queue, so work that spawns more work
+	 * stays local until another worker runs dry. Workers with nothing to do sleep until a task arrives.
+	 *
+	 * Results come back through futures, whose continuations can be posted to a terminal's UI thread.
+	 */
+	class ThreadPool {
+		public:
+			using Task = std::function<void()>;
+
+		private:
+			struct Worker {
+				std::mutex mutex;
+				std::deque<Task> tasks;
+				std::thread thread;
+			};
+
+			std::vector<std::unique_ptr<Worker>> workers;
+
+			/** The worker that the next task from outside the pool goes to. */
+			std::atomic<size_t> nextWorker {0};
+
+			/** The number of tasks waiting in all the queues. */
+			std::atomic<size_t> queued {0};
+
+			/** Incremented whenever a task is added, for sleeping workers to wait on. */
+			std::atomic<uint32_t> signals {0};
+
+			std::atomic<bool> stopping {false};
+
+			/** Takes a task from a worker's own queue or steals one from another's. */
+			bool take(size_t index, Task &);
+
+			void work(size_t index);
+
+		public:
+			/** Starts a pool with a number of workers. Zero means one per hardware thread. */
+			ThreadPool(size_t threads = 0);
+
+			ThreadPool(const ThreadPool &) = delete;
+			ThreadPool & operator=(const ThreadPool &) = delete;
+
+			/** Runs every task already queued and then joins the workers. */
+			~ThreadPool();
+
+			size_t size() const { return workers.size(); }
+
+			/** Returns the number of tasks waiting to run. */
+			size_t pending() const { return queued.load(std::memory_order_relaxed); }
+
+			/** Returns whether the calling thread is one of this pool's workers. */
+			bool inWorker() const;
+
+			/** Queues a task. */
+			void execute(Task);
+
+			/** Queues a function and returns a future for its result. */
+			template <typename F, typename R = std::invoke_result_t<F>>
+			Future<R> submit(F fn) {
+				Promise<R> promise;
+				Future<R> future = promise.getFuture();
+				execute([promise, fn = std::move(fn)]() mutable {
+					try {
+						if constexpr (std::is_void_v<R>) {
+							fn();
+							promise.set();
+						} else {
+							promise.set(fn());
+						}
+					} catch (...) {
+						promise.fail(std::current_exception());
+					}
+				});
+				return future;
+			}
+
+			/** Returns a pool shared by the library and any application that wants it. It's started the first time
+			 *  it's needed. */
+			static ThreadPool & shared();
+	};
+}
+
+#endif
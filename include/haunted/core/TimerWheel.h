@@ -0,0 +1,122 @@
+#ifndef HAUNTED_CORE_TIMERWHEEL_H_
+#define HAUNTED_CORE_TIMERWHEEL_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace Haunted {
+	/**
+	 * Schedules callbacks with a hierarchical timing wheel. Time is divided into ticks (one frame each by default) and
+	 * the wheel has four levels of 64 slots: the first level holds timers due within 64 ticks, and each level above it
+	 * covers 64 times the span of the one below. Timers are moved down a level as their time approaches.
+	 *
+	 * Scheduling and cancelling take constant time. Every timer due in the same tick fires in the same call to
+	 * advance(), so animations that share a frame are drawn together. When nothing is scheduled, nextDeadline() is
+	 * empty and the caller can sleep until something else happens.
+	 *
+	 * The wheel isn't thread-safe; a terminal's timers belong to its UI thread.
+	 */
+	class TimerWheel {
+		public:
+			using Clock = std::chrono::steady_clock;
+			using Callback = std::function<void()>;
+
+			/** Identifies a scheduled timer. Handles of timers that have fired or been cancelled are never reused. */
+			struct Handle {
+				uint32_t index = 0;
+				uint32_t generation = 0;
+
+				explicit operator bool() const { return generation != 0; }
+			};
+
+		private:
+			static constexpr int LEVELS = 4, SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS;
+			static constexpr uint32_t NIL = static_cast<uint32_t>(-1);
+
+			struct Timer {
+				Callback callback;
+				uint64_t expiry = 0;
+
+				/** The number of ticks between repetitions, or 0 for a timer that fires once. */
+				uint64_t period = 0;
+
+				/** Incremented whenever the timer is freed. Odd while the timer is scheduled. */
+				uint32_t generation = 0;
+
+				/** The timer's neighbors in its slot's list (or, for free timers, the next free timer). */
+				uint32_t previous = NIL, next = NIL;
+
+				uint8_t level = 0, slot = 0;
+			};
+
+			Clock::duration tick;
+			Clock::time_point origin;
+
+			/** The last tick processed. */
+			uint64_t now = 0;
+
+			std::vector<Timer> timers;
+			uint32_t freeList = NIL;
+			size_t active = 0;
+
+			/** The first timer in each slot's list. */
+			std::array<std::array<uint32_t, SLOTS>, LEVELS> heads;
+
+			/** A bit for each slot that isn't empty. */
+			std::array<uint64_t, LEVELS> occupied {};
+
+			uint64_t tickAt(Clock::time_point) const;
+			Clock::time_point timeOf(uint64_t tick) const;
+
+			/** Links a timer into the slot for its expiry. Timers already due go into the current slot. */
+			void link(uint32_t);
+			void unlink(uint32_t);
+
+			/** Frees a timer, invalidating its handle. */
+			void release(uint32_t);
+
+			/** Moves the timers in a slot of a higher level down to the levels below. */
+			void cascade(int level, int slot);
+
+			/** Returns the next tick after the current one at which a slot has to be processed, if there is one. */
+			std::optional<uint64_t> nextTick() const;
+
+		public:
+			TimerWheel(Clock::duration tick_ = std::chrono::milliseconds(16), Clock::time_point origin_ = Clock::now());
+
+			Clock::duration getTick() const { return tick; }
+
+			/** Returns the number of scheduled timers. */
+			size_t size() const { return active; }
+			bool empty() const { return active == 0; }
+
+			/** Schedules a callback to run once after a delay. The callback runs in the first call to advance() at or
+			 *  after the end of the tick containing the deadline. A delay of zero means the next tick. The delay is
+			 *  measured from the current time unless another starting point is given. */
+			Handle schedule(Clock::duration delay, Callback, Clock::time_point from = Clock::now());
+
+			/** Schedules a callback to run repeatedly. The first run comes one period after the starting point. A
+			 *  timer that falls behind fires once and skips the repetitions it missed. */
+			Handle repeat(Clock::duration period, Callback, Clock::time_point from = Clock::now());
+
+			/** Cancels a timer. Returns false if it already fired (and doesn't repeat) or was cancelled. Timers can
+			 *  cancel themselves from their callbacks. */
+			bool cancel(Handle);
+
+			/** Returns whether a handle refers to a timer that's still scheduled. */
+			bool isScheduled(Handle) const;
+
+			/** Runs every timer due at a given time. Returns the number of callbacks run. */
+			size_t advance(Clock::time_point = Clock::now());
+
+			/** Returns the time by which advance() should next be called, or nothing if no timers are scheduled. The
+			 *  time may be early when timers have to move down a level, but never late. */
+			std::optional<Clock::time_point> nextDeadline() const;
+	};
+}
+
+#endif
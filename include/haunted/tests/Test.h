@@ -394,7 +394,27 @@ namespace Haunted::Tests {
 			static void unittest_csiu(Testing &);
 			static void unittest_textbox(Testing &);
 			static void unittest_expandobox(Testing &);
+			static void unittest_flex(Testing &);
+			static void unittest_hitindex(Testing &);
+			static void unittest_colored(Testing &);
+			static void unittest_arena(Testing &);
+			static void unittest_swapbox(Testing &);
+			static void unittest_paint(Testing &);
+			static void unittest_listview(Testing &);
+			static void unittest_table(Testing &);
+			static void unittest_treeview(Testing &);
+			static void unittest_overlay(Testing &);
+			static void unittest_taskqueue(Testing &);
+			static void unittest_threadpool(Testing &);
+			static void unittest_timerwheel(Testing &);
+			static void unittest_coroutine(Testing &);
 			static void unittest_ustring(Testing &);
+			static void unittest_superstring(Testing &);
+			static void unittest_utf8(Testing &);
+			static void unittest_piecetable(Testing &);
+			static void unittest_textarea(Testing &);
+			static void unittest_completer(Testing &);
+			static void unittest_history(Testing &);
 	};
 }
 
@@ -0,0 +1,82 @@
+#ifndef HAUNTED_UI_ARENA_H_
+#define HAUNTED_UI_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "haunted/ui/Control.h"
+
+namespace Haunted::UI {
+	/**
+	 * Allocates the controls of a view (a dialog, a tab...) from a few large blocks and destroys them all at once.
+	 *
+	 * The arena owns everything made with make(). Containers never delete arena-owned children, and
+	 * Terminal::setRoot never deletes an arena-owned root, so nothing made here may be deleted by hand. Controls that
+	 * weren't made by the arena can still be placed in arena-owned containers; those are deleted by their parents as
+	 * usual. When the arena is cleared or destroyed, its controls are first detached from any containers outside the
+	 * arena. A terminal whose root is in the arena must be given a different root beforehand.
+	 */
+	class Arena {
+		private:
+			struct Object {
+				void *pointer;
+				void (*destroy)(void *);
+				/** Set for controls, to detach them from their containers before anything is destroyed. */
+				Control *control;
+			};
+
+			struct Block {
+				std::unique_ptr<std::byte[]> data;
+				size_t capacity;
+			};
+
+			/** The size of the first block. */
+			size_t initialBlockSize;
+
+			/** The size of the next block. Each block is twice as large as the one before it. */
+			size_t blockSize;
+			std::vector<Block> blocks;
+			std::byte *cursor = nullptr, *end = nullptr;
+			std::vector<Object> objects;
+
+			/** Returns uninitialized memory for an object. */
+			void * allocate(size_t size, size_t alignment);
+
+		public:
+			Arena(size_t block_size = 64 * 1024): initialBlockSize(block_size), blockSize(block_size) {}
+			Arena(const Arena &) = delete;
+			Arena & operator=(const Arena &) = delete;
+			~Arena() { clear(); }
+
+			/** Constructs an object in the arena and returns a pointer to it. */
+			template <typename T, typename... Args>
+			T * make(Args && ...args) {
+				void *memory = allocate(sizeof(T), alignof(T));
+				T *object = new (memory) T(std::forward<Args>(args)...);
+
+				Control *control = nullptr;
+				if constexpr (std::is_base_of_v<Control, T>) {
+					control = object;
+					control->arenaOwned = true;
+				}
+
+				objects.push_back({object, [](void *pointer) { static_cast<T *>(pointer)->~T(); }, control});
+				return object;
+			}
+
+			/** Destroys every object in the arena and releases all but the largest block, which is kept for reuse. */
+			void clear();
+
+			/** Returns the number of objects in the arena. */
+			size_t size() const { return objects.size(); }
+
+			/** Returns the number of blocks the arena has allocated. */
+			size_t blockCount() const { return blocks.size(); }
+	};
+}
+
+#endif
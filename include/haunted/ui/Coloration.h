@@ -17,11 +17,18 @@ namespace Haunted::UI {
 			ansi::color lastForeground = ansi::color::normal;
 			ansi::color lastBackground = ansi::color::normal;
 
-			std::unique_lock<std::mutex> getLock() { return std::unique_lock(*mutex); }
+			/** Whether to lock the mutex before writing. Terminals with a UI thread turn this off. */
+			bool locking = true;
+
+			std::unique_lock<std::mutex> getLock() {
+				return locking? std::unique_lock(*mutex) : std::unique_lock<std::mutex>();
+			}
 
 		public:
 			Coloration(ansi::ansistream *out_stream, std::mutex *mutex_): outStream(out_stream), mutex(mutex_) {}
 
+			void setLocking(bool locking_) { locking = locking_; }
+
 			/** Attempts to set the foreground. Returns whether the given foreground is different from the last one. */
 			bool setForeground(ansi::color);
 
@@ -13,10 +13,24 @@ namespace Haunted::UI {
 		private:
 			ansi::color background, foreground;
 
+			/** The colors last returned by findColor(). They're valid while resolved is set. */
+			mutable ansi::color resolvedForeground = ansi::color::normal, resolvedBackground = ansi::color::normal;
+			mutable bool resolved = false;
+
+			mutable bool containerKnown = false;
+			mutable Container *container = nullptr;
+
 			/** If the specified color type is "normal" for this, this function searches all ancestors until it finds
-			 *  one with a color of the same type and returns it. Otherwise, this returns the specified color. */
+			 *  one with a color of the same type and returns it. Otherwise, this returns the specified color. The
+			 *  result is cached until the color is changed or the tree is rearranged. */
 			ansi::color findColor(ansi::color_type) const;
 
+			/** Searches the ancestors for an inherited color without consulting the cache. */
+			ansi::color resolveColor(ansi::color_type) const;
+
+			/** Returns this object as a container, or nullptr if it isn't one. Looked up once and cached. */
+			Container * containerSelf() const;
+
 		public:
 			bool inheritForeground, inheritBackground;
 
@@ -44,9 +58,14 @@ namespace Haunted::UI {
 			Colored & tryColors(bool find = false);
 			/** Resets the terminal's colors. */
 			Colored & uncolor();
-			/** Propagate the control's colors to its children. */
+			/** Propagates the control's colors to the descendants that inherit them and redraws the ones whose colors
+			 *  actually changed. Returns false if the control isn't a container. */
 			bool propagate(ansi::color_type);
 
+			/** Discards the cached inherited colors of a control and its descendants. Called when a control is moved to
+			 *  a new parent, which changes the ancestors of nothing outside its subtree. */
+			static void invalidateTree(Control *);
+
 			virtual void draw();
 			virtual void focus();
 
@@ -0,0 +1,95 @@
+#ifndef HAUNTED_UI_COMPLETER_H_
+#define HAUNTED_UI_COMPLETER_H_
+
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Haunted::UI {
+	/**
+	 * Holds a set of completion candidates (nicknames, commands, paths...) for a TextInput. Candidates are kept sorted
+	 * by their folded form, so the matches for a prefix form one contiguous range that can be found and stepped through
+	 * in logarithmic time regardless of how many candidates there are.
+	 */
+	class Completer {
+		private:
+			/** A folded prefix, or a bound derived from one, to look up among the candidates. It's compared as is,
+			 *  since folding a bound like "foo@" + 1 would move it. */
+			struct Prefix {
+				std::string_view folded;
+			};
+
+			/** Orders candidates by their folded form and then by the candidates themselves, folding as it compares
+			 *  so that each candidate is stored only once. A Prefix is compared with a candidate's folded form. */
+			struct Order {
+				using is_transparent = void;
+
+				bool caseSensitive;
+
+				/** Compares the folded form of a string with another string like std::string::compare. The second
+				 *  string is folded too unless it's marked as already folded. */
+				int compare(std::string_view, std::string_view, bool right_folded = false) const;
+
+				bool operator()(const std::string &left, const std::string &right) const {
+					const int result = compare(left, right);
+					return result < 0 || (result == 0 && left < right);
+				}
+
+				bool operator()(const std::string &left, const Prefix &right) const {
+					return compare(left, right.folded, true) < 0;
+				}
+
+				bool operator()(const Prefix &left, const std::string &right) const {
+					return 0 < compare(right, left.folded, true);
+				}
+			};
+
+			std::set<std::string, Order> entries;
+
+			/** Returns the iterators delimiting the candidates that start with a folded prefix. */
+			using Iterator = decltype(entries)::const_iterator;
+			std::pair<Iterator, Iterator> range(const std::string &folded_prefix) const;
+
+		public:
+			/** Whether matching distinguishes between uppercase and lowercase ASCII letters. */
+			const bool caseSensitive;
+
+			/** Text to insert after a completed word. */
+			std::string suffix;
+
+			/** Text to insert after a completed word when it's the first thing in the input (e.g., ": " for nicks). If
+			 *  empty, suffix is used instead. */
+			std::string startSuffix;
+
+			Completer(bool case_sensitive = false, const std::string &suffix_ = " "):
+				entries(Order {case_sensitive}), caseSensitive(case_sensitive), suffix(suffix_) {}
+
+			/** Returns the form of a string used for comparisons. */
+			std::string fold(const std::string &) const;
+
+			/** Adds a candidate. Returns false if it was already present. */
+			bool add(const std::string &);
+
+			/** Removes a candidate. Returns false if it wasn't present. */
+			bool remove(const std::string &);
+
+			bool contains(const std::string &) const;
+			void clear() { entries.clear(); }
+			size_t size() const { return entries.size(); }
+			bool empty() const { return entries.empty(); }
+
+			/** Returns up to `limit` candidates that start with a prefix, in sorted order. */
+			std::vector<std::string> matches(const std::string &prefix, size_t limit = std::string::npos) const;
+
+			/** Returns the candidate that follows (or precedes, if `reverse` is true) a given candidate among those
+			 *  starting with a prefix, wrapping around at the ends. If `current` is empty, the first (or last) match is
+			 *  returned. Returns nothing if no candidate starts with the prefix. */
+			std::optional<std::string> next(const std::string &prefix, const std::string &current = "",
+			                                bool reverse = false) const;
+	};
+}
+
+#endif
@@ -19,6 +19,7 @@ namespace Haunted::UI {
 	 * Containers contain controls.
 	 */
 	class Container: public virtual InputHandler {
+		friend class Arena;
 		friend class Control;
 
 		public:
@@ -28,6 +29,7 @@ namespace Haunted::UI {
 			Type children;
 		
 		public:
+			Container() { selfContainer = this; }
 			virtual ~Container();
 
 			/** Adds a child to the container. Returns true if successful. */
@@ -13,6 +13,12 @@ namespace Haunted::UI {
 	 * This includes things like boxes, text views and text inputs.
 	 */
 	class Control: public virtual InputHandler, public Child {
+		friend class Arena;
+
+		private:
+			/** Whether the control was made by an Arena, which is then responsible for destroying it. */
+			bool arenaOwned = false;
+
 		protected:
 			/** The control's controlling terminal. */
 			Terminal *terminal;
@@ -27,7 +33,8 @@ namespace Haunted::UI {
 			Haunted::Position position = {};
 
 			/** Sets the margins if needed, executes a function and resets the margins if needed. Returns true if the
-			 *  margins were set. */
+			 *  margins were set. Output that has to stay inside the control should be written with a PaintContext
+			 *  instead, because many terminals ignore horizontal margins. */
 			bool tryMargins(std::function<void()>);
 
 		public:
@@ -38,12 +45,17 @@ namespace Haunted::UI {
 			/** If true, canDraw() will always return false. */
 			bool suppressDraw = false;
 
+			/** Returns whether the control belongs to an Arena and therefore mustn't be deleted. */
+			bool isArenaOwned() const { return arenaOwned; }
+
 			Control() = delete;
 			Control(const Control &) = delete;
 			Control & operator=(const Control &) = delete;
 
 			Control(Container *parent_, const Haunted::Position &position_);
-			Control(const Haunted::Position &position_): Child(nullptr), terminal(nullptr), position(position_) {}
+			Control(const Haunted::Position &position_): Child(nullptr), terminal(nullptr), position(position_) {
+				selfControl = this;
+			}
 			Control(Container *parent_, Terminal *terminal_);
 			Control(Container *parent_);
 
@@ -64,7 +76,8 @@ namespace Haunted::UI {
 			/** Returns whether the control's in a state in which it can be rendered. */
 			virtual bool canDraw() const;
 
-			/** Resizes the control to fit a new position. */
+			/** Resizes the control to fit a new position. Containers also lay out their children. This never renders
+			 *  anything, so a resize of any depth can be followed by a single draw(). */
 			virtual void resize(const Haunted::Position &);
 
 			/** Reassigns the control's current position to itself. Useful for container. */
@@ -81,7 +94,7 @@ namespace Haunted::UI {
 
 			virtual Container * getParent() const { return parent; }
 			virtual Terminal * getTerminal() { return terminal; }
-			void setTerminal(Terminal *terminal_) { terminal = terminal_;  }
+			void setTerminal(Terminal *);
 
 			/** Returns the control's position. */
 			virtual Position getPosition() const { return position; }
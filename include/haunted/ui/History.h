@@ -0,0 +1,146 @@
+#ifndef HAUNTED_UI_HISTORY_H_
+#define HAUNTED_UI_HISTORY_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Haunted {
+	template <typename T>
+	class Future;
+
+	class ThreadPool;
+}
+
+namespace Haunted::UI {
+	/**
+	 * Stores previously submitted lines of input for a TextInput. The history holds at most `capacity` entries,
+	 * discarding the oldest ones once it's full, and never holds the same text twice: resubmitting a line moves it to
+	 * the newest position. Every entry has a sequence ID; IDs increase with each addition and are never reused, and 0
+	 * never refers to an entry.
+	 *
+	 * Substring searches are answered with an index of the byte trigrams in every entry, so a search only has to look
+	 * at the entries that contain the query's rarest trigram.
+	 */
+	class History {
+		public:
+			/**
+			 * Represents an incremental reverse search (as with ^r in readline). Each character added to the query only
+			 * re-examines the entries that matched the query before it.
+			 */
+			class Search {
+				private:
+					struct Level {
+						std::string query;
+						/** Whether candidates holds every match for the query (only possible with three or more bytes). */
+						bool indexed = false;
+						/** The IDs of the entries that match the query, in ascending order. */
+						std::vector<uint64_t> candidates;
+						/** The match currently shown, or 0 if there is none. */
+						uint64_t match = 0;
+					};
+
+					const History &history;
+
+					/** One level per call to push(). The bottom level has an empty query. */
+					std::vector<Level> levels {Level()};
+
+					/** Returns the newest match for the top level no newer than a given ID (0 for no limit). */
+					uint64_t matchAtOrBefore(uint64_t) const;
+
+				public:
+					Search(const History &history_): history(history_) {}
+
+					const std::string & getQuery() const { return levels.back().query; }
+
+					/** Returns the ID of the current match, or 0 if nothing matches. */
+					uint64_t getMatch() const { return levels.back().match; }
+
+					/** Appends text to the query and returns the new match. The match stays on the same entry if it
+					 *  still matches; otherwise the next older match is chosen. */
+					uint64_t push(std::string_view);
+
+					/** Undoes the last push() and returns the match from before it. */
+					uint64_t pop();
+
+					/** Moves to the next older match for the same query. Returns 0 (and keeps the current match) if
+					 *  there isn't one. */
+					uint64_t older();
+			};
+
+		private:
+			size_t capacity;
+			uint64_t nextID = 1;
+
+			/** Maps IDs to entries. The oldest entry comes first. */
+			std::map<uint64_t, std::string> entries;
+
+			/** Maps entries to their IDs. The keys view the strings held by entries, whose nodes never move. */
+			std::unordered_map<std::string_view, uint64_t> ids;
+
+			/** Maps trigrams to the IDs of the entries containing them, in ascending order. Removing an entry leaves its
+			 *  IDs behind; they're skipped during searches and purged once they outnumber the live ones. */
+			std::unordered_map<uint32_t, std::vector<uint64_t>> postings;
+			size_t postingCount = 0, stalePostings = 0;
+
+			/** Returns the distinct trigrams in a string. */
+			static std::vector<uint32_t> trigrams(std::string_view);
+
+			void index(uint64_t, std::string_view);
+			void remove(std::map<uint64_t, std::string>::iterator);
+			void compact();
+
+		public:
+			History(size_t capacity_ = 10000): capacity(capacity_) {}
+
+			/** Adds an entry as the newest. Empty strings are ignored. The text is taken by value, since it may be an
+			 *  entry returned by at() that adding it again removes. */
+			void add(std::string);
+
+			size_t size()  const { return entries.size(); }
+			bool   empty() const { return entries.empty(); }
+			void   clear();
+
+			size_t getCapacity() const { return capacity; }
+			void setCapacity(size_t);
+
+			/** Returns whether an ID refers to an entry that's still in the history. */
+			bool contains(uint64_t id) const { return entries.count(id) != 0; }
+
+			/** Returns the text of an entry. Throws std::out_of_range if the ID is invalid. */
+			const std::string & at(uint64_t) const;
+
+			/** Returns the ID of the newest entry, or 0 if the history is empty. */
+			uint64_t newest() const;
+
+			/** Returns the ID of the entry before or after a given one, or 0 if there isn't one. */
+			uint64_t older(uint64_t) const;
+			uint64_t newer(uint64_t) const;
+
+			/** Returns the IDs of all entries containing a string, in ascending order. */
+			std::vector<uint64_t> find(std::string_view) const;
+
+			/** Returns the ID of the newest entry containing a string that's older than a given ID (0 for no limit),
+			 *  or 0 if there isn't one. This scans backwards from the limit, which suits short queries. */
+			uint64_t findBefore(std::string_view, uint64_t before = 0) const;
+
+			/** Replaces the history with the entries in a file, one per line. Returns false if the file couldn't be
+			 *  opened. */
+			bool load(const std::string &path);
+
+			/** Writes the history to a file, one entry per line. Throws std::runtime_error if writing fails. */
+			void save(const std::string &path) const;
+
+			/** Loads a history from a file on a thread pool (the shared one by default), building its search index off
+			 *  the calling thread. The future holds nullptr if the file couldn't be opened. */
+			static Future<std::shared_ptr<History>> loadInBackground(const std::string &path, size_t capacity,
+				ThreadPool &);
+			static Future<std::shared_ptr<History>> loadInBackground(const std::string &path, size_t capacity = 10000);
+	};
+}
+
+#endif
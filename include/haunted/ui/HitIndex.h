@@ -0,0 +1,63 @@
+#ifndef HAUNTED_UI_HITINDEX_H_
+#define HAUNTED_UI_HITINDEX_H_
+
+#include <vector>
+
+#include "haunted/core/Defs.h"
+
+namespace Haunted::UI {
+	class Control;
+
+	/**
+	 * Maps every cell of the screen to the non-container control that occupies it, so that finding the control under
+	 * the mouse is a single lookup rather than a walk down the control tree.
+	 *
+	 * Resizing or moving a control updates its cells in place. Changes to the structure of the tree (adding, removing
+	 * or swapping out controls) only mark the index as stale; it's rebuilt in one pass the next time it's queried.
+	 */
+	class HitIndex {
+		private:
+			int width = 0, height = 0;
+			bool stale = true;
+
+			/** Whether more than one layer was indexed. Cells can then belong to a control that's hidden below
+			 *  another layer, so they aren't updated in place. */
+			bool layered = false;
+
+			/** The control at each cell, row by row. */
+			std::vector<Control *> cells;
+
+			/** Adds a control's leaves to the index without overwriting cells that are already taken. */
+			void add(Control *);
+
+			/** Clips a position to the screen. Returns false if nothing is left. */
+			bool clip(Position &) const;
+
+		public:
+			/** Changes the dimensions of the screen. This marks the index as stale. */
+			void resize(int width_, int height_);
+
+			int getWidth()  const { return width;  }
+			int getHeight() const { return height; }
+
+			void invalidate() { stale = true; }
+			bool isStale() const { return stale; }
+
+			/** Moves a control's cells after a resize or move. If the control wasn't indexed, the index is marked as
+			 *  stale instead. */
+			void update(Control *, const Position &old_position, const Position &new_position);
+
+			/** Indexes every non-container control reachable from a root control. Controls without a terminal or with a
+			 *  different terminal from their parent's (such as the inactive children of a SwapBox) are skipped. */
+			void rebuild(Control *root);
+
+			/** Indexes several layers of controls, topmost first. Cells taken by a higher layer aren't given to the
+			 *  layers below it. */
+			void rebuild(const std::vector<Control *> &layers);
+
+			/** Returns the control at a cell, or nullptr if there isn't one. */
+			Control * at(int x, int y) const;
+	};
+}
+
+#endif
@@ -7,6 +7,10 @@
 #include "haunted/core/Mouse.h"
 
 namespace Haunted::UI {
+	class Colored;
+	class Container;
+	class Control;
+
 	/**
 	 * An input handler is anything that can handle key presses or mouse events.
 	 * This includes controls and containers.
@@ -15,7 +19,25 @@ namespace Haunted::UI {
 		using   KeyHandler_f = std::function<bool(const Key &)>;
 		using MouseHandler_f = std::function<bool(const MouseReport &)>;
 
+		private:
+			mutable Colored *colored = nullptr;
+
+		protected:
+			/** Set by the Container and Control constructors. These let the library move between the interfaces of an
+			 *  object without dynamic_cast, which is slow across the virtual bases involved. */
+			Container *selfContainer = nullptr;
+			Control *selfControl = nullptr;
+
 		public:
+			/** Returns this object as a container, or nullptr if it isn't one. */
+			Container * asContainer() const { return selfContainer; }
+
+			/** Returns this object as a control, or nullptr if it isn't one. */
+			Control * asControl() const { return selfControl; }
+
+			/** Returns this object as a Colored, or nullptr if it isn't one. A successful lookup is cached. */
+			Colored * asColored() const;
+
 			/** This is a key-handling function that can be changed during runtime to replace on_key. Like on_key, a
 			 *  return value of `true` means the key was handled and a return value of `false` passes the key up the
 			 *  hierarchy. */
@@ -0,0 +1,122 @@
+#ifndef HAUNTED_UI_LISTVIEW_H_
+#define HAUNTED_UI_LISTVIEW_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "haunted/core/Defs.h"
+#include "haunted/core/Key.h"
+#include "haunted/ui/Colored.h"
+#include "haunted/ui/Container.h"
+#include "haunted/ui/Control.h"
+
+namespace Haunted::UI {
+	/**
+	 * Represents a scrollable list of single-row items with an optional selection. The list doesn't store its items:
+	 * it's given a count and a function that returns the text of the item at an index, and it only asks for the items
+	 * that are visible. Drawing, scrolling and moving the selection cost the same for millions of items as for a few.
+	 */
+	class ListView: public Control, public Colored {
+		public:
+			/** Returns the text of the item at an index. */
+			using Accessor_f = std::function<std::string(size_t)>;
+
+			/** The listener receives the list and the index of the item involved. */
+			using Listener_f = std::function<void(const ListView &, size_t)>;
+
+			enum class Event: int {Select = 1, Activate = 2};
+
+			/** The index used for the selection when nothing is selected. */
+			static constexpr size_t NONE = static_cast<size_t>(-1);
+
+		private:
+			size_t count = 0;
+			Accessor_f accessor;
+
+			/** The index of the item on the top row. */
+			size_t top = 0;
+
+			size_t selected = NONE;
+
+			/** Functions to call when the selection changes and when an item is activated (with the return key). */
+			Listener_f onSelect, onActivate;
+
+			/** Returns the number of rows the control has, which is never negative. */
+			size_t rows() const;
+
+			/** Returns the largest index that can be on the top row. */
+			size_t maxTop() const;
+
+			/** Returns the text to display for an item on a given row, cut off or padded to the control's width. */
+			std::string rowText(size_t index) const;
+
+			/** Renders a range of screen rows (relative to the top of the control, inclusive). */
+			void drawRows(size_t first, size_t last);
+
+			/** Redraws an item's row if it's visible. */
+			void drawItem(size_t index);
+
+		public:
+			/** Constructs a ListView with a parent, a position, an item count and an accessor. */
+			ListView(Container *parent, const Position &pos = {}, size_t count = 0, const Accessor_f & = {});
+
+			/** Constructs a ListView with no parent and no items. */
+			ListView(): ListView(nullptr) {}
+
+			/** Replaces the items. The list scrolls back to the top and the selection is cleared. */
+			void setItems(size_t count, const Accessor_f &);
+
+			/** Changes the number of items without changing the accessor, as when items are appended. Only the rows
+			 *  that were empty before are redrawn unless the list has to scroll or the selection has to move. */
+			void setCount(size_t);
+
+			size_t getCount() const { return count; }
+
+			/** Redraws an item after its text has changed. */
+			void invalidate(size_t index) { drawItem(index); }
+
+			size_t getTop() const { return top; }
+
+			/** Scrolls the list so that an item is on the top row. Scrolling by less than a screenful moves the
+			 *  existing rows with the terminal's scrolling region instead of redrawing them. */
+			void setTop(size_t);
+
+			/** Scrolls the list as little as needed to make an item visible. */
+			void scrollTo(size_t index);
+
+			/** Returns the index of the selected item, or NONE if nothing is selected. */
+			size_t getSelected() const { return selected; }
+
+			/** Selects an item (clamped to the last one) and scrolls to it. NONE clears the selection. */
+			void select(size_t);
+
+			/** Sets a function to listen for an event. */
+			void listen(Event, const Listener_f &);
+
+			/** Moves the selection up or down by one item or by a screenful. */
+			void up();
+			void down();
+			void pageUp();
+			void pageDown();
+
+			bool onMouse(const MouseReport &) override;
+
+			/** Handles key presses. */
+			bool onKey(const Key &) override;
+
+			/** Keeps the top row in range after a resize. */
+			virtual void resize(const Position &) override;
+			using Control::resize;
+
+			/** Renders the control onto the terminal. */
+			virtual void draw() override;
+
+			virtual bool canDraw() const override;
+
+			virtual Terminal * getTerminal() override { return terminal; }
+			virtual Container * getParent() const override { return parent; }
+	};
+}
+
+#endif
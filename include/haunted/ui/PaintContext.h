@@ -0,0 +1,76 @@
+#ifndef HAUNTED_UI_PAINTCONTEXT_H_
+#define HAUNTED_UI_PAINTCONTEXT_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "haunted/core/Defs.h"
+
+namespace Haunted {
+	class Terminal;
+}
+
+namespace Haunted::UI {
+	class Control;
+
+	/**
+	 * Draws within a rectangle of the screen (usually a control's position). Coordinates are relative to the top-left
+	 * corner of the rectangle and every jump is absolute, so nothing depends on origin mode. Text is cut off at the
+	 * right edge in software instead of relying on DECSLRM margins, which many terminals don't support.
+	 *
+	 * Margins are only used to scroll the rectangle's contents: vertical margins when the rectangle spans the width of
+	 * the terminal and horizontal margins as well if the terminal says it supports them.
+	 *
+	 * When a context is made for a control, output is also kept out of the parts of the rectangle covered by opaque
+	 * overlays above the control.
+	 */
+	class PaintContext {
+		private:
+			Terminal &terminal;
+			Position position;
+
+			/** The parts of the rectangle (in absolute coordinates) hidden behind overlays. */
+			std::vector<Position> covers;
+
+			/** Returns the runs of columns in a span of a row that aren't covered, as (column, length) pairs. */
+			std::vector<std::pair<int, int>> visibleRuns(int y, int x, int length) const;
+
+		public:
+			PaintContext(Terminal &terminal_, const Position &position_): terminal(terminal_), position(position_) {}
+
+			/** Makes a context that avoids the overlays above a control. */
+			PaintContext(Terminal &, const Position &, const Control *owner);
+
+			const Position & getPosition() const { return position; }
+
+			/** Returns whether the rectangle's left edge is at the left edge of the screen. */
+			bool atLeft() const;
+
+			/** Returns whether the rectangle's right edge is at the right edge of the screen. */
+			bool atRight() const;
+
+			/** Returns whether any of the rectangle is covered by an overlay. */
+			bool isCovered() const { return !covers.empty(); }
+
+			/** Returns whether clear() can erase the rectangle without printing spaces over all of it. */
+			bool clearsCheaply() const { return covers.empty() && (atLeft() || atRight()); }
+
+			/** Writes text on a row starting at a given column. Text past the right edge is cut off. Rows outside the
+			 *  rectangle are ignored. */
+			void write(int x, int y, const std::string &);
+
+			/** Erases a row from a given column to the right edge. */
+			void clearRow(int y, int x = 0);
+
+			/** Erases the entire rectangle. */
+			void clear();
+
+			/** Scrolls the rectangle's contents by a number of rows. Negative numbers scroll up and positive numbers
+			 *  scroll down, as with Terminal::vscroll. Returns false without doing anything if the terminal can't
+			 *  scroll just the rectangle or part of it is covered, in which case the caller has to redraw it. */
+			bool scroll(int rows);
+	};
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef HAUNTED_UI_TABLE_H_
+#define HAUNTED_UI_TABLE_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "haunted/core/Defs.h"
+#include "haunted/core/Key.h"
+#include "haunted/ui/Colored.h"
+#include "haunted/ui/Container.h"
+#include "haunted/ui/Control.h"
+
+namespace Haunted::UI {
+	/**
+	 * Represents a scrollable table with a header row. Like ListView, the table doesn't store its cells: it's given a
+	 * row count and a function that returns the text of a cell, and it only asks for the cells that are visible. Rows
+	 * and columns are both virtualized, so only the columns that fit on the screen are ever formatted.
+	 *
+	 * Rows can be filtered and sorted by a column. The table keeps an index of the visible rows (and, when sorted, a
+	 * copy of each row's sort key) and maintains it as rows are added and cells change, without copying any rows.
+	 * Changing a cell repaints only that cell unless it moves its row.
+	 */
+	class Table: public Control, public Colored {
+		public:
+			/** Returns the text of the cell at a row and column (both in terms of the unfiltered, unsorted data). */
+			using Accessor_f = std::function<std::string(size_t row, size_t column)>;
+
+			/** Returns whether a row should be shown. */
+			using Filter_f = std::function<bool(size_t row)>;
+
+			struct Column {
+				std::string header;
+
+				/** The column's width, or -1 to fit the widest cell displayed so far. */
+				int width = -1;
+
+				/** The largest width a fitted column can grow to, or -1 if there's no limit. */
+				int maximum = -1;
+			};
+
+			/** The index used for rows that aren't shown. */
+			static constexpr size_t NONE = static_cast<size_t>(-1);
+
+		private:
+			std::vector<Column> columns;
+
+			/** The current width of each column. Fitted columns only ever grow until the columns are replaced. */
+			std::vector<int> widths;
+
+			/** The horizontal offset of each visible column within the control, or -1 for columns that aren't
+			 *  visible. Recomputed whenever the widths or the first column change. */
+			std::vector<int> offsets;
+
+			size_t rowCount = 0;
+			Accessor_f accessor;
+			Filter_f filter;
+
+			/** Whether the rows are shown in their original order with nothing filtered out, in which case `order`
+			 *  is empty and unused. */
+			bool identity = true;
+
+			/** The original indices of the visible rows in the order they're shown. */
+			std::vector<size_t> order;
+
+			/** The column the rows are sorted by, or NONE. */
+			size_t sortColumn = NONE;
+			bool ascending = true;
+
+			/** The sort key of every row, indexed by original row. Only kept while the rows are sorted. */
+			std::vector<std::string> sortKeys;
+
+			/** The index (among the visible rows) of the row at the top and the first visible column. */
+			size_t top = 0, firstColumn = 0;
+
+			/** Cells whose repainting has been put off, as (original row, column) pairs. */
+			std::vector<std::pair<size_t, size_t>> dirty;
+			bool deferred = false;
+
+			/** Returns the number of rows available for data below the header, which is never negative. */
+			size_t bodyRows() const;
+
+			/** Returns the largest index that can be on the top row. */
+			size_t maxTop() const;
+
+			/** Compares two rows by their sort keys, breaking ties by their original order. */
+			bool before(size_t left, size_t right) const;
+
+			/** Recomputes the column offsets for the current widths and first column. */
+			void layout();
+
+			/** Widens a fitted column to make room for a cell. Returns true if the column's width changed. */
+			bool fit(size_t column, size_t length);
+
+			/** Rebuilds the order of the visible rows from scratch. */
+			void rebuild();
+
+			/** Returns the rows of the control (counting the header as row 0) a visible row is displayed on, or -1
+			 *  if it's scrolled out of view. */
+			int screenRow(size_t index) const;
+
+			/** Renders the header and a range of data rows (relative to the top of the body, inclusive). */
+			void drawHeader();
+			void drawRows(size_t first, size_t last);
+
+			/** Repaints a single cell if it's visible. The cell is given in terms of the original data. */
+			void drawCell(size_t row, size_t column);
+
+			/** Moves a row after its sort key or filter status may have changed. Returns false if nothing moved. */
+			bool reposition(size_t row);
+
+		public:
+			Table(Container *parent, const Position &pos = {}, const std::vector<Column> & = {}, size_t rows = 0,
+				const Accessor_f & = {});
+
+			Table(): Table(nullptr) {}
+
+			const std::vector<Column> & getColumns() const { return columns; }
+
+			/** Replaces the columns. The widths of fitted columns are measured again as cells are displayed. */
+			void setColumns(const std::vector<Column> &);
+
+			/** Returns the current width of a column. */
+			int getColumnWidth(size_t column) const { return widths.at(column); }
+
+			/** Replaces the data. Any filter and sort order are kept and reapplied. */
+			void setData(size_t rows, const Accessor_f &);
+
+			/** Changes the number of rows without changing the accessor, as when rows are appended. Appended rows are
+			 *  inserted into the existing sort order rather than resorting everything. */
+			void setRowCount(size_t);
+
+			size_t getRowCount() const { return rowCount; }
+
+			/** Returns the number of rows that pass the filter. */
+			size_t getVisibleCount() const { return identity? rowCount : order.size(); }
+
+			/** Converts between the index of a row among the visible rows and its index in the original data.
+			 *  viewRow returns NONE if the row is filtered out. */
+			size_t sourceRow(size_t index) const { return identity? index : order.at(index); }
+			size_t viewRow(size_t row) const;
+
+			/** Tells the table that a cell has changed. The row is moved if the cell affects its position or whether
+			 *  it passes the filter; otherwise only the cell is repainted (or queued if updates are deferred). */
+			void updateCell(size_t row, size_t column);
+
+			/** Tells the table that every cell in a row has changed. */
+			void updateRow(size_t row);
+
+			/** Puts off repainting changed cells until drawUpdates() is called, so that several changes to the same
+			 *  cell are painted once. */
+			void setDeferred(bool);
+			bool isDeferred() const { return deferred; }
+
+			/** Repaints every cell changed since the last call. */
+			void drawUpdates();
+
+			/** Sorts the rows by a column's text. */
+			void sortBy(size_t column, bool ascending = true);
+
+			/** Restores the original order of the rows. */
+			void unsort();
+
+			size_t getSortColumn() const { return sortColumn; }
+
+			/** Sets a function that decides which rows are shown, or clears the filter if the function is empty. */
+			void setFilter(const Filter_f &);
+
+			size_t getTop() const { return top; }
+
+			/** Scrolls the table vertically so that a row is at the top. Scrolling by less than a screenful moves the
+			 *  existing rows with the terminal's scrolling region instead of redrawing them. */
+			void setTop(size_t);
+
+			size_t getFirstColumn() const { return firstColumn; }
+
+			/** Scrolls the table horizontally so that a column is at the left edge. */
+			void setFirstColumn(size_t);
+
+			bool onMouse(const MouseReport &) override;
+
+			/** Handles key presses. */
+			bool onKey(const Key &) override;
+
+			/** Keeps the top row in range after a resize. */
+			virtual void resize(const Position &) override;
+			using Control::resize;
+
+			/** Renders the control onto the terminal. */
+			virtual void draw() override;
+
+			virtual bool canDraw() const override;
+
+			virtual Terminal * getTerminal() override { return terminal; }
+			virtual Container * getParent() const override { return parent; }
+	};
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef HAUNTED_UI_TEXTAREA_H_
+#define HAUNTED_UI_TEXTAREA_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "haunted/core/Defs.h"
+#include "haunted/core/Key.h"
+#include "haunted/ui/Colored.h"
+#include "haunted/ui/Container.h"
+#include "haunted/ui/Control.h"
+#include "lib/PieceTable.h"
+#include "lib/UTF8.h"
+
+namespace Haunted::UI {
+	/**
+	 * Represents a multi-line control that accepts user input. Long lines are wrapped at the right edge of the control.
+	 * The text is stored in a piece table, and only the lines on screen are ever measured, so editing stays fast no
+	 * matter how long the document is. Every codepoint is assumed to be one column wide.
+	 */
+	class TextArea: public Control, public Colored {
+		public:
+			/** The listener receives the control itself rather than a copy of its text, which could be very long. */
+			using Update_f = std::function<void(const TextArea &)>;
+
+			enum class Event: int {Update = 1, Submit = 2};
+
+		private:
+			/** The text that the user has entered so far. */
+			PieceTable text;
+
+			/** The line containing the cursor and the cursor's offset (in codepoints) within it. */
+			size_t cursorLine = 0, cursorColumn = 0;
+
+			/** The screen column the cursor returns to when moving vertically across lines shorter than it. */
+			size_t preferredColumn = 0;
+
+			/** The first line visible at the top of the control and how many of its wrapped rows are scrolled past. */
+			size_t topLine = 0, topRow = 0;
+
+			/** The lengths (in codepoints) of lines that have been displayed or navigated through. Lines are measured
+			 *  only when they're needed. */
+			std::unordered_map<size_t, size_t> lineLengths;
+
+			/** UTF-8 codepoints are received byte by byte. */
+			UTF8::Decoder decoder;
+
+			/** A function to call whenever the text or cursor has changed. */
+			Update_f onUpdate;
+
+			/** A function to call whenever the text is submitted (e.g., the user presses alt+return). */
+			Update_f onSubmit;
+
+			void update();
+			void submit();
+
+			/** Returns the width available for text, which is never zero. */
+			size_t wrapWidth() const;
+
+			/** Returns the length of a line in codepoints. */
+			size_t lineLength(size_t);
+
+			/** Returns the number of rows a line occupies once wrapped. There's always room for the cursor after the
+			 *  last character, so a line exactly as wide as the control takes up two rows. */
+			size_t rowsOf(size_t line);
+
+			/** Forgets the lengths of all lines at or after a given line, for when lines have been added or removed. */
+			void forgetLines(size_t first);
+
+			/** Returns the byte offset of a given column within a given line. */
+			size_t offsetOf(size_t line, size_t column);
+
+			/** Moves a (line, row) pair forward or backward by one wrapped row. Returns false if it couldn't move. */
+			bool nextRow(size_t &line, size_t &row);
+			bool prevRow(size_t &line, size_t &row);
+
+			/** Returns the screen row (relative to the top of the control) of a given wrapped row of a line. Returns 0
+			 *  for positions above the control and the control's height for positions below it. */
+			size_t screenRow(size_t line, size_t row);
+
+			/** Adjusts the scroll so that the cursor is visible. Returns true if the scroll changed. */
+			bool scrollToCursor();
+
+			/** Renders a range of screen rows (relative to the top of the control, inclusive). */
+			void drawRows(size_t first, size_t last);
+
+			/** Re-renders the control after an edit at a given position. If the number of rows didn't change, only the
+			 *  rows of the edited line are repainted; otherwise, everything below the edit moves and is repainted. */
+			void drawEdit(size_t line, size_t column, bool rows_changed);
+
+			/** Inserts UTF-8 text containing a given number of codepoints at the cursor. */
+			void insertText(const std::string &, size_t codepoints);
+
+			/** Erases the text between two positions. The first position must not come after the second. */
+			void eraseRange(size_t first_line, size_t first_column, size_t last_line, size_t last_column);
+
+			/** Moves the cursor to a given position, scrolling if necessary. */
+			void setCursor(size_t line, size_t column, bool keep_preferred = false);
+
+		public:
+			/** Constructs a TextArea with a parent, a position and initial text. */
+			TextArea(Container *parent, const Position &pos, const std::string &text = "");
+
+			/** Constructs a TextArea with a parent, a default position and initial text. */
+			TextArea(Container *parent, const std::string &text = "");
+
+			/** Constructs a TextArea with no parent, no position and no initial contents. */
+			TextArea(): TextArea(nullptr, "") {}
+
+			/** Returns the contents of the control. This copies the entire text. */
+			std::string str() const { return text.str(); }
+			operator std::string() const { return text.str(); }
+
+			/** Returns the text of a given line, without its line feed. */
+			std::string getLine(size_t line) const { return text.line(line); }
+
+			/** Returns the number of lines. */
+			size_t lineCount() const { return text.lineCount(); }
+
+			/** Returns the length of the text in bytes. */
+			size_t size() const { return text.size(); }
+			bool empty() const { return text.empty(); }
+
+			size_t getCursorLine()   const { return cursorLine; }
+			size_t getCursorColumn() const { return cursorColumn; }
+
+			/** Sets a function to listen for updates to the text. */
+			void listen(Event, const Update_f &);
+
+			/** Moves the cursor to a given line and column. Out-of-range values are clamped. */
+			void moveTo(size_t line, size_t column);
+
+			/** Inserts a string at the cursor's position. Invalid UTF-8 is replaced with U+FFFD. */
+			void insert(const std::string &);
+
+			/** Inserts a single byte of UTF-8 input at the cursor's position. */
+			void insert(unsigned char);
+
+			/** Splits the current line at the cursor. */
+			void newline();
+
+			/** Erases the entire text and resets the cursor. */
+			void clear();
+
+			/** Sets the entire text and moves the cursor to the end. */
+			void setText(const std::string &);
+
+			/** Returns the entire text. */
+			std::string getText() const { return text.str(); }
+
+			/** Erases the character before the cursor, joining lines at the start of a line. */
+			void erase();
+
+			/** Erases the character after the cursor, joining lines at the end of a line. */
+			void eraseForward();
+
+			/** Erases the first word before the cursor (^w). */
+			void eraseWord();
+
+			void left();
+			void right();
+
+			/** Moves the cursor up or down by one wrapped row. */
+			void up();
+			void down();
+
+			/** Moves the cursor up or down by a screenful. */
+			void pageUp();
+			void pageDown();
+
+			/** Moves the cursor to the start or end of the current line. */
+			void start();
+			void end();
+
+			/** Moves the cursor to the start or end of the text. */
+			void top();
+			void bottom();
+
+			/** Moves the cursor by one word. Uses the same word-detecting logic as eraseWord(). */
+			void prevWord();
+			void nextWord();
+
+			bool onMouse(const MouseReport &) override;
+
+			/** Handles key presses. */
+			bool onKey(const Key &) override;
+
+			/** Renders the control onto the terminal. */
+			virtual void draw() override;
+
+			virtual bool canDraw() const override;
+
+			/** Focuses the TextArea and jumps to its cursor. */
+			void focus() override;
+
+			/** Moves the terminal cursor to the position of the TextArea cursor. */
+			void jumpCursor();
+
+			virtual void jumpFocus() override;
+
+			/** Moves the terminal cursor to the position of the TextArea cursor if the TextArea is focused. */
+			bool tryJump();
+
+			virtual Terminal * getTerminal() override { return terminal; }
+			virtual Container * getParent() const override { return parent; }
+	};
+}
+
+#endif
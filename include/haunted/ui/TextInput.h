@@ -4,15 +4,19 @@
 #include <cstddef>
 #include <functional>
 #include <list>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_set>
 
+#include "haunted/core/Coroutine.h"
 #include "haunted/core/Defs.h"
 #include "haunted/core/Key.h"
 #include "haunted/ui/Colored.h"
+#include "haunted/ui/Completer.h"
 #include "haunted/ui/Container.h"
 #include "haunted/ui/Control.h"
+#include "haunted/ui/History.h"
 #include "lib/ustring.h"
 
 #include "lib/UTF8.h"
@@ -56,9 +60,34 @@ namespace Haunted::UI {
 			 *  truncated. This field determines how many characters will be truncated on the left. */
 			size_t scroll = 0;
 
-			/** UTF-8 codepoints are received byte by byte. The first byte indicates how long the codepoint will be.
-			 *  This field is set whenever we receive an indication of the codepoint length. */
-			size_t bytesExpected = 0;
+			/** UTF-8 codepoints are received byte by byte. The decoder holds the bytes of an incomplete codepoint until
+			 *  the rest arrive. */
+			UTF8::Decoder decoder;
+
+			/** Supplies candidates for tab completion. */
+			std::shared_ptr<Completer> completer;
+
+			/** Whether the last key was a completion key, in which case another one cycles to the next candidate. */
+			bool completing = false;
+
+			/** The offset where the word being completed starts. */
+			size_t completionStart = 0;
+
+			/** The partial word the user typed before completion started and the candidate currently inserted. */
+			std::string completionPrefix, completionCurrent;
+
+			/** Previously submitted input, browsed with the arrow keys and searched with ^r. */
+			std::shared_ptr<History> history;
+
+			/** The ID of the history entry being shown, or 0 if the buffer isn't showing one. */
+			uint64_t historyID = 0;
+
+			/** The contents of the buffer from before history browsing or searching began. */
+			std::string historyDraft;
+
+			/** The reverse search in progress, if any, and the prefix it temporarily replaced. */
+			std::unique_ptr<History::Search> search;
+			std::string searchSavedPrefix;
 
 			/** A function to call whenever the buffer or cursor has changed. */
 			Update_f onUpdate;
@@ -66,6 +95,9 @@ namespace Haunted::UI {
 			/** A function to call whenever the buffer is submitted (e.g., the user presses return). */
 			Update_f onSubmit;
 
+			/** Coroutines waiting for the next submission. */
+			Signal<std::string> submitWaiters;
+
 			/** Every time the TextInput is redrawn, the screen position of the cursor is recorded. */
 			Point cursorPosition;
 
@@ -93,6 +125,20 @@ namespace Haunted::UI {
 			 *  current position. Returns true if the scroll was changed. */
 			bool checkScroll();
 
+			/** Returns the offset where the word ending at a given offset begins. If skip_spaces is true, spaces
+			 *  immediately before the offset are skipped first, as in prevWord() and eraseWord(). */
+			size_t wordStart(size_t, bool skip_spaces) const;
+
+			/** Shows the state of the reverse search in the prefix and buffer. */
+			void showSearch();
+
+			/** Handles a key press during a reverse search. Returns false if the key ended the search and should be
+			 *  handled normally. */
+			bool onSearchKey(const Key &);
+
+			/** Inserts a decoded codepoint at the cursor, holding back the first half of a regional indicator pair. */
+			void insertCodepoint(char32_t);
+
 #ifndef ENABLE_ICU
 			/** Returns the character to the left of the cursor. */
 			char prevChar();
@@ -122,9 +168,6 @@ namespace Haunted::UI {
 		public:
 			enum class Event: int {Update = 1, Submit = 2};
 
-			/** When a multibyte UTF-8 codepoint is being received, the individual bytes are stored in this buffer. */
-			std::string unicodeByteBuffer;
-
 			/** When a multi-codepoint UTF-8 grapheme is being received, the individual codepoints are stored in this
 			 *  buffer. */
 			std::vector<uint32_t> unicodeCodepointBuffer;
@@ -165,13 +208,17 @@ namespace Haunted::UI {
 			/** Sets a function to listen for updates to the buffer. */
 			void listen(Event, const Update_f &);
 
+			/** Returns an awaitable that resumes the awaiting coroutine with the text of the next submission. The
+			 *  coroutine resumes after the submit listener, while the key press is still being handled. */
+			Signal<std::string>::Awaiter submitted() { return submitWaiters.wait(); }
+
 			/** Returns the cursor's offset. */
 			size_t getCursor() const { return cursor; }
 
 			/** Moves the cursor to a given position. */
 			void moveTo(size_t);
 
-			/** Inserts a string into the buffer at the cursor's position. */
+			/** Inserts a string into the buffer at the cursor's position. Invalid UTF-8 is replaced with U+FFFD. */
 			void insert(const std::string &);
 
 			/** Inserts a single character into the buffer. */
@@ -216,6 +263,33 @@ namespace Haunted::UI {
 			/** Moves the cursor right by one word. Uses the same word-detecting logic as eraseWord(). */
 			void nextWord();
 
+			/** Sets the source of tab completion candidates. Tab and shift+tab are ignored if it's null. */
+			void setCompleter(std::shared_ptr<Completer> completer_) { completer = std::move(completer_); }
+			std::shared_ptr<Completer> getCompleter() const { return completer; }
+
+			/** Replaces the word before the cursor with the next (or previous) matching candidate. Repeated calls
+			 *  without other input in between cycle through the matches. Returns false if nothing matched. */
+			bool complete(bool reverse = false);
+
+			/** Sets the history that the arrow keys and ^r operate on and that submitted input is added to. */
+			void setHistory(std::shared_ptr<History> history_) { history = std::move(history_); }
+			std::shared_ptr<History> getHistory() const { return history; }
+
+			/** Replaces the buffer with the previous or next history entry. Moving past the newest entry restores
+			 *  whatever was in the buffer before browsing began. */
+			void historyUp();
+			void historyDown();
+
+			/** Starts an incremental reverse search through the history. */
+			void startSearch();
+
+			/** Ends the reverse search. If `accept` is true, the match stays in the buffer; otherwise, the buffer is
+			 *  restored to what it was before the search. */
+			void endSearch(bool accept);
+
+			/** Returns whether a reverse search is in progress. */
+			bool searching() const { return search != nullptr; }
+
 			/** Swaps the character to the left of the cursor with the character to the right of the cursor. */
 			void transpose();
 
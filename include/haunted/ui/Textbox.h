@@ -12,6 +12,7 @@
 #include "haunted/core/Terminal.h"
 #include "haunted/core/Util.h"
 
+#include "haunted/ui/PaintContext.h"
 #include "haunted/ui/TextLine.h"
 #include "haunted/ui/SimpleLine.h"
 
@@ -42,10 +43,15 @@ namespace Haunted::UI {
 			/** Whether the textbox should automatically scroll to keep up with lines added to the bottom. */
 			bool autoscroll = false;
 
-			/** Used for locking when doing operations on lines. */
+			/** Used for locking when doing operations on lines. It's left alone if the terminal has a UI thread,
+			 *  because the lines are then only touched from that thread. */
 			std::recursive_mutex line_mutex;
 
-			std::unique_lock<std::recursive_mutex> lockLines() { return std::unique_lock(line_mutex); }
+			std::unique_lock<std::recursive_mutex> lockLines() {
+				if (terminal && terminal->isSingleThreaded())
+					return {};
+				return std::unique_lock(line_mutex);
+			}
 
 			/** Empties the buffer and replaces it with 0-continuation lines from a vector of string. */
 			void setLines(const std::vector<std::string> &strings) {
@@ -75,27 +81,19 @@ namespace Haunted::UI {
 				if (!autoscroll && next < 0)
 					return;
 
-				tryMargins([&, this]() {
-					applyColors();
-
-					// It's assumed that whatever's calling this method will deal with autoscroll on its own.
-
-					// If next < 0, it's because autoscrolling didn't scroll to make space for the line, which means
-					// it's below the visible area. (Maybe above if scrolling up doesn't have a boundary?) Because it's
-					// out of sight, there's no need to print anything. Doing so would overwrite the bottom line with
-					// incorrect text.
-					if (next < 0)
-						return;
-
-					terminal->jump(0, next);
-					for (int row = next, i = 0; row < position.height && i < new_lines; ++row, ++i) {
-						if (i > 0)
-							*terminal << "\n";
-						*terminal << line.textAtRow(position.width, i, true);
-					}
+				// It's assumed that whatever's calling this method will deal with autoscroll on its own.
 
+				// If next < 0, it's because autoscrolling didn't scroll to make space for the line, which means it's
+				// below the visible area. (Maybe above if scrolling up doesn't have a boundary?) Because it's out of
+				// sight, there's no need to print anything. Doing so would overwrite the bottom line with incorrect
+				// text.
+				if (0 <= next) {
+					PaintContext paint(*terminal, position, this);
+					applyColors();
+					for (int row = next, i = 0; row < position.height && i < new_lines; ++row, ++i)
+						paint.write(0, row, line.textAtRow(position.width, i, true));
 					uncolor();
-				});
+				}
 
 				terminal->jumpToFocused();
 			}
@@ -285,31 +283,27 @@ namespace Haunted::UI {
 				auto lock = terminal->lockRender();
 				const int diff = old_voffset - voffset;
 
-				tryMargins([&, this]() {
-					applyColors();
-					terminal->vscroll(diff);
-
-					// If new < old, we need to render newly exposed lines at the top. If old < new, we render at the
-					// bottom.
-					if (voffset < old_voffset) {
-						terminal->jump(0, 0);
-						for (int i = 0; i < diff; ++i) {
-							*terminal << textAtRow(i);
-							if (i < position.height - 1)
-								*terminal << "\n";
-						}
-					} else if (old_voffset < voffset) {
-						terminal->jump(0, position.height + diff);
-						for (int i = position.height + diff; i < position.height; ++i) {
-							*terminal << textAtRow(i);
-							if (i < position.height - 1)
-								*terminal << "\n";
-						}
-					}
+				PaintContext paint(*terminal, position, this);
+				applyColors();
 
+				// Without margins to scroll just this textbox, every row has to be redrawn.
+				if (!paint.scroll(diff)) {
 					uncolor();
-				});
+					draw();
+					return;
+				}
+
+				// If new < old, we need to render newly exposed lines at the top. If old < new, we render at the
+				// bottom.
+				if (voffset < old_voffset) {
+					for (int i = 0; i < diff; ++i)
+						paint.write(0, i, textAtRow(i));
+				} else if (old_voffset < voffset) {
+					for (int i = std::max(position.height + diff, 0); i < position.height; ++i)
+						paint.write(0, i, textAtRow(i));
+				}
 
+				uncolor();
 				terminal->jumpToFocused();
 			}
 
@@ -367,33 +361,29 @@ namespace Haunted::UI {
 				auto lock = terminal->lockRender();
 				auto line_lock = lockLines();
 
-				tryMargins([&, this]() {
-					terminal->hide();
-					clearRect();
-					applyColors();
+				PaintContext paint(*terminal, position, this);
+				terminal->hide();
+				applyColors();
 
-					if (0 <= voffset && totalRows() <= voffset) {
-						// There's no need to draw anything if the box has been scrolled down beyond all its contents.
-					} else {
-						try {
-							std::string text {};
-							text.reserve(position.height * position.width);
-							for (int i = 0; i < position.height; ++i) {
-								if (i != 0)
-									text.push_back('\n');
-								text += textAtRow(i, false);
-							}
-
-							terminal->jump(0, 0);
-							*terminal << text;
-							applyColors();
-						} catch (const std::out_of_range &) {}
-					}
-					
-					uncolor();
-					terminal->show();
-				});
+				// If the textbox can be cleared cheaply, only the text itself needs to be printed afterwards.
+				// Otherwise, padding each row to the full width is cheaper than printing spaces and then the text.
+				const bool pad = !paint.clearsCheaply();
+				if (!pad)
+					paint.clear();
+
+				if (0 <= voffset && totalRows() <= voffset) {
+					// There's no need to draw anything if the box has been scrolled down beyond all its contents.
+					if (pad)
+						paint.clear();
+				} else {
+					try {
+						for (int i = 0; i < position.height; ++i)
+							paint.write(0, i, textAtRow(i, pad));
+					} catch (const std::out_of_range &) {}
+				}
 
+				uncolor();
+				terminal->show();
 				terminal->jumpToFocused();
 			}
 
@@ -476,18 +466,11 @@ namespace Haunted::UI {
 					to_redraw.markDirty();
 					to_redraw.clean(position.width);
 					const int new_lines = lineRows(to_redraw);
-					tryMargins([&, this]() {
-						applyColors();
-
-						terminal->jump(0, next);
-						for (int row = next, i = 0; row < position.height && i < new_lines; ++row, ++i) {
-							if (i > 0)
-								*terminal << "\n";
-							*terminal << to_redraw.textAtRow(position.width, i, true);
-						}
-
-						uncolor();
-					});
+					PaintContext paint(*terminal, position, this);
+					applyColors();
+					for (int row = next, i = 0; row < position.height && i < new_lines; ++row, ++i)
+						paint.write(0, row, to_redraw.textAtRow(position.width, i, true));
+					uncolor();
 				}
 			}
 
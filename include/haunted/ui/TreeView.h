@@ -0,0 +1,199 @@
+#ifndef HAUNTED_UI_TREEVIEW_H_
+#define HAUNTED_UI_TREEVIEW_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "haunted/core/Defs.h"
+#include "haunted/core/Key.h"
+#include "haunted/ui/Colored.h"
+#include "haunted/ui/Container.h"
+#include "haunted/ui/Control.h"
+#include "lib/Fenwick.h"
+
+namespace Haunted::UI {
+	/**
+	 * Represents a scrollable tree of single-row items whose branches can be expanded and collapsed. Children are
+	 * loaded lazily: a provider function is asked for a node's children the first time the node is expanded.
+	 *
+	 * Every node keeps a Fenwick tree of how many rows each of its children's subtrees takes up, so expanding or
+	 * collapsing a node, finding the node on a row and finding the row of a node all take time proportional to the
+	 * node's depth times the logarithm of the number of siblings, no matter how many rows are visible. An expand or
+	 * collapse moves the rows below the node with the terminal's scrolling region and draws only the rows it exposes.
+	 */
+	class TreeView: public Control, public Colored {
+		public:
+			struct Item {
+				std::string text;
+
+				/** Whether the item can have children. Items that can't be expanded aren't given a marker. */
+				bool expandable = false;
+
+				/** An arbitrary value for the provider's use, such as an index into the caller's own data. */
+				size_t data = 0;
+			};
+
+			/** Returns the children of a node. The node is given by its ID; the provider can look up the data it
+			 *  returned for the node with getData(). The invisible root node has the ID ROOT. */
+			using Provider_f = std::function<std::vector<Item>(size_t node)>;
+
+			/** The listener receives the tree and the ID of the node involved. */
+			using Listener_f = std::function<void(const TreeView &, size_t)>;
+
+			enum class Event: int {Select = 1, Activate = 2};
+
+			/** The ID of the invisible node whose children are the top-level items. */
+			static constexpr size_t ROOT = 0;
+
+			/** The ID used for the selection when nothing is selected and returned when there's no such node. */
+			static constexpr size_t NONE = static_cast<size_t>(-1);
+
+		private:
+			struct Node {
+				std::string text;
+				size_t data = 0;
+				size_t parent = NONE;
+
+				/** The node's position among its parent's children. */
+				size_t index = 0;
+
+				/** The depth of the node, with the top-level items at depth 0. */
+				size_t depth = 0;
+
+				bool expandable = false, loaded = false, expanded = false;
+				std::vector<size_t> children;
+
+				/** The number of rows each child's subtree takes up, whether or not this node is expanded. */
+				Fenwick childRows;
+
+				/** The number of rows the node's subtree takes up while its ancestors are expanded. The root isn't
+				 *  shown, so its count covers only its descendants. */
+				size_t rows = 1;
+			};
+
+			/** Nodes are stored by ID, which is their index here. Nodes aren't removed until the provider is replaced. */
+			std::vector<Node> nodes;
+
+			Provider_f provider;
+
+			/** The visible row at the top of the control. */
+			size_t top = 0;
+
+			size_t selected = NONE;
+
+			/** Functions to call when the selection changes and when a node without children is activated. */
+			Listener_f onSelect, onActivate;
+
+			/** Returns the number of rows the control has, which is never negative. */
+			size_t rows() const;
+
+			/** Returns the largest row that can be at the top. */
+			size_t maxTop() const;
+
+			/** Checks that an ID refers to a node other than the root and returns the node. */
+			const Node & at(size_t id) const;
+
+			/** Asks the provider for a node's children. */
+			void load(size_t id);
+
+			/** Adds a change in the number of rows of a node's subtree to the node's ancestors, as far as the first
+			 *  collapsed one. */
+			void propagate(size_t id, ptrdiff_t delta);
+
+			/** Returns the node after one in display order, skipping the children of collapsed nodes. */
+			size_t next(size_t id) const;
+
+			/** Returns the text to display for a node, indented, cut off or padded to the control's width. */
+			std::string rowText(size_t id) const;
+
+			/** Renders a range of screen rows (relative to the top of the control, inclusive). */
+			void drawRows(size_t first, size_t last);
+
+			/** Redraws a node's row if it's visible. */
+			void drawNode(size_t id);
+
+			/** Updates the screen after the subtree of the node on a row gained or lost rows. */
+			void shift(size_t row, ptrdiff_t delta);
+
+		public:
+			/** Constructs a TreeView with a parent, a position and a provider. */
+			TreeView(Container *parent, const Position &pos = {}, const Provider_f & = {});
+
+			/** Constructs a TreeView with no parent and no provider. */
+			TreeView(): TreeView(nullptr) {}
+
+			/** Replaces the provider. Every node is discarded and the top-level items are loaded again. */
+			void setProvider(const Provider_f &);
+
+			/** Shows a node's children, loading them first if they haven't been loaded. */
+			void expand(size_t id);
+
+			/** Hides a node's children. If the selection was among them, the node itself is selected. */
+			void collapse(size_t id);
+
+			void toggle(size_t id);
+			bool isExpanded(size_t id) const { return at(id).expanded; }
+			bool isExpandable(size_t id) const { return at(id).expandable; }
+			bool isLoaded(size_t id) const { return id == ROOT || at(id).loaded; }
+
+			const std::string & getText(size_t id) const { return at(id).text; }
+			size_t getData(size_t id) const { return at(id).data; }
+			size_t getParentNode(size_t id) const { return at(id).parent; }
+			size_t getDepth(size_t id) const { return at(id).depth; }
+
+			/** Returns the IDs of a node's children, which is empty if they haven't been loaded. */
+			const std::vector<size_t> & getChildren(size_t id) const;
+
+			/** Returns the number of nodes loaded so far, excluding the root. */
+			size_t getNodeCount() const { return nodes.size() - 1; }
+
+			/** Returns the number of visible rows. */
+			size_t getRowCount() const { return nodes.front().rows; }
+
+			/** Returns the node on a visible row, or NONE if the row is past the end. */
+			size_t nodeAt(size_t row) const;
+
+			/** Returns the row a node is on, or NONE if one of its ancestors is collapsed. */
+			size_t rowOf(size_t id) const;
+
+			size_t getTop() const { return top; }
+
+			/** Scrolls the tree so that a row is at the top. Scrolling by less than a screenful moves the existing rows
+			 *  with the terminal's scrolling region instead of redrawing them. */
+			void setTop(size_t);
+
+			/** Scrolls the tree as little as needed to make a node visible. */
+			void scrollTo(size_t id);
+
+			/** Returns the ID of the selected node, or NONE if nothing is selected. */
+			size_t getSelected() const { return selected; }
+
+			/** Selects a node, expanding its ancestors if they're collapsed, and scrolls to it. NONE clears the
+			 *  selection. */
+			void select(size_t id);
+
+			/** Sets a function to listen for an event. */
+			void listen(Event, const Listener_f &);
+
+			bool onMouse(const MouseReport &) override;
+
+			/** Handles key presses. */
+			bool onKey(const Key &) override;
+
+			/** Keeps the top row in range after a resize. */
+			virtual void resize(const Position &) override;
+			using Control::resize;
+
+			/** Renders the control onto the terminal. */
+			virtual void draw() override;
+
+			virtual bool canDraw() const override;
+
+			virtual Terminal * getTerminal() override { return terminal; }
+			virtual Container * getParent() const override { return parent; }
+	};
+}
+
+#endif
@@ -3,38 +3,42 @@
 
 #include <deque>
 #include <utility>
+#include <vector>
 
 #include "haunted/ui/Colored.h"
+#include "haunted/ui/boxes/Flex.h"
 #include "haunted/ui/boxes/OrientedBox.h"
 
 namespace Haunted::UI::Boxes {
 	/**
 	 * Represents a box that contains some number of children with fixed sizes
 	 * and one or more children that expand to fill the remaining space.
-	 * The remaining space is distributed equally among those children.
-	 * TODO: possibly create an unholy monstrosity that supports ratios/weights for the expanding children?
+	 * The remaining space is distributed among those children according to their weights (equally by default),
+	 * optionally within minimum and maximum sizes. See Flex for the details.
 	 */
 	class ExpandoBox: public OrientedBox, public Colored {
 		private:
-			/** Returns the sum of all the fixed sizes. */
-			int fixedSum() const;
+			/** The lengths computed by the last layout. Kept around to avoid reallocating on every resize. */
+			std::vector<int> lengths;
 
-			/** Returns the size for the nth expanding child. (If the space available for all the expanding children
-			 *  isn't divisible by the number of expanding children and R is the remainder, then the first R expanding
-			 *  children will have the ceiling of the quotient and the rest will have the floor.) */
-			int expandedSize(int order) const;
+			/** Returns the position of a child with a given offset and size along the box's axis. */
+			Position childPosition(int offset, int size) const;
 
-			/** Resizes a child with a given size. */
-			void resizeChild(Control *child, int offset, int size);
+			/** Computes the lengths of the children for the box's current size. */
+			void layout();
+
+			/** Lays out the children again after their parameters have changed, resizing and redrawing only the ones
+			 *  whose positions changed. The box's own position is unaffected, so its parent needn't be involved. */
+			void relayout();
 
 			template <typename L, typename R>
 			class pair_iterator: public std::iterator<std::forward_iterator_tag, std::pair<L, R>> {
 				private:
 					std::deque<Control *>::iterator child_iterator;
-					std::deque<int>::iterator size_iterator;
+					std::vector<Flex::Item>::iterator size_iterator;
 
 				public:
-					pair_iterator(std::deque<Control *>::iterator c, std::deque<int>::iterator s):
+					pair_iterator(std::deque<Control *>::iterator c, std::vector<Flex::Item>::iterator s):
 						child_iterator(c), size_iterator(s) {}
 
 					std::pair<L &, R &> operator*() const;
@@ -49,8 +53,8 @@ namespace Haunted::UI::Boxes {
 			};
 
 		protected:
-			/** Contains the sizes of all the children. Children that expand have a size of -1. */
-			std::deque<int> sizes;
+			/** Contains the layout parameters of all the children. Children that expand have a size of -1. */
+			std::vector<Flex::Item> items;
 
 		public:
 			using ChildPair = std::pair<Control *, int>;
@@ -66,10 +70,20 @@ namespace Haunted::UI::Boxes {
 			void resize(const Position &) override;
 			void draw() override;
 			int maxChildren() const override { return -1; }
+			/** Changes the size of a child along the box's axis. Only the children that move or change size as a result
+			 *  are resized and redrawn. */
 			bool requestResize(Control *, size_t, size_t) override;
 			virtual bool addChild(Control *) override;
 			virtual bool removeChild(Child *) override;
 			bool addChild(Control *, int size);
+			bool addChild(Control *, const Flex::Item &);
+
+			/** Returns the layout parameters of a child. Throws std::out_of_range if the control isn't a child. */
+			const Flex::Item & getItem(Control *) const;
+
+			/** Changes the layout parameters of a child and lays out the box again, redrawing only the children that
+			 *  moved or changed size. Returns false if the control isn't a child. */
+			bool setItem(Control *, const Flex::Item &);
 
 			virtual Terminal * getTerminal() override { return terminal; }
 			virtual Container * getParent() const override { return parent; }
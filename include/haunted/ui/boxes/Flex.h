@@ -0,0 +1,46 @@
+#ifndef HAUNTED_UI_BOXES_FLEX_H_
+#define HAUNTED_UI_BOXES_FLEX_H_
+
+#include <vector>
+
+namespace Haunted::UI::Boxes {
+	/**
+	 * Divides a length among a row or column of children. Fixed children get their own sizes (clamped to their limits)
+	 * and whatever space is left over is shared among the expanding children in proportion to their weights, with no
+	 * child going below its minimum or above its maximum. Children are laid out in order; if the fixed sizes and
+	 * minimums add up to more than the available length, the children at the end are cut off.
+	 *
+	 * Without minimums or maximums on the expanding children, a layout is computed in two linear passes. Constrained
+	 * expanding children add a sort of their breakpoints, so the cost is at worst O(n log n) in their number.
+	 */
+	class Flex {
+		public:
+			struct Item {
+				/** The child's fixed size, or -1 if it expands. */
+				int size = -1;
+
+				/** The child's share of the leftover space relative to the other expanding children. An expanding child
+				 *  with a weight of zero is given only its minimum. */
+				double weight = 1.0;
+
+				int minimum = 0;
+
+				/** The largest size the child can have, or -1 if there's no limit. */
+				int maximum = -1;
+
+				bool expands() const { return size < 0; }
+			};
+
+			/** Computes the size of each item for a given length and stores them in `out` (which is resized to match).
+			 *  The sizes never add up to more than the length. If the remainder of a proportional split can't be divided
+			 *  evenly, the earlier children get the extra cells. */
+			static void layout(const std::vector<Item> &items, int length, std::vector<int> &out);
+
+		private:
+			/** Returns the level at which the expanding children, each given weight * level cells (clamped to its
+			 *  limits), fill `available` cells. If their maximums add up to less, every child is placed at its maximum. */
+			static double level(const std::vector<Item> &, double available, bool constrained);
+	};
+}
+
+#endif
@@ -1,16 +1,21 @@
 #ifndef HAUNTED_UI_BOXES_PROPOBOX_H_
 #define HAUNTED_UI_BOXES_PROPOBOX_H_
 
-#include "haunted/ui/boxes/Box.h"
-#include "haunted/ui/boxes/DualBox.h"
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "haunted/ui/boxes/Flex.h"
+#include "haunted/ui/boxes/OrientedBox.h"
 #include "haunted/ui/Colored.h"
 
 namespace Haunted::UI::Boxes {
 	/**
-	 * Represents a box whose two children's lengths are determined with a ratio. 
-	 * For example, if the ratio is 1.5, the first child's size will be 1.5x
-	 * the second child's size. For a box size of 5, the first child's size will
-	 * be 3 and the second child's will be 2.
+	 * Represents a box whose children's lengths are proportional to their weights.
+	 * With two children, the weights are usually given as a ratio. For example, if
+	 * the ratio is 1.5, the first child's size will be 1.5x the second child's size.
+	 * For a box size of 5, the first child's size will be 3 and the second child's
+	 * will be 2.
 	 * 
 	 *     size_one = ratio * size_box/(1 + ratio)
 	 *              = size_box - size_two
@@ -19,25 +24,48 @@ namespace Haunted::UI::Boxes {
 	 * 
 	 *     size_two = size_box/(1 + ratio)
 	 */
-	class PropoBox: public DualBox, public Colored {
+	class PropoBox: public OrientedBox, public Colored {
+		private:
+			/** The layout parameters last used for the children. Kept around to avoid reallocating on every resize. */
+			std::vector<Flex::Item> items;
+			std::vector<int> lengths;
+
+			/** Computes the children's lengths for the current size. */
+			void layout();
+
 		protected:
-			PropoBox(Container *, const Position &, double, BoxOrientation);
-			double ratio;
+			PropoBox(Container *, const Position &, BoxOrientation);
+
+			/** Contains the weights of all the children. */
+			std::vector<double> weights;
 
 		public:
+			using ChildPair = std::pair<Control *, double>;
+
 			PropoBox(Container *, double, BoxOrientation, Control * = nullptr, Control * = nullptr,
 				const Position & = {});
-			double getRatio() const { return ratio; }
+			PropoBox(Container *, BoxOrientation, std::initializer_list<ChildPair>, const Position & = {});
+
+			/** Returns the ratio of the first child's weight to the second's. */
+			double getRatio() const;
+			/** Sets the weights of the first two children to the ratio and 1. */
 			void setRatio(const double);
 
+			double getWeight(size_t index) const { return index < weights.size()? weights[index] : 1.0; }
+			void setWeight(size_t index, double);
+
 			using Control::resize;
 			void resize(const Position &) override;
 
 			virtual void draw() override;
-			virtual int maxChildren() const override { return 2; }
-			virtual int sizeOne() const override;
-			virtual int sizeTwo() const override;
-			virtual int getSize() const override;
+			virtual bool addChild(Control *) override;
+			bool addChild(Control *, double weight);
+			virtual bool removeChild(Child *) override;
+
+			/** Returns the length the nth child would have at the box's current size. */
+			int sizeOf(size_t);
+			int sizeOne() { return sizeOf(0); }
+			int sizeTwo() { return sizeOf(1); }
 
 			virtual Terminal * getTerminal() override { return terminal; }
 			virtual Container * getParent() const override { return parent; }
@@ -2,8 +2,11 @@
 #define HAUNTED_UI_BOXES_SWAPBOX_H_
 
 #include <list>
+#include <memory>
 
 #include "haunted/core/Defs.h"
+#include "haunted/core/OffscreenTerminal.h"
+#include "haunted/core/TimerWheel.h"
 #include "haunted/ui/boxes/Box.h"
 #include "haunted/ui/Container.h"
 #include "haunted/ui/Control.h"
@@ -12,21 +15,82 @@ namespace Haunted::UI::Boxes {
 	/**
 	 * Represents a box that contains some number of controls. At most one is active at any given time; the others are
 	 * kept in memory but aren't drawn.
+	 *
+	 * The most recently hidden children keep a frame: when a child is hidden, it's drawn once more onto an offscreen
+	 * terminal and anything it draws while hidden is recorded there too. Activating a child with a frame replays the
+	 * recording instead of drawing the child from scratch. A child whose frame grew past the byte limit, whose size
+	 * changed, whose frame was evicted or whose frame hasn't been recorded yet is drawn normally.
+	 *
+	 * If the terminal has a UI thread, the outgoing child is recorded by a timer after the switch has been flushed, so
+	 * a switch to a child with a frame only costs a replay. Otherwise, it's recorded during the switch.
 	 */
 	class SwapBox: public virtual Box {
+		private:
+			struct Frame {
+				Control *control;
+				std::unique_ptr<OffscreenTerminal> offscreen;
+				/** Whether the child has been drawn onto the offscreen terminal since it was hidden. */
+				bool recorded = false;
+			};
+
+			/** The frames of recently hidden children, most recent first. */
+			std::list<Frame> frames;
+
+			/** An offscreen terminal left over from a replayed frame, kept for the next child to be hidden. */
+			std::unique_ptr<OffscreenTerminal> spare;
+
+			size_t frameCapacity = 4;
+			size_t frameLimit = 1 << 20;
+
+			/** The timer that records the frames of hidden children, and the terminal it was set on. */
+			TimerWheel::Handle recordTimer;
+			Terminal *recordTerminal = nullptr;
+
+			/** Changes the terminal of every descendant of a control whose terminal is `from`. */
+			static void retarget(Control *, Terminal *from, Terminal *to);
+
+			/** Detaches a child from the terminal, recording a frame for it if possible. */
+			void hide(Control *);
+
+			/** Draws every hidden child whose frame hasn't been recorded onto its offscreen terminal. */
+			void record();
+
+			/** Removes a child's frame from the cache and returns its offscreen terminal, or nullptr if it has none.
+			 *  Sets `recorded` to whether the frame was recorded. */
+			std::unique_ptr<OffscreenTerminal> release(Control *, bool &recorded);
+
+			/** Discards a frame and detaches its child from the offscreen terminal. */
+			void drop(std::list<Frame>::iterator);
+
+			/** Writes a frame's recording to the terminal. */
+			void replay(OffscreenTerminal &);
+
 		protected:
 			Control *active = nullptr;
 
 		public:
 			SwapBox(const SwapBox &) = delete;
 			SwapBox(Container *, const Position &, std::initializer_list<Control *> = {});
+			~SwapBox();
 
 			void setActive(Control *);
 			Control * getActive() { return active; }
 
+			/** Returns the number of hidden children that can keep a frame. Zero disables frames. */
+			size_t getFrameCapacity() const { return frameCapacity; }
+			void setFrameCapacity(size_t);
+
+			/** Returns the number of bytes a frame can hold before it's discarded. */
+			size_t getFrameLimit() const { return frameLimit; }
+			void setFrameLimit(size_t);
+
+			/** Returns whether a child currently has a frame. */
+			bool hasFrame(const Control *) const;
+
 			/** Returns the active control if the given coordinates are within the SwapBox's area. */
 			virtual Control * childAtOffset(int x, int y) const override;
 
+			virtual bool removeChild(Child *) override;
 			virtual void resize(const Position &) override;
 			virtual void draw() override;
 			bool onKey(const Key &) override;
@@ -0,0 +1,41 @@
+#ifndef HAUNTED_LIB_FENWICK_H_
+#define HAUNTED_LIB_FENWICK_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace Haunted {
+	/**
+	 * A Fenwick (binary indexed) tree of counts. Changing a count, summing a prefix and finding the element that
+	 * contains a given position in the running total all take logarithmic time.
+	 */
+	class Fenwick {
+		private:
+			/** tree[i] holds the sum of the counts in (i - lowbit(i), i], one-based. tree[0] is unused. */
+			std::vector<size_t> tree {0};
+
+		public:
+			Fenwick() = default;
+			Fenwick(const std::vector<size_t> &counts) { assign(counts); }
+
+			/** Replaces the counts. Takes linear time. */
+			void assign(const std::vector<size_t> &);
+
+			size_t size() const { return tree.size() - 1; }
+
+			/** Adds a (possibly negative) amount to the count at an index. */
+			void add(size_t index, ptrdiff_t delta);
+
+			/** Returns the sum of the first `count` counts. */
+			size_t prefix(size_t count) const;
+
+			/** Returns the sum of all the counts. */
+			size_t total() const { return prefix(size()); }
+
+			/** Returns the number of leading counts whose sum doesn't exceed a value. If every count is positive, this
+			 *  is the index of the element that the value falls in when the counts are laid end to end. */
+			size_t find(size_t value) const;
+	};
+}
+
+#endif
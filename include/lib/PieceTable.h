@@ -0,0 +1,115 @@
+#ifndef HAUNTED_LIB_PIECETABLE_H_
+#define HAUNTED_LIB_PIECETABLE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Haunted {
+	/**
+	 * An editable UTF-8 text buffer for large documents. The text is a sequence of pieces, each referring to a span of
+	 * either the original text or an append-only buffer of added text. The pieces are kept in a treap whose nodes also
+	 * track the total length and number of line feeds in their subtrees, so that inserting, erasing and converting
+	 * between byte offsets and line numbers all take logarithmic time.
+	 */
+	class PieceTable {
+		private:
+			using Index = uint32_t;
+
+			struct Node {
+				Index left = 0, right = 0;
+				uint32_t priority = 0;
+				/** Whether the piece refers to the added buffer rather than the original one. */
+				bool added = false;
+				size_t start = 0, length = 0, feeds = 0;
+				/** The total length and number of line feeds in the subtree rooted at this node. */
+				size_t totalLength = 0, totalFeeds = 0;
+			};
+
+			std::string original, added;
+
+			/** The offsets of every line feed in the original and added buffers. */
+			std::vector<size_t> originalFeeds, addedFeeds;
+
+			/** nodes[0] is a sentinel that stands in for an empty subtree. */
+			std::vector<Node> nodes {Node()};
+			std::vector<Index> freeNodes;
+			Index root = 0;
+			uint32_t seed = 0x9e3779b9;
+
+			/** The piece that was most recently inserted, if it still ends where the added buffer does. Typing extends
+			 *  it in place instead of creating a new piece for every character. */
+			Index lastInsert = 0;
+
+			/** The offset in the text at which lastInsert ends. */
+			size_t lastInsertEnd = 0;
+
+			const std::string & bufferOf(const Node &node) const { return node.added? added : original; }
+			const std::vector<size_t> & feedsOf(bool added_) const { return added_? addedFeeds : originalFeeds; }
+
+			/** Counts the line feeds in a span of one of the buffers. */
+			size_t countFeeds(bool added_, size_t start, size_t length) const;
+
+			Index allocate(bool added_, size_t start, size_t length);
+			void release(Index);
+			void pull(Index);
+			Index merge(Index, Index);
+
+			/** Splits a subtree so that the first part contains exactly `offset` bytes, cutting a piece in two if
+			 *  necessary. */
+			void split(Index, size_t offset, Index &first, Index &second);
+
+			/** Appends the bytes in [from, to) that fall within a subtree starting at a given offset. */
+			void appendTo(Index, size_t from, size_t to, size_t subtree_start, std::string &) const;
+
+			/** Lengthens the piece most recently inserted, which ends at a given offset, after text was stored right
+			 *  after it in the added buffer. */
+			void grow(Index, size_t offset, size_t length, size_t feeds);
+
+			/** Appends text to the added buffer and records its line feeds. Returns the offset it was stored at. */
+			size_t store(std::string_view);
+
+		public:
+			PieceTable(std::string_view = {});
+
+			/** Returns the length of the text in bytes. */
+			size_t size() const { return nodes[root].totalLength; }
+			bool empty() const { return size() == 0; }
+
+			/** Returns the number of lines. A text without line feeds has one line. */
+			size_t lineCount() const { return nodes[root].totalFeeds + 1; }
+
+			/** Returns the byte offset at which a given line starts. Lines past the end start at size(). */
+			size_t lineStart(size_t line) const;
+
+			/** Returns the byte offset of the line feed that ends a given line, or size() for the last line. */
+			size_t lineEnd(size_t line) const;
+
+			/** Returns the index of the line containing a given byte offset. */
+			size_t lineOf(size_t offset) const;
+
+			/** Returns the text of a given line without its line feed. */
+			std::string line(size_t) const;
+
+			/** Returns up to `length` bytes starting at a given offset. */
+			std::string substr(size_t offset, size_t length = std::string::npos) const;
+
+			/** Returns the entire text. */
+			std::string str() const { return substr(0); }
+
+			/** Inserts text at a given byte offset. Throws std::out_of_range if the offset is past the end. */
+			void insert(size_t offset, std::string_view);
+
+			/** Erases up to `length` bytes starting at a given offset. */
+			void erase(size_t offset, size_t length);
+
+			/** Replaces the entire text. */
+			void assign(std::string_view);
+
+			/** Returns the number of pieces the text is split into. */
+			size_t pieceCount() const { return nodes.size() - 1 - freeNodes.size(); }
+	};
+}
+
+#endif
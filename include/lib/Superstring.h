@@ -1,61 +1,152 @@
 #ifndef HAUNTED_LIB_SUPERSTRING_H_
 #define HAUNTED_LIB_SUPERSTRING_H_
 
-#include <list>
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Haunted {
-	/** Represents a character made of any number of codepoints. */
-	using Superchar = std::string;
+	/** Represents a character made of any number of codepoints. Characters of up to eight bytes (which covers every
+	 *  single codepoint and most short grapheme clusters) are stored inline; longer ones spill onto the heap. */
+	class Superchar {
+		private:
+			static constexpr size_t inlineCapacity = 8;
+
+			uint32_t length_ = 0;
+
+			union {
+				char small[inlineCapacity];
+				char *large;
+			};
+
+			bool isInline() const { return length_ <= inlineCapacity; }
+			void assign(const char *, size_t);
+			void release();
+
+		public:
+			Superchar(): small() {}
+			Superchar(const char *data, size_t len): Superchar() { assign(data, len); }
+			Superchar(std::string_view view): Superchar(view.data(), view.size()) {}
+			Superchar(const std::string &str): Superchar(str.data(), str.size()) {}
+			Superchar(const char *str): Superchar(std::string_view(str)) {}
+			Superchar(size_t n, char ch): Superchar(std::string(n, ch)) {}
+			Superchar(const Superchar &other): Superchar(other.data(), other.size()) {}
+			Superchar(Superchar &&) noexcept;
+			~Superchar() { release(); }
+
+			Superchar & operator=(const Superchar &);
+			Superchar & operator=(Superchar &&) noexcept;
+
+			const char * data() const { return isInline()? small : large; }
+			size_t size()   const { return length_; }
+			size_t length() const { return length_; }
+			bool empty() const { return length_ == 0; }
+
+			std::string str() const { return std::string(data(), length_); }
+			operator std::string() const { return str(); }
+			operator std::string_view() const { return {data(), length_}; }
+
+			bool operator==(std::string_view other) const { return std::string_view(*this) == other; }
+			bool operator!=(std::string_view other) const { return std::string_view(*this) != other; }
+			bool operator==(const char *other) const { return *this == std::string_view(other); }
+			bool operator!=(const char *other) const { return *this != std::string_view(other); }
+			bool operator==(const std::string &other) const { return *this == std::string_view(other); }
+			bool operator!=(const std::string &other) const { return *this != std::string_view(other); }
+			bool operator==(const Superchar &other) const { return *this == std::string_view(other); }
+			bool operator!=(const Superchar &other) const { return *this != std::string_view(other); }
+
+			friend std::ostream & operator<<(std::ostream &, const Superchar &);
+	};
 
 	/** Used for creating an easily editable string that can accommodate characters containing multiple codepoints (such
-	 *  as some emoji). */
+	 *  as some emoji). The text is kept in one contiguous UTF-8 buffer alongside the byte length of each character and
+	 *  the byte offset of every `stride`th character, so indexing never has to walk more than `stride` lengths. */
 	class Superstring {
 		private:
-			std::list<Superchar> chunks;
-			using iterator = decltype(chunks)::iterator;
+			/** The distance (in characters) between consecutive entries in `marks`. */
+			static constexpr size_t stride = 64;
 
-			iterator nth(size_t);
+			/** The concatenated UTF-8 text of every character. */
+			std::string bytes;
+
+			/** The length in bytes of each character. */
+			std::vector<uint8_t> widths;
+
+			/** marks[k] is the byte offset of character k * stride. */
+			std::vector<uint32_t> marks {0};
+
+			/** Returns the byte offset at which a given character starts. The index may be equal to size(). */
+			size_t offsetOf(size_t) const;
+
+			/** Recomputes the marks at and after the one covering a given character index. */
+			void reindex(size_t);
 
 		public:
+			class iterator {
+				private:
+					const Superstring *owner;
+					size_t index, offset;
+
+				public:
+					iterator(const Superstring *owner_, size_t index_, size_t offset_):
+						owner(owner_), index(index_), offset(offset_) {}
+
+					std::string_view operator*() const;
+					iterator & operator++();
+					iterator operator++(int);
+					bool operator==(const iterator &other) const { return index == other.index; }
+					bool operator!=(const iterator &other) const { return index != other.index; }
+			};
+
 			/** Assembles a new superstring from a UTF-8 string. */
 			Superstring(const std::string &);
 			Superstring(const char *str): Superstring(std::string(str)) {}
 			Superstring(char ch, size_t n = 1): Superstring(std::string(n, ch)) {}
+			Superstring(): Superstring(std::string()) {}
 
-			/** Joins the substrings into a single string. */
-			std::string str() const;
+			/** Returns the underlying UTF-8 string. */
+			const std::string & str() const { return bytes; }
 
 			/** Converts the superstring into a string. */
-			operator std::string() const { return str(); }
+			operator std::string() const { return bytes; }
+
+			/** Returns a copy of the character at a given index. The index isn't checked. */
+			Superchar operator[](size_t) const;
+
+			/** Returns a copy of the character at a given index. Throws std::out_of_range if the index is invalid. */
+			Superchar at(size_t) const;
 
-			/** Accesses a substring. */
-			Superchar & operator[](ssize_t);
+			/** Returns a view of the bytes of the character at a given index. The view is invalidated by any change to
+			 *  the superstring. */
+			std::string_view view(size_t) const;
 
-			/** Accesses a substring. */
-			Superchar & at(size_t);
+			/** Replaces the character at a given index. */
+			void set(size_t, const Superchar &);
 
-			std::string substr(size_t, size_t) const;
+			/** Returns up to n characters starting at a given character index. */
+			std::string substr(size_t, size_t = std::string::npos) const;
 			void insert(size_t, const Superchar &);
 			void insert(size_t, char);
 			Superstring & erase(size_t = 0, size_t = std::string::npos);
 
 			void dbg();
 
-			iterator begin() { return chunks.begin(); }
-			iterator end()   { return chunks.end(); }
+			iterator begin() const { return {this, 0, 0}; }
+			iterator end()   const { return {this, size(), bytes.size()}; }
 
-			/** Returns the number of substrings. */
-			size_t size()   const { return chunks.size(); }
-			size_t length() const { return chunks.size(); }
+			/** Returns the number of characters. */
+			size_t size()   const { return widths.size(); }
+			size_t length() const { return widths.size(); }
 
 			/** Returns whether the superstring is empty. */
-			bool empty() const { return chunks.empty(); }
+			bool empty() const { return widths.empty(); }
 
-			/** Returns the sum of all the substrings' lengths. */
-			size_t textLength() const;
+			/** Returns the sum of all the characters' lengths. */
+			size_t textLength() const { return bytes.size(); }
 
-			void clear() { chunks.clear(); }
+			void clear();
 	};
 }
 
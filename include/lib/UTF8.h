@@ -2,15 +2,71 @@
 #define HAUNTED_LIB_UTF8_H_
 
 #include <cstdlib>
+#include <string>
+#include <string_view>
 
 #include "lib/Superstring.h"
 
 namespace Haunted {
+	/**
+	 * UTF-8 helpers. Bulk validation and decoding use SSE2 or AVX2 when the CPU supports them (chosen once at runtime)
+	 * and fall back to portable scalar code otherwise. Invalid input is never rejected: every maximal invalid
+	 * subsequence is replaced with a single U+FFFD, following the WHATWG encoding standard.
+	 */
 	class UTF8 {
 		public:
+			static constexpr char32_t replacement = 0xfffd;
+
+			/**
+			 * Decodes UTF-8 that arrives one byte at a time, such as keyboard input.
+			 */
+			class Decoder {
+				private:
+					char32_t codepoint = 0;
+					unsigned char needed = 0, seen = 0, lower = 0x80, upper = 0xbf;
+
+				public:
+					/** Feeds a byte to the decoder and stores any completed codepoints in `out`.
+					 *  @return The number of codepoints produced (zero, one or two). */
+					int feed(unsigned char, char32_t out[2]);
+
+					/** Returns whether the decoder is in the middle of a multibyte sequence. */
+					bool pending() const { return needed != 0; }
+
+					/** Abandons any partial sequence. Returns true if there was one, in which case the caller should
+					 *  treat it as a single U+FFFD. */
+					bool finish();
+			};
+
 			/** Determines the expected codepoint width for a given start byte.
 			 *  @return The expected width in bytes if the byte is a valid starting byte; 0 otherwise. */
 			static size_t width(unsigned char);
+
+			/** Returns the name of the instruction set used for bulk operations ("avx2", "sse2" or "scalar"). */
+			static const char * implementation();
+
+			/** Returns the number of bytes at the start of a string before the first non-ASCII byte. */
+			static size_t asciiPrefix(std::string_view);
+
+			/** Returns whether a string is entirely valid UTF-8. */
+			static bool isValid(std::string_view);
+
+			/** Decodes UTF-8 into UTF-32. `out` must have room for at least `in.size()` codepoints.
+			 *  @return The number of codepoints written. */
+			static size_t decode(std::string_view in, char32_t *out);
+
+			/** Decodes UTF-8 into UTF-16. `out` must have room for at least `in.size()` code units.
+			 *  @return The number of code units written. */
+			static size_t decode(std::string_view in, char16_t *out);
+
+			static std::u32string decode32(std::string_view);
+			static std::u16string decode16(std::string_view);
+
+			/** Appends the UTF-8 encoding of a codepoint to a string. Invalid codepoints are encoded as U+FFFD. */
+			static void encode(char32_t, std::string &);
+
+			/** Returns a copy of a string with all invalid sequences replaced by U+FFFD. */
+			static std::string sanitize(std::string_view);
 	};
 }
 
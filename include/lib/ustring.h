@@ -9,6 +9,7 @@ namespace Haunted {
 #else
 
 #include <string>
+#include <string_view>
 
 #include <unicode/ustring.h>
 #include <unicode/brkiter.h>
@@ -31,6 +32,8 @@ namespace Haunted {
 			size_t & scanLength();
 			ustring(const char * = "");
 			ustring(const std::string &);
+			/** Decodes UTF-8, replacing invalid sequences with U+FFFD. */
+			explicit ustring(std::string_view);
 			ustring(const icu::UnicodeString &);
 			~ustring();
 
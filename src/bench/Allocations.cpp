@@ -0,0 +1,44 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "haunted/bench/Bench.h"
+
+// The benchmark binary replaces the global allocation functions so that scenarios can report how much they allocate.
+// The array and sized forms fall back on these by default.
+
+namespace {
+	std::atomic<size_t> count {0}, bytes {0}, frees {0};
+}
+
+void * operator new(size_t size) {
+	count.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *pointer = std::malloc(size == 0? 1 : size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	if (pointer)
+		frees.fetch_add(1, std::memory_order_relaxed);
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+
+namespace Haunted::Bench {
+	size_t allocationCount() {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	size_t allocatedBytes() {
+		return bytes.load(std::memory_order_relaxed);
+	}
+
+	size_t liveAllocations() {
+		return count.load(std::memory_order_relaxed) - frees.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <numeric>
+
+#include "haunted/bench/Bench.h"
+
+namespace Haunted::Bench {
+	namespace {
+		std::string quote(const std::string &str) {
+			std::string out = "\"";
+			for (const char ch: str) {
+				switch (ch) {
+					case '"':  out += "\\\""; break;
+					case '\\': out += "\\\\"; break;
+					case '\n': out += "\\n";  break;
+					case '\t': out += "\\t";  break;
+					default:
+						if (0 <= ch && ch < 0x20) {
+							char escaped[7];
+							std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+							out += escaped;
+						} else {
+							out += ch;
+						}
+				}
+			}
+
+			return out + "\"";
+		}
+
+		double cpuMillis() {
+			timespec now;
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+			return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+		}
+
+		double median(std::vector<double> samples) {
+			if (samples.empty())
+				return 0;
+			std::sort(samples.begin(), samples.end());
+			const size_t count = samples.size();
+			return count % 2? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+		}
+	}
+
+
+// Private static methods
+
+
+	double Runner::timeBatch(const Function &fn, size_t batch) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < batch; ++i)
+			fn();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Stats Runner::summarize(std::vector<double> samples) {
+		Stats stats;
+		if (samples.empty())
+			return stats;
+
+		std::sort(samples.begin(), samples.end());
+		const size_t count = samples.size();
+		stats.min = samples.front();
+		stats.max = samples.back();
+		stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / count;
+		stats.median = median(samples);
+
+		double squares = 0;
+		for (const double sample: samples)
+			squares += (sample - stats.mean) * (sample - stats.mean);
+		stats.stddev = 1 < count? std::sqrt(squares / (count - 1)) : 0;
+		return stats;
+	}
+
+
+// Public instance methods
+
+
+	void ScenarioResult::begin() {
+		startAllocations = allocationCount();
+		startAllocated = Bench::allocatedBytes();
+		startCPU = Bench::cpuMillis();
+		startWall = std::chrono::steady_clock::now();
+		measuring = true;
+	}
+
+	void ScenarioResult::end() {
+		wallMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startWall).count();
+		cpuMillis = Bench::cpuMillis() - startCPU;
+		allocations = allocationCount() - startAllocations;
+		allocatedBytes = Bench::allocatedBytes() - startAllocated;
+		measuring = false;
+	}
+
+	bool Runner::selected(const std::string &name) const {
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+
+	void Runner::run(const std::string &name, const Function &fn, size_t operations, const Function &setup) {
+		if (!selected(name))
+			return;
+
+		operations = std::max<size_t>(operations, 1);
+		const double min_nanos = std::chrono::duration<double, std::nano>(minTime).count();
+
+		// Keep doubling the batch until it takes long enough to time reliably.
+		size_t batch = 1;
+		for (;;) {
+			if (setup)
+				setup();
+			const double elapsed = timeBatch(fn, batch);
+			if (min_nanos <= elapsed)
+				break;
+			// Once a batch takes long enough for its time to mean something, jump straight to the estimated size.
+			const size_t doubled = batch * 2;
+			batch = 1000 < elapsed? std::max(doubled, size_t(batch * min_nanos / elapsed * 1.1)) : doubled;
+		}
+
+		for (size_t i = 0; i < warmups; ++i) {
+			if (setup)
+				setup();
+			timeBatch(fn, batch);
+		}
+
+		std::vector<double> samples;
+		samples.reserve(repetitions);
+		for (size_t i = 0; i < repetitions; ++i) {
+			if (setup)
+				setup();
+			samples.push_back(timeBatch(fn, batch) / double(batch * operations));
+		}
+
+		Result &result = results.emplace_back();
+		result.name = name;
+		result.operations = operations;
+		result.batch = batch;
+		result.repetitions = repetitions;
+		result.nanos = summarize(std::move(samples));
+
+		if (progress) {
+			*progress << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(14) << result.nanos.median << " ns/op" << std::endl;
+		}
+	}
+
+	void Runner::scenario(const std::string &name, const std::function<void(ScenarioResult &)> &fn) {
+		if (!selected(name))
+			return;
+
+		for (size_t i = 0; i < warmups; ++i) {
+			ScenarioResult discarded;
+			fn(discarded);
+		}
+
+		ScenarioResult result;
+		std::vector<double> cpu_samples, wall_samples;
+		for (size_t i = 0; i < std::max<size_t>(repetitions, 1); ++i) {
+			result = ScenarioResult();
+			result.begin();
+			fn(result);
+			if (result.measuring)
+				result.end();
+			cpu_samples.push_back(result.cpuMillis);
+			wall_samples.push_back(result.wallMillis);
+		}
+
+		result.name = name;
+		result.repetitions = cpu_samples.size();
+		result.cpuMillis = median(std::move(cpu_samples));
+		result.wallMillis = median(std::move(wall_samples));
+		scenarioResults.push_back(result);
+
+		if (progress) {
+			*progress << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(14) << result.cpuMillis << " ms CPU" << std::endl;
+		}
+	}
+
+	void Runner::skip(const std::string &name, const std::string &reason) {
+		if (!selected(name))
+			return;
+
+		skippedNames.push_back(name);
+		if (progress)
+			*progress << std::left << std::setw(48) << name << std::right << "skipped: " << reason << std::endl;
+	}
+
+	void Runner::writeJSON(std::ostream &out) const {
+		out << "{\n"
+			<< "  \"warmups\": " << warmups << ",\n"
+			<< "  \"repetitions\": " << repetitions << ",\n"
+			<< "  \"min_time_ns\": " << minTime.count() << ",\n"
+			<< "  \"unit\": \"ns/op\",\n"
+			<< "  \"results\": [";
+
+		const auto old_flags = out.flags();
+		const auto old_precision = out.precision();
+		out << std::fixed << std::setprecision(3);
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result &result = results[i];
+			out << (i == 0? "\n" : ",\n")
+				<< "    {\"name\": " << quote(result.name)
+				<< ", \"operations\": " << result.operations
+				<< ", \"batch\": " << result.batch
+				<< ", \"repetitions\": " << result.repetitions
+				<< ", \"mean\": " << result.nanos.mean
+				<< ", \"median\": " << result.nanos.median
+				<< ", \"stddev\": " << result.nanos.stddev
+				<< ", \"min\": " << result.nanos.min
+				<< ", \"max\": " << result.nanos.max
+				<< ", \"ops_per_sec\": " << result.operationsPerSecond() << "}";
+		}
+
+		out << (results.empty()? "],\n" : "\n  ],\n") << "  \"scenarios\": [";
+		for (size_t i = 0; i < scenarioResults.size(); ++i) {
+			const ScenarioResult &result = scenarioResults[i];
+			out << (i == 0? "\n" : ",\n")
+				<< "    {\"name\": " << quote(result.name)
+				<< ", \"repetitions\": " << result.repetitions
+				<< ", \"cpu_ms\": " << result.cpuMillis
+				<< ", \"wall_ms\": " << result.wallMillis
+				<< ", \"frames\": " << result.frames
+				<< ", \"bytes\": " << result.bytes
+				<< ", \"allocations\": " << result.allocations
+				<< ", \"allocated_bytes\": " << result.allocatedBytes << "}";
+		}
+
+		out.flags(old_flags);
+		out.precision(old_precision);
+		out << (scenarioResults.empty()? "],\n" : "\n  ],\n") << "  \"skipped\": [";
+		for (size_t i = 0; i < skippedNames.size(); ++i)
+			out << (i == 0? "" : ", ") << quote(skippedNames[i]);
+		out << "]\n}\n";
+	}
+
+	void Runner::writeTable(std::ostream &out) const {
+		size_t width = 4;
+		for (const Result &result: results)
+			width = std::max(width, result.name.size());
+		for (const ScenarioResult &result: scenarioResults)
+			width = std::max(width, result.name.size());
+
+		const auto old_flags = out.flags();
+		const auto old_precision = out.precision();
+		out << std::fixed << std::setprecision(1);
+		if (!results.empty()) {
+			out << std::left << std::setw(width) << "name" << std::right << std::setw(14) << "median ns"
+				<< std::setw(14) << "mean ns" << std::setw(10) << "stddev" << std::setw(14) << "min ns" << "\n";
+		}
+
+		for (const Result &result: results) {
+			const Stats &nanos = result.nanos;
+			const double relative = nanos.mean == 0? 0 : nanos.stddev / nanos.mean * 100;
+			out << std::left << std::setw(width) << result.name << std::right << std::setw(14) << nanos.median
+				<< std::setw(14) << nanos.mean << std::setw(9) << relative << "%" << std::setw(14) << nanos.min << "\n";
+		}
+
+		if (!scenarioResults.empty()) {
+			if (!results.empty())
+				out << "\n";
+			out << std::left << std::setw(width) << "scenario" << std::right << std::setw(14) << "CPU ms"
+				<< std::setw(14) << "wall ms" << std::setw(10) << "frames" << std::setw(14) << "bytes/frame"
+				<< std::setw(14) << "allocs/frame" << "\n";
+			for (const ScenarioResult &result: scenarioResults) {
+				const double frames = std::max<size_t>(result.frames, 1);
+				out << std::left << std::setw(width) << result.name << std::right << std::setw(14) << result.cpuMillis
+					<< std::setw(14) << result.wallMillis << std::setw(10) << result.frames << std::setw(14)
+					<< result.bytes / frames << std::setw(14) << result.allocations / frames << "\n";
+			}
+		}
+
+		out.flags(old_flags);
+		out.precision(old_precision);
+	}
+}
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "haunted/bench/Bench.h"
+#include "haunted/core/CSI.h"
+#include "haunted/core/Key.h"
+#include "haunted/core/Mouse.h"
+#include "haunted/core/OffscreenTerminal.h"
+#include "haunted/ui/boxes/SimpleBox.h"
+#include "haunted/ui/SimpleLine.h"
+#include "haunted/ui/Textbox.h"
+#include "lib/ustring.h"
+
+namespace Haunted::Bench {
+	namespace {
+		/** A textbox that exposes the internals the benchmarks measure and can be filled without drawing. */
+		class BenchBox: public UI::DequeBox {
+			public:
+				using UI::DequeBox::DequeBox;
+				using UI::DequeBox::lineAtRow;
+				using UI::DequeBox::textAtRow;
+
+				/** Appends lines directly, without scrolling or drawing. */
+				void fill(size_t count) {
+					for (size_t i = 0; i < count; ++i)
+						lines.push_back(std::make_shared<UI::SimpleLine<std::deque>>(sampleLine(i), 4));
+					rowsDirty();
+				}
+
+				/** Removes the oldest line the way a client with a limited scrollback would. */
+				void trim() {
+					const int removed = lineRows(*lines.front());
+					lines.pop_front();
+					voffset = std::max(0, voffset - removed);
+					rowsDirty();
+				}
+
+				/** Returns a line of text. Every seventh line is long enough to wrap a few times at 80 columns. */
+				static std::string sampleLine(size_t index) {
+					std::string line = "<user" + std::to_string(index % 17) + "> message number " + std::to_string(index);
+					if (index % 7 == 0)
+						for (int i = 0; i < 4; ++i)
+							line += " and some more text to make the line wrap across the width of the textbox";
+					return line;
+				}
+		};
+
+		/** Returns a string of a given length with some color codes mixed in. */
+		std::string coloredText(size_t length) {
+			std::string text;
+			for (size_t i = 0; text.size() < length; ++i) {
+				if (i % 9 == 0)
+					text += "\e[3" + std::to_string(i % 8) + "m";
+				text += "word" + std::to_string(i) + " ";
+			}
+
+			return text;
+		}
+	}
+
+	void textbox(Runner &runner) {
+		for (const size_t depth: {100UL, 10'000UL, 100'000UL}) {
+			const std::string suffix = "/depth=" + std::to_string(depth);
+			const std::vector<std::string> names {"append", "scroll", "draw", "lineAtRow", "textAtRow"};
+			// Don't bother filling a textbox if none of its benchmarks are going to run.
+			if (std::none_of(names.begin(), names.end(), [&](const std::string &name) {
+				return runner.selected("textbox/" + name + suffix);
+			}))
+				continue;
+
+			OffscreenTerminal screen(24, 80);
+			UI::Boxes::SimpleBox root(&screen);
+			root.resize({0, 0, 80, 24});
+			BenchBox *box = new BenchBox(&root, {0, 0, 80, 24}, {});
+			box->setAutoscroll(true);
+			box->fill(depth);
+			box->setVoffset(std::max(0, box->totalRows() - 24));
+
+			auto clear = [&] { screen.clearRecording(); };
+			size_t counter = depth;
+			runner.run("textbox/append" + suffix, [&] {
+				*box += BenchBox::sampleLine(counter++);
+				box->trim();
+			}, 1, clear);
+
+			const int middle = box->totalRows() / 2;
+			bool up = true;
+			runner.run("textbox/scroll" + suffix, [&] {
+				box->vscroll(up? -1 : 1);
+				up = !up;
+			}, 1, [&] {
+				clear();
+				box->setVoffset(middle);
+			});
+
+			runner.run("textbox/draw" + suffix, [&] { box->draw(); }, 1, clear);
+
+			runner.run("textbox/lineAtRow" + suffix, [&] {
+				keep(box->lineAtRow(box->totalRows() - 1));
+			});
+
+			runner.run("textbox/textAtRow" + suffix, [&] { keep(box->textAtRow(23)); });
+		}
+	}
+
+	void textLine(Runner &runner) {
+		const std::string text = coloredText(1000);
+		for (const int width: {40, 80, 200}) {
+			const std::string suffix = "/width=" + std::to_string(width);
+
+			// A line that's cleaning bypasses its cache, so these measure the wrapping itself.
+			UI::SimpleLine<std::deque> raw(text, 6);
+			raw.cleaning = true;
+			const int rows = raw.numRows(width);
+			runner.run("textline/numRows" + suffix, [&] { keep(raw.numRows(width)); });
+			runner.run("textline/textAtRow" + suffix, [&] { keep(raw.textAtRow(width, rows / 2)); });
+
+			// Rewrapping is what happens to every line when a textbox is resized.
+			UI::SimpleLine<std::deque> cached(text, 6);
+			runner.run("textline/rewrap" + suffix, [&] {
+				cached.markDirty();
+				keep(cached.numRows(width));
+			});
+		}
+	}
+
+	void ustring(Runner &runner) {
+		// Without ICU, ustring is std::string, so these measure the byte-indexed operations that replace the
+		// grapheme-indexed ones.
+		std::string source;
+		for (int i = 0; i < 20; ++i)
+			source += "hello 🎉 wörld 🇩🇪 👮🏻‍♂️ ";
+		Haunted::ustring text(source);
+		const size_t middle = text.length() / 2;
+		const Haunted::ustring piece("ab🎉");
+		const size_t piece_length = piece.length();
+
+		runner.run("ustring/insert+erase", [&] {
+			text.insert(middle, piece);
+			text.erase(middle, piece_length);
+		});
+		runner.run("ustring/substr", [&] { keep(text.substr(middle / 2, middle)); });
+		runner.run("ustring/construct", [&] { keep(Haunted::ustring(source)); });
+#ifdef ENABLE_ICU
+		runner.run("ustring/width", [&] { keep(text.width()); });
+		runner.run("ustring/widthUntil", [&] { keep(text.widthUntil(middle)); });
+#else
+		runner.skip("ustring/width", "built without ICU");
+		runner.skip("ustring/widthUntil", "built without ICU");
+#endif
+	}
+
+	void parsing(Runner &runner) {
+		const std::vector<std::string> sequences {"97;5u", "3;5~", "5~", "1;5C", "1;2H", "13;3u"};
+		runner.run("csi/parse", [&] {
+			for (const std::string &sequence: sequences)
+				keep(CSI(sequence).getKey());
+		}, sequences.size());
+
+		const std::vector<std::string> reports {"<0;10;5M", "<0;10;5m", "<32;40;12M", "<64;1;1M", "<35;80;24M"};
+		runner.run("mouse/parse", [&] {
+			for (const std::string &report: reports)
+				keep(MouseReport(report).x);
+		}, reports.size());
+	}
+
+	void coloration(Runner &runner) {
+		OffscreenTerminal screen(24, 80);
+		auto clear = [&] { screen.clearRecording(); };
+
+		bool flip = false;
+		runner.run("coloration/setForeground", [&] {
+			screen.colors.setForeground((flip = !flip)? ansi::color::red : ansi::color::blue);
+		}, 1, clear);
+
+		runner.run("coloration/setForeground/unchanged", [&] {
+			screen.colors.setForeground(ansi::color::green);
+		}, 1, clear);
+
+		runner.run("coloration/setBoth", [&] {
+			flip = !flip;
+			screen.colors.setBoth(flip? ansi::color::red : ansi::color::blue, flip? ansi::color::black :
+				ansi::color::white);
+		}, 1, clear);
+
+		runner.run("coloration/reset", [&] {
+			screen.colors.setForeground(ansi::color::red);
+			screen.colors.reset();
+		}, 1, clear);
+	}
+
+	void keys(Runner &runner) {
+		// Letters, an arrow, a modified arrow, a special key, a CSI u key, a control key, an Alt key, tab and enter.
+		const std::string chunk = "abc\e[A\e[1;5C\e[3~\e[97;5u\x01\ex\t\n";
+		constexpr size_t chunk_keys = 11, repeats = 100;
+		std::string input;
+		for (size_t i = 0; i < repeats; ++i)
+			input += chunk;
+
+		OffscreenTerminal screen(24, 80);
+		std::stringbuf buffer;
+		std::streambuf *old = screen.inStream.rdbuf(&buffer);
+		Key key;
+		runner.run("keys/decode", [&] {
+			buffer.str(input);
+			screen.inStream.clear();
+			for (size_t i = 0; i < chunk_keys * repeats; ++i)
+				screen >> key;
+			keep(key);
+		}, chunk_keys * repeats);
+		screen.inStream.rdbuf(old);
+	}
+}
+
+int main(int argc, char **argv) {
+	using namespace Haunted::Bench;
+
+	Runner runner;
+	runner.progress = &std::cerr;
+	std::string json_path;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--filter" && has_value) {
+			runner.filter = argv[++i];
+		} else if (arg == "--reps" && has_value) {
+			runner.repetitions = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--warmups" && has_value) {
+			runner.warmups = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--min-ms" && has_value) {
+			runner.minTime = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+		} else if (arg == "--json" && has_value) {
+			json_path = argv[++i];
+		} else if (arg == "--quiet") {
+			runner.progress = nullptr;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--filter substring] [--reps n] [--warmups n] [--min-ms n] "
+				"[--json path|-] [--quiet]\n";
+			return arg == "--help"? 0 : 1;
+		}
+	}
+
+	textbox(runner);
+	textLine(runner);
+	ustring(runner);
+	parsing(runner);
+	coloration(runner);
+	keys(runner);
+	scenarios(runner);
+
+	if (json_path == "-") {
+		runner.writeJSON(std::cout);
+		runner.writeTable(std::cerr);
+		return 0;
+	}
+
+	runner.writeTable(std::cout);
+	if (!json_path.empty()) {
+		std::ofstream out(json_path);
+		if (!out) {
+			std::cerr << "Couldn't open " << json_path << " for writing\n";
+			return 1;
+		}
+		runner.writeJSON(out);
+	}
+
+	return 0;
+}
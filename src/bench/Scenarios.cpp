@@ -0,0 +1,171 @@
+#include <string>
+#include <vector>
+
+#include "haunted/bench/Bench.h"
+#include "haunted/core/Key.h"
+#include "haunted/core/Mouse.h"
+#include "haunted/core/OffscreenTerminal.h"
+#include "haunted/ui/boxes/ExpandoBox.h"
+#include "haunted/ui/Label.h"
+#include "haunted/ui/Textbox.h"
+#include "haunted/ui/TextInput.h"
+
+namespace Haunted::Bench {
+	namespace {
+		/**
+		 * An IRC-like layout on a headless terminal: a title bar, the channel's messages beside a list of nicknames, a
+		 * status bar and an input. The terminal has a UI thread (the one running the scenario) and discards its output
+		 * after counting it, and each frame runs whatever was posted and flushes once, the way Terminal::run() does.
+		 */
+		class ChatScreen {
+			public:
+				OffscreenTerminal screen;
+				UI::Boxes::ExpandoBox *layout, *middle;
+				UI::Label *title, *status;
+				UI::DequeBox *messages, *nicks;
+				UI::TextInput *input;
+				size_t frames = 0;
+				size_t bytesBefore = 0;
+
+				ChatScreen(int rows, int cols): screen(rows, cols, 0) {
+					using UI::Boxes::BoxOrientation, UI::Boxes::ExpandoBox;
+					screen.setUIThread();
+
+					auto add = [](ExpandoBox *box, UI::Control *control, int size) {
+						control->setParent(box);
+						box->addChild(control, size);
+					};
+
+					layout = new ExpandoBox(&screen, BoxOrientation::Vertical);
+					middle = new ExpandoBox(nullptr, BoxOrientation::Horizontal);
+					title = new UI::Label("#haunted: a channel for benchmarks");
+					status = new UI::Label("[0 messages]");
+					messages = new UI::DequeBox();
+					nicks = new UI::DequeBox();
+					input = new UI::TextInput();
+
+					add(layout, title, 1);
+					add(layout, middle, -1);
+					add(middle, messages, -1);
+					add(middle, nicks, 16);
+					add(layout, status, 1);
+					add(layout, input, 1);
+
+					messages->setAutoscroll(true);
+					for (int i = 0; i < 50; ++i)
+						*nicks += "user" + std::to_string(i);
+
+					input->listen(UI::TextInput::Event::Submit, [this](const UI::TextInput::String &text, int) {
+						*messages += "<me> " + std::string(text);
+						input->clear();
+					});
+
+					// Labels draw themselves as soon as their colors change, so they have to be laid out first.
+					screen.setRoot(layout);
+					title->setColors(ansi::color::white, ansi::color::blue);
+					status->setColors(ansi::color::white, ansi::color::blue);
+					input->focus();
+				}
+
+				/** Returns the text of a message. Some have colors, and every 25th is long enough to wrap. */
+				static std::string message(size_t index) {
+					std::string text = "<user" + std::to_string(index % 50) + "> ";
+					if (index % 5 == 0)
+						text += "\e[32mgreen\e[39m text and ";
+					text += "message number " + std::to_string(index);
+					if (index % 25 == 0)
+						for (int i = 0; i < 3; ++i)
+							text += " with enough extra text that it has to wrap onto another row of the textbox";
+					return text;
+				}
+
+				void fill(size_t count) {
+					for (size_t i = 0; i < count; ++i)
+						*messages += message(i);
+				}
+
+				/** Runs posted tasks and due timers and flushes the output, as one iteration of the run loop would. */
+				void frame() {
+					screen.runPending();
+					screen.runTimers();
+					screen.flush();
+					++frames;
+				}
+
+				/** Starts measuring once the screen is set up. The setup's own drawing is flushed first, so that it
+				 *  isn't counted either. */
+				void begin(ScenarioResult &result) {
+					frame();
+					frames = 0;
+					bytesBefore = screen.getBytesWritten();
+					result.begin();
+				}
+
+				/** Stops measuring before the screen is torn down and fills in the frames and bytes since begin(). */
+				void end(ScenarioResult &result) const {
+					result.end();
+					result.frames = frames;
+					result.bytes = screen.getBytesWritten() - bytesBefore;
+				}
+		};
+	}
+
+	void scenarios(Runner &runner) {
+		// Messages arrive in bursts of ten per frame while the status bar counts them.
+		runner.scenario("scenario/firehose", [](ScenarioResult &result) {
+			ChatScreen chat(40, 120);
+			chat.begin(result);
+			size_t count = 0;
+			for (int frame = 0; frame < 200; ++frame) {
+				for (int i = 0; i < 10; ++i)
+					*chat.messages += ChatScreen::message(count++);
+				chat.status->setText("[" + std::to_string(count) + " messages]");
+				chat.frame();
+			}
+			chat.end(result);
+		});
+
+		// Typing arrives in bursts of a few keys per frame, with a message sent every 60 characters.
+		runner.scenario("scenario/typing", [](ScenarioResult &result) {
+			ChatScreen chat(40, 120);
+			chat.fill(500);
+			const std::string text = "the quick brown fox jumps over the lazy dog while the terminal keeps up ";
+			chat.begin(result);
+			for (size_t typed = 0; typed < 1000;) {
+				for (int i = 0; i < 8; ++i, ++typed)
+					chat.screen.postKey(typed % 60 == 59? Key(KeyType::Enter) : Key(text[typed % text.size()]));
+				chat.frame();
+			}
+			chat.end(result);
+		});
+
+		// The window is resized every frame, so the whole layout is redrawn every frame.
+		runner.scenario("scenario/resize", [](ScenarioResult &result) {
+			ChatScreen chat(40, 120);
+			chat.fill(1000);
+			const std::vector<std::pair<int, int>> sizes {{24, 80}, {50, 160}, {30, 100}, {40, 120}};
+			chat.begin(result);
+			for (int frame = 0; frame < 100; ++frame) {
+				const auto [rows, cols] = sizes[frame % sizes.size()];
+				chat.screen.setSize(rows, cols);
+				chat.frame();
+			}
+			chat.end(result);
+		});
+
+		// The mouse wheel scrolls the messages up through the scrollback and back down, three notches per frame.
+		runner.scenario("scenario/wheel", [](ScenarioResult &result) {
+			ChatScreen chat(40, 120);
+			chat.fill(1000);
+			const Position &area = chat.messages->getPosition();
+			chat.begin(result);
+			for (int frame = 0; frame < 100; ++frame) {
+				const long type = frame < 50? 64 : 65;
+				for (int i = 0; i < 3; ++i)
+					chat.screen.sendMouse(MouseReport(type, 'M', area.left + 10, area.top + 10));
+				chat.frame();
+			}
+			chat.end(result);
+		});
+	}
+}
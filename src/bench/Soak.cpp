@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "haunted/bench/Bench.h"
+#include "haunted/core/DummyTerminal.h"
+#include "haunted/core/Key.h"
+#include "haunted/ui/boxes/ExpandoBox.h"
+#include "haunted/ui/Label.h"
+#include "haunted/ui/SimpleLine.h"
+#include "haunted/ui/Textbox.h"
+#include "haunted/ui/TextInput.h"
+
+// A soak test for slow memory growth. It drives a chat-client-like widget tree on a DummyTerminal for a long time,
+// appending lines to a textbox with limited scrollback, resizing the layout, moving the focus and creating and
+// destroying controls, and periodically samples the heap, the number of live objects of each class it creates and the
+// size of the textbox's wrapping caches. Once the workload has reached a steady state, none of these should grow, so
+// the test fails if the slope of any of them exceeds a limit.
+
+namespace Haunted::Bench {
+	namespace {
+		/** Counts the live instances of the class deriving from it. */
+		template <typename T>
+		class Counted {
+			private:
+				static inline std::atomic<long> live {0};
+
+			public:
+				Counted() { ++live; }
+				Counted(const Counted &) { ++live; }
+				~Counted() { --live; }
+
+				static long getLive() { return live.load(); }
+		};
+
+		class SoakLine: public UI::SimpleLine<std::deque>, public Counted<SoakLine> {
+			public:
+				using UI::SimpleLine<std::deque>::SimpleLine;
+		};
+
+		class SoakLabel: public UI::Label, public Counted<SoakLabel> {
+			public:
+				using UI::Label::Label;
+		};
+
+		class SoakInput: public UI::TextInput, public Counted<SoakInput> {
+			public:
+				using UI::TextInput::TextInput;
+		};
+
+		class SoakPanel: public UI::Boxes::ExpandoBox, public Counted<SoakPanel> {
+			public:
+				using UI::Boxes::ExpandoBox::ExpandoBox;
+		};
+
+		/** A textbox with limited scrollback that can report how much its lines have cached. */
+		class SoakBox: public UI::DequeBox, public Counted<SoakBox> {
+			public:
+				using UI::DequeBox::DequeBox;
+
+				/** Removes the oldest lines until at most a given number remain. */
+				void trim(size_t max) {
+					if (lines.size() <= max)
+						return;
+
+					int removed = 0;
+					while (max < lines.size()) {
+						removed += lineRows(*lines.front());
+						lines.pop_front();
+					}
+
+					voffset = std::max(0, voffset - removed);
+					rowsDirty();
+				}
+
+				/** Returns the number of wrapped rows cached by the lines. */
+				size_t cachedRows() const {
+					size_t rows = 0;
+					for (const LinePtr &line: lines)
+						rows += line->lines_.size();
+					return rows;
+				}
+
+				/** Returns the approximate number of bytes held by the lines' caches, including unused capacity. */
+				size_t cacheBytes() const {
+					size_t bytes = 0;
+					for (const LinePtr &line: lines) {
+						bytes += line->lines_.capacity() * sizeof(std::string);
+						for (const std::string &row: line->lines_)
+							bytes += row.capacity();
+					}
+					return bytes;
+				}
+		};
+
+		struct Options {
+			/** Two million lines by default, which takes about ten minutes in the optimized build that `make soak`
+			 *  runs. */
+			size_t cycles = 2000;
+			size_t linesPerCycle = 1000;
+			size_t scrollback = 5000;
+			size_t sampleEvery = 10;
+
+			/** The fraction of the samples at the start of the run that are ignored while the workload warms up. */
+			double warmup = 0.25;
+
+			/** The largest allowed growth per cycle of the heap in use and of the caches, in bytes. */
+			double maxHeapSlope = 512;
+
+			/** The largest allowed growth per cycle of the number of live allocations or objects of any class. */
+			double maxCountSlope = 0.05;
+
+			/** The largest allowed growth per cycle of the resident set size, in bytes. Zero disables the check, since
+			 *  whether freed memory is returned to the system is up to the allocator. */
+			double maxRSSSlope = 0;
+
+			std::string csvPath;
+			bool quiet = false;
+		};
+
+		struct Sample {
+			size_t cycle = 0, lines = 0;
+
+			/** The bytes in use and free in the allocator's heap, from mallinfo2(). Large allocations that are mapped
+			 *  separately count as in use. */
+			size_t heapUsed = 0, heapFree = 0;
+
+			size_t rss = 0;
+			size_t liveAllocations = 0;
+			long liveLines = 0, liveLabels = 0, liveInputs = 0, livePanels = 0, liveBoxes = 0;
+			size_t cachedRows = 0, cacheBytes = 0;
+
+			/** Returns the fraction of the heap that's free, which grows as the heap fragments. */
+			double fragmentation() const {
+				return heapUsed + heapFree == 0? 0 : double(heapFree) / (heapUsed + heapFree);
+			}
+		};
+
+		size_t residentBytes() {
+			std::ifstream statm("/proc/self/statm");
+			size_t pages = 0, resident = 0;
+			statm >> pages >> resident;
+			return resident * sysconf(_SC_PAGESIZE);
+		}
+
+		/** Returns the least-squares slope of a series against the cycle numbers of its samples. */
+		double slope(const std::vector<Sample> &samples, double (*value)(const Sample &)) {
+			const size_t count = samples.size();
+			if (count < 2)
+				return 0;
+
+			double mean_x = 0, mean_y = 0;
+			for (const Sample &sample: samples) {
+				mean_x += sample.cycle;
+				mean_y += value(sample);
+			}
+			mean_x /= count;
+			mean_y /= count;
+
+			double numerator = 0, denominator = 0;
+			for (const Sample &sample: samples) {
+				numerator += (sample.cycle - mean_x) * (value(sample) - mean_y);
+				denominator += (sample.cycle - mean_x) * (sample.cycle - mean_x);
+			}
+
+			return denominator == 0? 0 : numerator / denominator;
+		}
+
+		struct Check {
+			const char *name;
+			double (*value)(const Sample &);
+			double limit;
+		};
+
+		class Soak {
+			private:
+				const Options &options;
+				DummyTerminal terminal;
+				std::unique_ptr<UI::Boxes::ExpandoBox> layout;
+				UI::Boxes::ExpandoBox *middle;
+				SoakLabel *title, *status;
+				SoakBox *messages, *nicks;
+				SoakInput *input;
+				size_t appended = 0, nickCounter = 0;
+
+				static void add(UI::Boxes::ExpandoBox *box, UI::Control *control, int size) {
+					control->setParent(box);
+					box->addChild(control, size);
+				}
+
+				static std::string message(size_t index) {
+					std::string text = "<user" + std::to_string(index % 97) + "> ";
+					if (index % 5 == 0)
+						text += "\e[3" + std::to_string(index % 8) + "mcolored\e[39m and ";
+					text += "message number " + std::to_string(index);
+					if (index % 11 == 0)
+						for (int i = 0; i < 3; ++i)
+							text += " with enough extra text that it has to wrap onto another row of the textbox";
+					return text;
+				}
+
+				void type(const std::string &text) {
+					for (const char ch: text)
+						terminal.getFocused()->onKey(Key(ch));
+				}
+
+				/** Adds a panel with a prompt and an input below the layout, types into it and destroys it again, the
+				 *  way a client might show a dialog. */
+				void transientPanel(size_t cycle) {
+					SoakPanel *panel = new SoakPanel(nullptr, UI::Boxes::BoxOrientation::Horizontal);
+					add(layout.get(), panel, 1);
+					add(panel, new SoakLabel("Password for #" + std::to_string(cycle) + ":"), 20);
+					SoakInput *field = new SoakInput();
+					add(panel, field, -1);
+					layout->resize(layout->getPosition());
+
+					field->focus();
+					type("hunter" + std::to_string(cycle));
+					input->focus();
+
+					layout->removeChild(panel);
+					delete panel;
+					layout->resize(layout->getPosition());
+				}
+
+			public:
+				Soak(const Options &options_): options(options_), terminal(40, 120) {
+					using UI::Boxes::BoxOrientation, UI::Boxes::ExpandoBox;
+
+					layout = std::make_unique<ExpandoBox>(&terminal, Position(0, 0, 120, 40), BoxOrientation::Vertical);
+					middle = new ExpandoBox(nullptr, BoxOrientation::Horizontal);
+					title = new SoakLabel("#haunted");
+					status = new SoakLabel("");
+					messages = new SoakBox();
+					nicks = new SoakBox();
+					input = new SoakInput();
+
+					add(layout.get(), title, 1);
+					add(layout.get(), middle, -1);
+					add(middle, messages, -1);
+					add(middle, nicks, 16);
+					add(layout.get(), status, 1);
+					add(layout.get(), input, 1);
+					layout->resize(layout->getPosition());
+
+					messages->setAutoscroll(true);
+					for (; nickCounter < 200; ++nickCounter)
+						*nicks += "user" + std::to_string(nickCounter);
+
+					input->listen(UI::TextInput::Event::Submit, [this](const UI::TextInput::String &text, int) {
+						SoakLine line("<me> " + std::string(text), 5);
+						*messages += line;
+						input->clear();
+					});
+
+					input->focus();
+				}
+
+				/** Runs one cycle of the workload. */
+				void cycle(size_t index) {
+					static const std::vector<Position> sizes {{0, 0, 120, 40}, {0, 0, 80, 24}, {0, 0, 200, 60}};
+
+					for (size_t i = 0; i < options.linesPerCycle; ++i) {
+						SoakLine line(message(appended++), 4);
+						*messages += line;
+					}
+					messages->trim(options.scrollback);
+
+					// Someone joins and someone else leaves.
+					nicks->trim(199);
+					*nicks += "user" + std::to_string(nickCounter++);
+
+					layout->resize(sizes[index % sizes.size()]);
+
+					type("a reply to message " + std::to_string(appended));
+					terminal.getFocused()->onKey(Key(KeyType::Enter));
+
+					messages->focus();
+					nicks->focus();
+					transientPanel(index);
+
+					title->setText("#haunted: " + std::to_string(appended) + " messages");
+					status->setText("[cycle " + std::to_string(index) + "]");
+				}
+
+				Sample sample(size_t cycle) const {
+					Sample out;
+					out.cycle = cycle;
+					out.lines = appended;
+
+					const struct mallinfo2 info = mallinfo2();
+					out.heapUsed = info.uordblks + info.hblkhd;
+					out.heapFree = info.fordblks;
+
+					out.rss = residentBytes();
+					out.liveAllocations = liveAllocations();
+					out.liveLines = SoakLine::getLive();
+					out.liveLabels = SoakLabel::getLive();
+					out.liveInputs = SoakInput::getLive();
+					out.livePanels = SoakPanel::getLive();
+					out.liveBoxes = SoakBox::getLive();
+					out.cachedRows = messages->cachedRows() + nicks->cachedRows();
+					out.cacheBytes = messages->cacheBytes() + nicks->cacheBytes();
+					return out;
+				}
+		};
+
+		void writeHeader(std::ostream &out) {
+			out << std::setw(8) << "cycle" << std::setw(12) << "lines" << std::setw(12) << "heap KiB" << std::setw(10)
+				<< "frag %" << std::setw(12) << "RSS KiB" << std::setw(12) << "live allocs" << std::setw(12)
+				<< "live lines" << std::setw(12) << "cache KiB" << "\n";
+		}
+
+		void writeRow(std::ostream &out, const Sample &sample) {
+			out << std::fixed << std::setprecision(1) << std::setw(8) << sample.cycle << std::setw(12) << sample.lines
+				<< std::setw(12) << sample.heapUsed / 1024 << std::setw(10) << sample.fragmentation() * 100
+				<< std::setw(12) << sample.rss / 1024 << std::setw(12) << sample.liveAllocations << std::setw(12)
+				<< sample.liveLines << std::setw(12) << sample.cacheBytes / 1024 << std::endl;
+		}
+
+		void writeCSV(std::ostream &out, const std::vector<Sample> &samples) {
+			out << "cycle,lines,heap_used,heap_free,rss,live_allocations,live_lines,live_labels,live_inputs,"
+				"live_panels,live_boxes,cached_rows,cache_bytes\n";
+			for (const Sample &sample: samples) {
+				out << sample.cycle << ',' << sample.lines << ',' << sample.heapUsed << ',' << sample.heapFree << ','
+					<< sample.rss << ',' << sample.liveAllocations << ',' << sample.liveLines << ','
+					<< sample.liveLabels << ',' << sample.liveInputs << ',' << sample.livePanels << ','
+					<< sample.liveBoxes << ',' << sample.cachedRows << ',' << sample.cacheBytes << '\n';
+			}
+		}
+
+		/** Runs the soak test and returns whether every series stayed within its limit. */
+		bool run(const Options &options) {
+			std::vector<Sample> samples;
+			{
+				Soak soak(options);
+				if (!options.quiet)
+					writeHeader(std::cout);
+
+				const size_t every = std::max<size_t>(options.sampleEvery, 1);
+				for (size_t cycle = 1; cycle <= options.cycles; ++cycle) {
+					soak.cycle(cycle);
+					if (cycle % every == 0 || cycle == options.cycles) {
+						samples.push_back(soak.sample(cycle));
+						if (!options.quiet)
+							writeRow(std::cout, samples.back());
+					}
+				}
+			}
+
+			if (!options.csvPath.empty()) {
+				std::ofstream csv(options.csvPath);
+				if (!csv)
+					std::cerr << "Couldn't open " << options.csvPath << " for writing\n";
+				else
+					writeCSV(csv, samples);
+			}
+
+			const size_t skipped = std::min(samples.size(), size_t(samples.size() * options.warmup));
+			const std::vector<Sample> steady(samples.begin() + skipped, samples.end());
+
+			const std::vector<Check> checks {
+				{"heap in use (B/cycle)", [](const Sample &s) { return double(s.heapUsed); }, options.maxHeapSlope},
+				{"line caches (B/cycle)", [](const Sample &s) { return double(s.cacheBytes); }, options.maxHeapSlope},
+				{"RSS (B/cycle)", [](const Sample &s) { return double(s.rss); }, options.maxRSSSlope},
+				{"live allocations", [](const Sample &s) { return double(s.liveAllocations); }, options.maxCountSlope},
+				{"live SoakLine objects", [](const Sample &s) { return double(s.liveLines); }, options.maxCountSlope},
+				{"live SoakLabel objects", [](const Sample &s) { return double(s.liveLabels); }, options.maxCountSlope},
+				{"live SoakInput objects", [](const Sample &s) { return double(s.liveInputs); }, options.maxCountSlope},
+				{"live SoakPanel objects", [](const Sample &s) { return double(s.livePanels); }, options.maxCountSlope},
+				{"live SoakBox objects", [](const Sample &s) { return double(s.liveBoxes); }, options.maxCountSlope},
+			};
+
+			bool passed = true;
+			std::cout << "\nSlopes over cycles " << (steady.empty()? 0 : steady.front().cycle) << " to "
+				<< (steady.empty()? 0 : steady.back().cycle) << ":\n";
+			for (const Check &check: checks) {
+				const double value = slope(steady, check.value);
+				const bool ok = check.limit <= 0 || value <= check.limit;
+				passed = passed && ok;
+				std::cout << "  " << std::left << std::setw(26) << check.name << std::right << std::fixed
+					<< std::setprecision(4) << std::setw(16) << value;
+				if (check.limit <= 0)
+					std::cout << "  (unchecked)\n";
+				else
+					std::cout << (ok? "  ok" : "  FAILED") << " (limit " << check.limit << ")\n";
+			}
+
+			// Everything the soak test created belonged to the widget tree, which is gone by now.
+			const long leftover = SoakLine::getLive() + SoakLabel::getLive() + SoakInput::getLive() +
+				SoakPanel::getLive() + SoakBox::getLive();
+			if (leftover != 0) {
+				passed = false;
+				std::cout << leftover << " objects were still alive after the widget tree was destroyed\n";
+			}
+
+			std::cout << (passed? "PASSED" : "FAILED") << std::endl;
+			return passed;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	using namespace Haunted::Bench;
+
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--cycles" && has_value) {
+			options.cycles = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--lines" && has_value) {
+			options.linesPerCycle = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--scrollback" && has_value) {
+			options.scrollback = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--sample-every" && has_value) {
+			options.sampleEvery = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--warmup" && has_value) {
+			options.warmup = std::strtod(argv[++i], nullptr);
+		} else if (arg == "--max-heap-slope" && has_value) {
+			options.maxHeapSlope = std::strtod(argv[++i], nullptr);
+		} else if (arg == "--max-count-slope" && has_value) {
+			options.maxCountSlope = std::strtod(argv[++i], nullptr);
+		} else if (arg == "--max-rss-slope" && has_value) {
+			options.maxRSSSlope = std::strtod(argv[++i], nullptr);
+		} else if (arg == "--csv" && has_value) {
+			options.csvPath = argv[++i];
+		} else if (arg == "--quiet") {
+			options.quiet = true;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--cycles n] [--lines n] [--scrollback n] [--sample-every n] "
+				"[--warmup fraction] [--max-heap-slope bytes] [--max-count-slope n] [--max-rss-slope bytes] "
+				"[--csv path] [--quiet]\n";
+			return arg == "--help"? 0 : 2;
+		}
+	}
+
+	return run(options)? 0 : 1;
+}
@@ -0,0 +1,25 @@
+# Benchmarks are built separately with optimizations on, since timings of the -O0 debug build say little.
+BENCH_FLAGS     := -O2 -DNDEBUG
+BENCH_COMMON    := $(filter-out src/tests/%,$(SOURCES)) src/bench/Allocations.cpp
+BENCH_SOURCES   := $(BENCH_COMMON) src/bench/Bench.cpp src/bench/Cases.cpp src/bench/Scenarios.cpp
+BENCH_OBJECTS   := $(patsubst src/%.cpp,build/release/%.o, $(BENCH_SOURCES))
+SOAK_OBJECTS    := $(patsubst src/%.cpp,build/release/%.o, $(BENCH_COMMON) src/bench/Soak.cpp)
+
+build/release/%.o: src/%.cpp
+	@ mkdir -p "$(shell dirname "$@")"
+	$(CC) $(BENCH_FLAGS) $(strip $(INCLUDE)) -c $< -o $@
+
+build/bench: $(BENCH_OBJECTS)
+	@ $(MKBUILD)
+	$(CC) $(BENCH_FLAGS) $^ -o $@ $(LDFLAGS) $(LDLIBS)
+
+bench: build/bench
+	./$^ --json build/bench.json
+
+# The soak test runs the same build for a long time and fails if memory use keeps growing.
+build/soak: $(SOAK_OBJECTS)
+	@ $(MKBUILD)
+	$(CC) $(BENCH_FLAGS) $^ -o $@ $(LDFLAGS) $(LDLIBS)
+
+soak: build/soak
+	./$^ --csv build/soak.csv
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "haunted/core/Defs.h"
 
 namespace Haunted {
@@ -20,6 +22,23 @@ namespace Haunted {
 		return top + height - 1;
 	}
 
+	bool Position::contains(const Position &other) const {
+		return left <= other.left && other.right() <= right() && top <= other.top && other.bottom() <= bottom();
+	}
+
+	bool Position::intersects(const Position &other) const {
+		return 0 < width && 0 < height && 0 < other.width && 0 < other.height && left <= other.right() &&
+			other.left <= right() && top <= other.bottom() && other.top <= bottom();
+	}
+
+	Position Position::intersect(const Position &other) const {
+		if (!intersects(other))
+			return {left, top, 0, 0};
+		const int new_left = std::max(left, other.left), new_top = std::max(top, other.top);
+		return {new_left, new_top, std::min(right(), other.right()) - new_left + 1,
+			std::min(bottom(), other.bottom()) - new_top + 1};
+	}
+
 	bool Position::operator==(const Position &other) const {
 		return left == other.left && top == other.top && width == other.width && height == other.height;
 	}
@@ -0,0 +1,82 @@
+#include <stdexcept>
+
+#include "haunted/core/OffscreenTerminal.h"
+
+namespace Haunted {
+	RecordingBuffer::int_type RecordingBuffer::overflow(int_type ch) {
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			const char c = traits_type::to_char_type(ch);
+			xsputn(&c, 1);
+		}
+
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize RecordingBuffer::xsputn(const char *str, std::streamsize count) {
+		total += count;
+		if (overflowed)
+			return count;
+
+		if (limit - recording.size() < static_cast<size_t>(count)) {
+			overflowed = true;
+			std::string().swap(recording);
+		} else {
+			recording.append(str, count);
+		}
+
+		return count;
+	}
+
+	void RecordingBuffer::setLimit(size_t limit_) {
+		limit = limit_;
+		if (limit < recording.size()) {
+			overflowed = true;
+			std::string().swap(recording);
+		}
+	}
+
+	void RecordingBuffer::clear() {
+		recording.clear();
+		overflowed = false;
+	}
+
+	OffscreenTerminal::OffscreenTerminal(int rows_, int cols_, size_t limit):
+	OffscreenStreams(limit), Terminal(emptyInput, recordingStream, rows_, cols_) {}
+
+	OffscreenTerminal::OffscreenTerminal(Terminal &source_, size_t limit):
+	OffscreenStreams(limit), Terminal(emptyInput, recordingStream, source_.getRows(), source_.getCols()),
+	source(&source_) {}
+
+	OffscreenTerminal::~OffscreenTerminal() {
+		// Keeps ~Terminal from resetting the attributes of a TTY this terminal was never attached to.
+		suppressOutput = true;
+	}
+
+
+// Public instance methods
+
+
+	void OffscreenTerminal::setSize(int rows_, int cols_) {
+		if (source)
+			throw std::logic_error("Can't resize an offscreen terminal that follows a source");
+		Terminal::winch(rows_, cols_);
+	}
+
+	void OffscreenTerminal::clearRecording() {
+		auto lock = lockRender();
+		colors.reset();
+		buffer.clear();
+	}
+
+	bool OffscreenTerminal::hasFocus(const UI::Control *control) const {
+		return source? source->hasFocus(control) : Terminal::hasFocus(control);
+	}
+
+	int OffscreenTerminal::getRows() const {
+		return source? source->getRows() : Terminal::getRows();
+	}
+
+	int OffscreenTerminal::getCols() const {
+		return source? source->getCols() : Terminal::getCols();
+	}
+}
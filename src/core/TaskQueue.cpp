@@ -0,0 +1,100 @@
+#include "haunted/core/TaskQueue.h"
+
+namespace Haunted {
+	TaskQueue::TaskQueue(): head(&stub), tail(&stub) {}
+
+	TaskQueue::~TaskQueue() {
+		Task discarded;
+		while (pop(discarded));
+	}
+
+
+// Private instance methods
+
+
+	void TaskQueue::pushNode(Node *node) {
+		node->next.store(nullptr, std::memory_order_relaxed);
+		Node *previous = head.exchange(node, std::memory_order_acq_rel);
+		// Between the exchange and this store, the node is unreachable from the tail and pop() will wait for it.
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	void TaskQueue::signal() {
+		signals.fetch_add(1, std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_seq_cst)) {
+			// Taking the mutex makes sure the consumer is either still checking its predicate or already waiting.
+			std::unique_lock lock(sleepMutex);
+			sleeper.notify_one();
+		}
+	}
+
+
+// Public instance methods
+
+
+	void TaskQueue::push(Task task) {
+		Node *node = new Node;
+		node->task = std::move(task);
+		// Count the task first so that the count never drops below zero when the consumer pops it right away.
+		pending.fetch_add(1, std::memory_order_release);
+		pushNode(node);
+		signal();
+	}
+
+	bool TaskQueue::pop(Task &out) {
+		Node *node = tail;
+		Node *next = node->next.load(std::memory_order_acquire);
+
+		if (node == &stub) {
+			if (!next)
+				return false;
+			tail = node = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+
+		if (!next) {
+			// The node is the last one. Put the stub behind it so that it can be unlinked, unless a producer has
+			// already swapped in a newer node that it hasn't linked yet.
+			if (node != head.load(std::memory_order_acquire))
+				return false;
+			pushNode(&stub);
+			next = node->next.load(std::memory_order_acquire);
+			if (!next)
+				return false;
+		}
+
+		tail = next;
+		out = std::move(node->task);
+		delete node;
+		pending.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+
+	void TaskQueue::wait() {
+		waitUntil(std::chrono::steady_clock::time_point::max());
+	}
+
+	bool TaskQueue::waitUntil(std::chrono::steady_clock::time_point deadline) {
+		const uint32_t seen = signals.load(std::memory_order_seq_cst);
+		if (!empty())
+			return true;
+
+		sleeping.store(true, std::memory_order_seq_cst);
+		std::unique_lock lock(sleepMutex);
+		auto woken = [&] { return signals.load(std::memory_order_seq_cst) != seen; };
+		bool result;
+		if (deadline == std::chrono::steady_clock::time_point::max()) {
+			sleeper.wait(lock, woken);
+			result = true;
+		} else {
+			result = sleeper.wait_until(lock, deadline, woken);
+		}
+
+		sleeping.store(false, std::memory_order_relaxed);
+		return result;
+	}
+
+	void TaskQueue::wake() {
+		signal();
+	}
+}
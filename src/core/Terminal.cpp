@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <cassert>
 #include <deque>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 
+#include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -20,6 +25,8 @@ namespace Haunted {
 	using uchar = unsigned char;
 
 	std::vector<Terminal *> Terminal::winchTargets {};
+	std::mutex Terminal::winchTargetsMutex;
+	int Terminal::winchPipe[2] {-1, -1};
 
 	Terminal::Terminal(std::istream &inStream, ansi::ansistream &outStream):
 	inStream(inStream), outStream(outStream), colors(&outStream, &outputMutex) {
@@ -30,6 +37,11 @@ namespace Haunted {
 		cols = size.ws_col;
 	}
 
+	Terminal::Terminal(std::istream &inStream, ansi::ansistream &outStream, int rows_, int cols_):
+	original(), rows(rows_), cols(cols_), inStream(inStream), outStream(outStream), colors(&outStream, &outputMutex) {
+		attrs = original;
+	}
+
 	Terminal::~Terminal() {
 		if (!suppressOutput) {
 			outStream.reset_colors();
@@ -39,7 +51,24 @@ namespace Haunted {
 			jump(0, 0);
 		}
 
-		delete root;
+		{
+			std::unique_lock<std::mutex> lock(winchTargetsMutex);
+			winchTargets.erase(std::remove(winchTargets.begin(), winchTargets.end(), this), winchTargets.end());
+		}
+
+		// Arena-owned controls are left for their arena to destroy, but they're detached first so that the arena doesn't
+		// try to remove them from a terminal that no longer exists.
+		for (const Overlay &overlay: overlays) {
+			if (overlay.control->isArenaOwned())
+				overlay.control->setParent(nullptr);
+			else
+				delete overlay.control;
+		}
+
+		if (root && root->isArenaOwned())
+			root->setParent(nullptr);
+		else
+			delete root;
 	}
 
 
@@ -47,10 +76,28 @@ namespace Haunted {
 
 
 	void Terminal::winchHandler(int) {
-		winsize new_size;
-		ioctl(STDIN_FILENO, TIOCGWINSZ, &new_size);
-		for (Terminal *terminal: winchTargets)
-			terminal->winch(new_size.ws_row, new_size.ws_col);
+		const int old_errno = errno;
+		const char byte = 0;
+		// The write end is nonblocking, so if the pipe is full the resize is simply merged with the pending ones.
+		[[maybe_unused]] const ssize_t written = write(winchPipe[1], &byte, 1);
+		errno = old_errno;
+	}
+
+	void Terminal::watchWinch() {
+		char buffer[64];
+		for (;;) {
+			const ssize_t count = read(winchPipe[0], buffer, sizeof(buffer));
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return;
+
+			winsize new_size;
+			ioctl(STDIN_FILENO, TIOCGWINSZ, &new_size);
+			std::unique_lock<std::mutex> lock(winchTargetsMutex);
+			for (Terminal *terminal: winchTargets)
+				terminal->winch(new_size.ws_row, new_size.ws_col);
+		}
 	}
 
 	termios Terminal::getattr() {
@@ -90,13 +137,127 @@ namespace Haunted {
 		cbreak();
 		while (alive) {
 			*this >> key;
+			if (isSingleThreaded()) {
+				// The interrupt handler runs on the UI thread like everything else, so this thread keeps reading.
+				postKey(key);
+				continue;
+			}
+
 			if (key == Key(KeyType::c, KeyMod::Ctrl) && (!onInterrupt || onInterrupt()))
 				break;
 			sendKey(key);
 		}
 	}
 
+	void Terminal::handleKey(const Key &key) {
+		if (key == Key(KeyType::c, KeyMod::Ctrl) && (!onInterrupt || onInterrupt()))
+			stop();
+		else if (keyWaiters.empty())
+			sendKey(key);
+		else
+			keyWaiters.emit(key);
+	}
+
+	ssize_t Terminal::layerOf(const UI::Control *control) const {
+		if (overlays.empty() || !control)
+			return -1;
+
+		// Find the control at the top of the tree, whose parent is the terminal.
+		for (UI::Container *parent = control->getParent(); parent && parent != this; parent = control->getParent())
+			if (!(control = parent->asControl()))
+				return -1;
+
+		for (size_t i = 0; i < overlays.size(); ++i)
+			if (overlays[i].control == control)
+				return i;
+
+		return -1;
+	}
+
+	void Terminal::refreshHits() const {
+		if (hitIndex.getWidth() != cols || hitIndex.getHeight() != rows)
+			hitIndex.resize(cols, rows);
+
+		if (!hitIndex.isStale())
+			return;
+
+		UI::Control *base = root && root->asContainer()? root : nullptr;
+		if (overlays.empty()) {
+			hitIndex.rebuild(base);
+			return;
+		}
+
+		std::vector<UI::Control *> layers;
+		layers.reserve(overlays.size() + 1);
+		for (auto iter = overlays.rbegin(); iter != overlays.rend(); ++iter)
+			layers.push_back(iter->control);
+		layers.push_back(base);
+		hitIndex.rebuild(layers);
+	}
+
+	void Terminal::restore(const Position &region) {
+		if (region.width <= 0 || region.height <= 0)
+			return;
+
+		auto lock = lockRender();
+		refreshHits();
+		colors.reset();
+
+		// Collect the controls left showing in the region. Cells that nothing occupies are blanked directly.
+		std::vector<UI::Control *> exposed;
+		std::unordered_set<UI::Control *> seen;
+		for (int y = region.top; y <= region.bottom(); ++y) {
+			int blank = -1;
+			for (int x = region.left; x <= region.right() + 1; ++x) {
+				UI::Control *control = x <= region.right()? hitIndex.at(x, y) : nullptr;
+				if (control && seen.insert(control).second)
+					exposed.push_back(control);
+
+				if (!control && x <= region.right()) {
+					if (blank == -1)
+						blank = x;
+				} else if (blank != -1) {
+					jump(blank, y);
+					*this << std::string(x - blank, ' ');
+					blank = -1;
+				}
+			}
+		}
+
+		// Draw the lower layers first in case some of the controls don't clip themselves around the higher ones.
+		std::stable_sort(exposed.begin(), exposed.end(), [this](UI::Control *left, UI::Control *right) {
+			return layerOf(left) < layerOf(right);
+		});
+
+		for (UI::Control *control: exposed)
+			control->draw();
+
+		jumpToFocused();
+		flush();
+	}
+
+	std::unique_lock<std::mutex> Terminal::lockOutput() {
+		if (isSingleThreaded()) {
+			assert(onUIThread() && "Writing to the terminal outside the UI thread");
+			return {};
+		}
+
+		return std::unique_lock<std::mutex>(outputMutex);
+	}
+
 	void Terminal::winch(int new_rows, int new_cols) {
+		if (isSingleThreaded()) {
+			// The UI thread reads the size without locking, so the size is changed there along with the redraw.
+			post([this, new_rows, new_cols] {
+				if (rows != new_rows || cols != new_cols) {
+					rows = new_rows;
+					cols = new_cols;
+					redraw();
+				}
+			});
+			return;
+		}
+
 		bool changed = rows != new_rows || cols != new_cols;
 		rows = new_rows;
 		cols = new_cols;
@@ -117,31 +278,129 @@ namespace Haunted {
 	}
 
 	void Terminal::watchSize() {
-		if (winchTargets.empty())
+		std::unique_lock<std::mutex> lock(winchTargetsMutex);
+		if (winchPipe[0] == -1) {
+			if (pipe(winchPipe) < 0)
+				throw std::runtime_error("pipe() failed: " + std::string(std::strerror(errno)));
+			fcntl(winchPipe[1], F_SETFL, fcntl(winchPipe[1], F_GETFL) | O_NONBLOCK);
+			std::thread(&Terminal::watchWinch).detach();
 			std::signal(SIGWINCH, &Terminal::winchHandler);
+		}
+
 		winchTargets.push_back(this);
 	}
 
 	void Terminal::redraw() {
-		if (root) {
+		if (root || !overlays.empty()) {
+			// Lay out the whole tree before painting anything so that every control is drawn exactly once.
+			auto lock = lockRender();
 			colors.reset();
 			outStream.clear().jump();
-			root->resize({0, 0, cols, rows});
+			hitIndex.resize(cols, rows);
+			if (root)
+				root->resize({0, 0, cols, rows});
+			for (const Overlay &overlay: overlays)
+				overlay.control->resize();
+			draw();
 		}
 	}
 
 	void Terminal::setRoot(UI::Control *new_root, bool delete_old) {
 		if (root != new_root) {
-			if (delete_old)
+			if (delete_old && root && !root->isArenaOwned())
 				delete root;
 			root = new_root;
+			hitIndex.invalidate();
 			redraw();
 		}
 	}
 
 	void Terminal::draw() {
+		auto lock = lockRender();
 		if (root)
 			root->draw();
+		for (const Overlay &overlay: overlays)
+			overlay.control->draw();
+	}
+
+	void Terminal::addOverlay(UI::Control *control, int z, bool opaque) {
+		if (!control)
+			throw std::invalid_argument("Overlay is null");
+
+		for (const Overlay &overlay: overlays)
+			if (overlay.control == control)
+				throw std::invalid_argument("Control is already an overlay");
+
+		if (UI::Container *old_parent = control->getParent(); old_parent && old_parent != this)
+			old_parent->removeChild(control);
+		if (control->getParent() != this)
+			control->setParent(this);
+
+		auto iter = std::upper_bound(overlays.begin(), overlays.end(), z, [](int z, const Overlay &overlay) {
+			return z < overlay.z;
+		});
+
+		const size_t index = overlays.insert(iter, {control, z, opaque}) - overlays.begin();
+		hitIndex.invalidate();
+
+		auto lock = lockRender();
+		control->resize();
+		control->draw();
+
+		// Overlays above the new one are drawn again in case it doesn't clip itself around them.
+		const Position position = control->getPosition();
+		for (size_t i = index + 1; i < overlays.size(); ++i)
+			if (overlays[i].control->getPosition().intersects(position))
+				overlays[i].control->draw();
+	}
+
+	bool Terminal::removeOverlay(UI::Control *control, bool delete_old) {
+		auto iter = std::find_if(overlays.begin(), overlays.end(), [control](const Overlay &overlay) {
+			return overlay.control == control;
+		});
+
+		if (iter == overlays.end())
+			return false;
+
+		auto lock = lockRender();
+		const Position region = control->getPosition().intersect(getPosition());
+		const ssize_t index = iter - overlays.begin();
+		if (focused && layerOf(focused) == index)
+			focused = nullptr;
+
+		overlays.erase(iter);
+		control->setParent(nullptr);
+		hitIndex.invalidate();
+		if (delete_old && !control->isArenaOwned())
+			delete control;
+
+		restore(region);
+		return true;
+	}
+
+	bool Terminal::isOccluded(const UI::Control *control) const {
+		if (overlays.empty())
+			return false;
+
+		const Position position = control->getPosition();
+		for (size_t i = layerOf(control) + 1; i < overlays.size(); ++i)
+			if (overlays[i].opaque && overlays[i].control->getPosition().contains(position))
+				return true;
+
+		return false;
+	}
+
+	std::vector<Position> Terminal::getCovers(const UI::Control *control, const Position &region) const {
+		std::vector<Position> covers;
+		for (size_t i = layerOf(control) + 1; i < overlays.size(); ++i) {
+			if (overlays[i].opaque) {
+				const Position cover = overlays[i].control->getPosition().intersect(region);
+				if (0 < cover.width && 0 < cover.height)
+					covers.push_back(cover);
+			}
+		}
+
+		return covers;
 	}
 
 	void Terminal::resetColors() {
@@ -169,14 +428,14 @@ namespace Haunted {
 		// Keep trying on_key, going up to the root as long as we keep getting false. If we're at the root and on_key
 		// still returns false, let the terminal itself handle the keypress as a last resort.
 		while (ptr && !ptr->onKey(key)) {
-			if (dynamic_cast<UI::Control *>(ptr) == root) {
+			if (ptr->asControl() == root) {
 				onKey(key);
 				if (keyPostlistener)
 					keyPostlistener(key);
 				return this;
 			}
 
-			if (UI::Child *cptr = dynamic_cast<UI::Child *>(ptr)) {
+			if (UI::Child *cptr = ptr->asControl()) {
 				ptr = cptr->getParent();
 			} else {
 				if (keyPostlistener)
@@ -208,14 +467,14 @@ namespace Haunted {
 		UI::Container *ptr = control->getParent();
 
 		while (ptr && !ptr->onMouse(report)) {
-			if (dynamic_cast<UI::Control *>(ptr) == root) {
+			if (ptr->asControl() == root) {
 				onMouse(report);
 				if (mousePostlistener)
 					mousePostlistener(report);
 				return this;
 			}
 
-			if (UI::Child *cptr = dynamic_cast<UI::Child *>(ptr)) {
+			if (UI::Child *cptr = ptr->asControl()) {
 				ptr = cptr->getParent();
 			} else {
 				if (mousePostlistener)
@@ -286,17 +545,8 @@ namespace Haunted {
 	}
 
 	UI::Control * Terminal::childAtOffset(int x, int y) const {
-		UI::Container *container = dynamic_cast<UI::Container *>(root);
-		while (container != nullptr) {
-			UI::Control *control = container->childAtOffset(x, y);
-			if (control == nullptr)
-				return nullptr;
-			container = dynamic_cast<UI::Container *>(control);
-			if (container == nullptr)
-				return control;
-		}
-
-		return nullptr;
+		refreshHits();
+		return hitIndex.at(x, y);
 	}
 
 	void Terminal::jumpToFocused() {
@@ -305,12 +555,12 @@ namespace Haunted {
 	}
 
 	void Terminal::jump(int x, int y) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.jump(x, y);
 	}
 
 	void Terminal::mouse(MouseMode mode) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		if (mode == MouseMode::None) {
 			if (mmode != mode) {
 				outStream << "\e[?" << std::to_string(int(mmode)) << ";1006l";
@@ -329,7 +579,7 @@ namespace Haunted {
 	}
 
 	void Terminal::vscroll(int rows) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		if (0 < rows) {
 			outStream.scroll_down(rows);
 		} else if (rows < 0) {
@@ -338,22 +588,22 @@ namespace Haunted {
 	}
 
 	void Terminal::hmargins(size_t left, size_t right) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.hmargins(left, right);
 	}
 
 	void Terminal::hmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.hmargins();
 	}
 
 	void Terminal::vmargins(size_t top, size_t bottom) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.vmargins(top, bottom);
 	}
 
 	void Terminal::vmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.vmargins();
 	}
 
@@ -368,29 +618,131 @@ namespace Haunted {
 	}
 
 	void Terminal::enableHmargins() { // DECLRMM: Left Right Margin Mode
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.enable_hmargins();
 	}
 
 	void Terminal::disableHmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.disable_hmargins();
 	}
 
 	void Terminal::setOrigin() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.set_origin();
 	}
 
 	void Terminal::resetOrigin() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		outStream.reset_origin();
 	}
 
 	std::unique_lock<std::recursive_mutex> Terminal::lockRender() {
+		if (isSingleThreaded()) {
+			assert(onUIThread() && "Rendering outside the UI thread");
+			return {};
+		}
+
 		return std::unique_lock<std::recursive_mutex>(renderMutex);
 	}
 
+	void Terminal::setUIThread() {
+		uiThread.store(std::this_thread::get_id(), std::memory_order_release);
+		colors.setLocking(false);
+	}
+
+	bool Terminal::onUIThread() const {
+		const std::thread::id id = uiThread.load(std::memory_order_acquire);
+		return id == std::thread::id() || id == std::this_thread::get_id();
+	}
+
+	void Terminal::post(TaskQueue::Task task) {
+		tasks.push(std::move(task));
+	}
+
+	size_t Terminal::runPending() {
+		assert(onUIThread() && "Running posted tasks outside the UI thread");
+		size_t count = 0;
+		TaskQueue::Task task;
+		// A pop can fail while a producer is halfway through a push, so keep going as long as tasks are pending.
+		while (!tasks.empty()) {
+			if (tasks.pop(task)) {
+				task();
+				++count;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+
+		return count;
+	}
+
+	TimerWheel::Handle Terminal::setTimeout(TimerWheel::Clock::duration delay, TimerWheel::Callback callback) {
+		assert(onUIThread() && "Setting a timer outside the UI thread");
+		return timers.schedule(delay, std::move(callback));
+	}
+
+	TimerWheel::Handle Terminal::setInterval(TimerWheel::Clock::duration period, TimerWheel::Callback callback) {
+		assert(onUIThread() && "Setting a timer outside the UI thread");
+		return timers.repeat(period, std::move(callback));
+	}
+
+	bool Terminal::cancelTimer(TimerWheel::Handle handle) {
+		assert(onUIThread() && "Cancelling a timer outside the UI thread");
+		return timers.cancel(handle);
+	}
+
+	size_t Terminal::runTimers() {
+		assert(onUIThread() && "Running timers outside the UI thread");
+		return timers.advance();
+	}
+
+	void Terminal::run() {
+		setUIThread();
+		while (alive) {
+			if (const std::optional<TimerWheel::Clock::time_point> deadline = timers.nextDeadline())
+				tasks.waitUntil(*deadline);
+			else
+				tasks.wait();
+
+			const size_t ran = runPending();
+			if (ran + runTimers() != 0)
+				flush();
+		}
+	}
+
+	void Terminal::stop() {
+		alive = false;
+		tasks.wake();
+	}
+
+	void Terminal::postKey(const Key &key) {
+		post([this, key] { handleKey(key); });
+	}
+
+	Signal<Key>::Awaiter Terminal::nextKey() {
+		// Without a UI thread, keys go straight to the controls and nothing would ever resume the waiter.
+		assert(isSingleThreaded() && "Awaiting a key on a terminal without a UI thread");
+		assert(onUIThread() && "Awaiting a key outside the UI thread");
+		return keyWaiters.wait();
+	}
+
+	Terminal::SleepAwaiter Terminal::sleep(TimerWheel::Clock::duration delay) {
+		assert(isSingleThreaded() && "Sleeping on a terminal without a UI thread");
+		assert(onUIThread() && "Sleeping outside the UI thread");
+		return SleepAwaiter(*this, delay);
+	}
+
+	Terminal::SleepAwaiter Terminal::nextFrame() {
+		assert(isSingleThreaded() && "Awaiting a frame on a terminal without a UI thread");
+		assert(onUIThread() && "Awaiting a frame outside the UI thread");
+		return SleepAwaiter(*this, TimerWheel::Clock::duration::zero());
+	}
+
+	void Terminal::SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+		terminal.setTimeout(delay, [handle] { handle.resume(); });
+	}
+
 
 // Public operators
 
@@ -564,7 +916,7 @@ namespace Haunted {
 				dbg.restore().right(6)         << top << ") "_d;
 				dbg.restore().right(10).save() << width;
 				dbg.restore().right(3)         << " × "_d << height << ansi::endl;
-				if (UI::Container *cont = dynamic_cast<UI::Container *>(control))
+				if (UI::Container *cont = control->asContainer())
 					for (UI::Control *child: cont->getChildren())
 						queue.push_back({depth + 1, child});
 			}
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "haunted/core/ThreadPool.h"
+
+namespace Haunted {
+	namespace {
+		/** The pool and worker index of the current thread, if it's a worker. */
+		thread_local const ThreadPool *currentPool = nullptr;
+		thread_local size_t currentIndex = 0;
+	}
+
+	ThreadPool::ThreadPool(size_t threads) {
+		if (threads == 0)
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		workers.reserve(threads);
+		for (size_t i = 0; i < threads; ++i)
+			workers.push_back(std::make_unique<Worker>());
+
+		// Every queue has to exist before any worker starts looking for something to steal.
+		for (size_t i = 0; i < threads; ++i)
+			workers[i]->thread = std::thread(&ThreadPool::work, this, i);
+	}
+
+	ThreadPool::~ThreadPool() {
+		stopping.store(true, std::memory_order_release);
+		signals.fetch_add(1, std::memory_order_release);
+		signals.notify_all();
+		for (auto &worker: workers)
+			worker->thread.join();
+	}
+
+
+// Private instance methods
+
+
+	bool ThreadPool::take(size_t index, Task &task) {
+		{
+			Worker &own = *workers[index];
+			std::unique_lock lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+
+		for (size_t offset = 1; offset < workers.size(); ++offset) {
+			Worker &victim = *workers[(index + offset) % workers.size()];
+			std::unique_lock lock(victim.mutex, std::try_to_lock);
+			if (lock.owns_lock() && !victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::work(size_t index) {
+		currentPool = this;
+		currentIndex = index;
+
+		Task task;
+		for (;;) {
+			if (take(index, task)) {
+				queued.fetch_sub(1, std::memory_order_acq_rel);
+				task();
+				task = nullptr;
+				continue;
+			}
+
+			const uint32_t seen = signals.load(std::memory_order_acquire);
+			// A queue that was busy during the steal attempt may still have tasks, so only sleep if none are left.
+			if (queued.load(std::memory_order_acquire) != 0)
+				continue;
+			if (stopping.load(std::memory_order_acquire))
+				return;
+			signals.wait(seen, std::memory_order_acquire);
+		}
+	}
+
+
+// Public instance methods
+
+
+	bool ThreadPool::inWorker() const {
+		return currentPool == this;
+	}
+
+	void ThreadPool::execute(Task task) {
+		const size_t index = inWorker()? currentIndex :
+			nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+		// Count the task first so that the count can't drop below zero if a worker takes it right away.
+		queued.fetch_add(1, std::memory_order_acq_rel);
+		{
+			Worker &worker = *workers[index];
+			std::unique_lock lock(worker.mutex);
+			worker.tasks.push_back(std::move(task));
+		}
+
+		signals.fetch_add(1, std::memory_order_release);
+		signals.notify_one();
+	}
+
+
+// Public static methods
+
+
+	ThreadPool & ThreadPool::shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+}
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <bit>
+
+#include "haunted/core/TimerWheel.h"
+
+namespace Haunted {
+	TimerWheel::TimerWheel(Clock::duration tick_, Clock::time_point origin_): tick(tick_), origin(origin_) {
+		for (auto &level: heads)
+			level.fill(NIL);
+	}
+
+
+// Private instance methods
+
+
+	uint64_t TimerWheel::tickAt(Clock::time_point time) const {
+		return time <= origin? 0 : (time - origin) / tick;
+	}
+
+	TimerWheel::Clock::time_point TimerWheel::timeOf(uint64_t tick_number) const {
+		return origin + tick * tick_number;
+	}
+
+	void TimerWheel::link(uint32_t index) {
+		Timer &timer = timers[index];
+		const uint64_t delta = now < timer.expiry? timer.expiry - now : 0;
+
+		int level = 0;
+		uint64_t slot_tick = timer.expiry;
+		if (delta == 0) {
+			slot_tick = now;
+		} else {
+			while (level < LEVELS - 1 && (uint64_t(1) << (SLOT_BITS * (level + 1))) <= delta)
+				++level;
+
+			// Timers past the top level's span wait in its farthest slot and are placed again when it comes around.
+			const uint64_t span = uint64_t(1) << (SLOT_BITS * LEVELS);
+			if (span <= delta)
+				slot_tick = now + span - 1;
+		}
+
+		const int slot = (slot_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+		timer.level = level;
+		timer.slot = slot;
+		timer.previous = NIL;
+		timer.next = heads[level][slot];
+		if (timer.next != NIL)
+			timers[timer.next].previous = index;
+		heads[level][slot] = index;
+		occupied[level] |= uint64_t(1) << slot;
+	}
+
+	void TimerWheel::unlink(uint32_t index) {
+		Timer &timer = timers[index];
+		if (timer.previous != NIL)
+			timers[timer.previous].next = timer.next;
+		else
+			heads[timer.level][timer.slot] = timer.next;
+
+		if (timer.next != NIL)
+			timers[timer.next].previous = timer.previous;
+
+		if (heads[timer.level][timer.slot] == NIL)
+			occupied[timer.level] &= ~(uint64_t(1) << timer.slot);
+		timer.previous = timer.next = NIL;
+	}
+
+	void TimerWheel::release(uint32_t index) {
+		Timer &timer = timers[index];
+		timer.callback = nullptr;
+		++timer.generation;
+		timer.next = freeList;
+		freeList = index;
+		--active;
+	}
+
+	void TimerWheel::cascade(int level, int slot) {
+		uint32_t index = heads[level][slot];
+		heads[level][slot] = NIL;
+		occupied[level] &= ~(uint64_t(1) << slot);
+		while (index != NIL) {
+			const uint32_t next = timers[index].next;
+			link(index);
+			index = next;
+		}
+	}
+
+	std::optional<uint64_t> TimerWheel::nextTick() const {
+		std::optional<uint64_t> best;
+		for (int level = 0; level < LEVELS; ++level) {
+			if (!occupied[level])
+				continue;
+
+			// Slots are visited in order starting after the current one, so rotate the bitmap to start there.
+			const int shift = SLOT_BITS * level;
+			const uint64_t unit = (now >> shift) + 1;
+			const uint64_t rotated = std::rotr(occupied[level], unit & (SLOTS - 1));
+			const uint64_t candidate = (unit + std::countr_zero(rotated)) << shift;
+			if (!best || candidate < *best)
+				best = candidate;
+		}
+
+		return best;
+	}
+
+
+// Public instance methods
+
+
+	TimerWheel::Handle TimerWheel::schedule(Clock::duration delay, Callback callback, Clock::time_point from) {
+		uint32_t index;
+		if (freeList != NIL) {
+			index = freeList;
+			freeList = timers[index].next;
+		} else {
+			index = timers.size();
+			timers.emplace_back();
+		}
+
+		// Round the deadline up to a whole tick so that nothing fires early.
+		const Clock::time_point deadline = from + std::max(delay, Clock::duration::zero());
+		const uint64_t expiry = deadline <= origin? 0 : ((deadline - origin) + tick - Clock::duration(1)) / tick;
+
+		Timer &timer = timers[index];
+		timer.callback = std::move(callback);
+		timer.expiry = std::max(expiry, now + 1);
+		timer.period = 0;
+		++timer.generation;
+		++active;
+		link(index);
+		return {index, timer.generation};
+	}
+
+	TimerWheel::Handle TimerWheel::repeat(Clock::duration period, Callback callback, Clock::time_point from) {
+		const Handle handle = schedule(period, std::move(callback), from);
+		timers[handle.index].period = std::max<uint64_t>((period + tick - Clock::duration(1)) / tick, 1);
+		return handle;
+	}
+
+	bool TimerWheel::cancel(Handle handle) {
+		if (!isScheduled(handle))
+			return false;
+		unlink(handle.index);
+		release(handle.index);
+		return true;
+	}
+
+	bool TimerWheel::isScheduled(Handle handle) const {
+		return handle.index < timers.size() && handle.generation != 0 && timers[handle.index].generation == handle.generation
+			&& (handle.generation & 1) == 1;
+	}
+
+	size_t TimerWheel::advance(Clock::time_point time) {
+		const uint64_t target = tickAt(time);
+		size_t fired = 0;
+
+		while (now < target) {
+			// Jump straight to the next tick with anything to do instead of stepping through empty ones.
+			const std::optional<uint64_t> next = nextTick();
+			if (!next || target < *next) {
+				now = target;
+				break;
+			}
+
+			now = *next;
+			for (int level = LEVELS - 1; 0 < level; --level) {
+				const int shift = SLOT_BITS * level;
+				if ((now & ((uint64_t(1) << shift) - 1)) == 0)
+					cascade(level, (now >> shift) & (SLOTS - 1));
+			}
+
+			const int slot = now & (SLOTS - 1);
+			while (heads[0][slot] != NIL) {
+				const uint32_t index = heads[0][slot];
+				unlink(index);
+				++fired;
+
+				Timer &timer = timers[index];
+				if (timer.period == 0) {
+					Callback callback = std::move(timer.callback);
+					release(index);
+					callback();
+				} else {
+					// A repeating timer that fell behind fires once rather than once for every period it missed.
+					timer.expiry = std::max(now + timer.period, target + 1);
+					link(index);
+					// The callback may schedule timers and reallocate the vector, so it can't be called in place.
+					Callback callback = timer.callback;
+					callback();
+				}
+			}
+		}
+
+		return fired;
+	}
+
+	std::optional<TimerWheel::Clock::time_point> TimerWheel::nextDeadline() const {
+		if (const std::optional<uint64_t> next = nextTick())
+			return timeOf(*next);
+		return std::nullopt;
+	}
+}
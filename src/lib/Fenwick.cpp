@@ -0,0 +1,42 @@
+#include "lib/Fenwick.h"
+
+namespace Haunted {
+	void Fenwick::assign(const std::vector<size_t> &counts) {
+		tree.assign(counts.size() + 1, 0);
+		for (size_t i = 1; i < tree.size(); ++i) {
+			tree[i] += counts[i - 1];
+			const size_t parent = i + (i & -i);
+			if (parent < tree.size())
+				tree[parent] += tree[i];
+		}
+	}
+
+	void Fenwick::add(size_t index, ptrdiff_t delta) {
+		// Unsigned arithmetic wraps around, so adding a negative delta this way subtracts it.
+		for (size_t i = index + 1; i < tree.size(); i += i & -i)
+			tree[i] += static_cast<size_t>(delta);
+	}
+
+	size_t Fenwick::prefix(size_t count) const {
+		size_t sum = 0;
+		for (size_t i = count; 0 < i; i -= i & -i)
+			sum += tree[i];
+		return sum;
+	}
+
+	size_t Fenwick::find(size_t value) const {
+		size_t step = 1;
+		while (step * 2 < tree.size())
+			step *= 2;
+
+		size_t position = 0;
+		for (; 0 < step; step /= 2) {
+			if (position + step < tree.size() && tree[position + step] <= value) {
+				position += step;
+				value -= tree[position];
+			}
+		}
+
+		return position;
+	}
+}
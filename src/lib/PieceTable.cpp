@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "lib/PieceTable.h"
+
+namespace Haunted {
+	PieceTable::PieceTable(std::string_view text) {
+		assign(text);
+	}
+
+
+// Private instance methods
+
+
+	size_t PieceTable::countFeeds(bool added_, size_t start, size_t length) const {
+		const std::vector<size_t> &feeds = feedsOf(added_);
+		const auto first = std::lower_bound(feeds.begin(), feeds.end(), start);
+		return std::lower_bound(first, feeds.end(), start + length) - first;
+	}
+
+	PieceTable::Index PieceTable::allocate(bool added_, size_t start, size_t length) {
+		Index index;
+		if (freeNodes.empty()) {
+			index = nodes.size();
+			nodes.emplace_back();
+		} else {
+			index = freeNodes.back();
+			freeNodes.pop_back();
+			nodes[index] = Node();
+		}
+
+		// xorshift32 is plenty for treap priorities.
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		Node &node = nodes[index];
+		node.priority = seed;
+		node.added = added_;
+		node.start = start;
+		node.length = length;
+		node.feeds = countFeeds(added_, start, length);
+		pull(index);
+		return index;
+	}
+
+	void PieceTable::release(Index index) {
+		std::vector<Index> stack {index};
+		while (!stack.empty()) {
+			const Index top = stack.back();
+			stack.pop_back();
+			if (!top)
+				continue;
+			stack.push_back(nodes[top].left);
+			stack.push_back(nodes[top].right);
+			freeNodes.push_back(top);
+		}
+	}
+
+	void PieceTable::pull(Index index) {
+		Node &node = nodes[index];
+		node.totalLength = nodes[node.left].totalLength + node.length + nodes[node.right].totalLength;
+		node.totalFeeds  = nodes[node.left].totalFeeds  + node.feeds  + nodes[node.right].totalFeeds;
+	}
+
+	PieceTable::Index PieceTable::merge(Index first, Index second) {
+		if (!first || !second)
+			return first? first : second;
+
+		if (nodes[second].priority < nodes[first].priority) {
+			nodes[first].right = merge(nodes[first].right, second);
+			pull(first);
+			return first;
+		}
+
+		nodes[second].left = merge(first, nodes[second].left);
+		pull(second);
+		return second;
+	}
+
+	void PieceTable::split(Index index, size_t offset, Index &first, Index &second) {
+		if (!index) {
+			first = second = 0;
+			return;
+		}
+
+		const size_t left_length = nodes[nodes[index].left].totalLength, length = nodes[index].length;
+
+		if (offset <= left_length) {
+			Index left;
+			split(nodes[index].left, offset, first, left);
+			nodes[index].left = left;
+			second = index;
+		} else if (left_length + length <= offset) {
+			Index right;
+			split(nodes[index].right, offset - left_length - length, right, second);
+			nodes[index].right = right;
+			first = index;
+		} else {
+			// The split point is inside this piece, so it becomes two pieces. The tail goes in front of the right
+			// subtree and the head keeps the left one.
+			const size_t cut = offset - left_length;
+			const Index tail = allocate(nodes[index].added, nodes[index].start + cut, length - cut);
+			Node &node = nodes[index];
+			node.length = cut;
+			node.feeds = countFeeds(node.added, node.start, cut);
+			second = merge(tail, node.right);
+			node.right = 0;
+			first = index;
+		}
+
+		pull(index);
+	}
+
+	void PieceTable::appendTo(Index index, size_t from, size_t to, size_t subtree_start, std::string &out) const {
+		if (!index || to <= subtree_start || subtree_start + nodes[index].totalLength <= from)
+			return;
+
+		const Node &node = nodes[index];
+		const size_t piece_start = subtree_start + nodes[node.left].totalLength;
+		appendTo(node.left, from, to, subtree_start, out);
+
+		const size_t begin = std::max(from, piece_start), end = std::min(to, piece_start + node.length);
+		if (begin < end)
+			out.append(bufferOf(node), node.start + begin - piece_start, end - begin);
+
+		appendTo(node.right, from, to, piece_start + node.length, out);
+	}
+
+	void PieceTable::grow(Index index, size_t offset, size_t length, size_t feeds) {
+		while (index) {
+			Node &node = nodes[index];
+			node.totalLength += length;
+			node.totalFeeds  += feeds;
+			if (index == lastInsert) {
+				node.length += length;
+				node.feeds  += feeds;
+				return;
+			}
+
+			const size_t left_length = nodes[node.left].totalLength;
+			if (offset <= left_length) {
+				index = node.left;
+			} else {
+				offset -= left_length + node.length;
+				index = node.right;
+			}
+		}
+	}
+
+	size_t PieceTable::store(std::string_view text) {
+		const size_t start = added.size();
+		for (size_t i = 0; i < text.size(); ++i)
+			if (text[i] == '\n')
+				addedFeeds.push_back(start + i);
+		added.append(text);
+		return start;
+	}
+
+
+// Public instance methods
+
+
+	size_t PieceTable::lineStart(size_t line) const {
+		if (line == 0)
+			return 0;
+
+		if (nodes[root].totalFeeds < line)
+			return size();
+
+		// Find the line-th line feed; the line starts just after it.
+		size_t remaining = line, offset = 0;
+		Index index = root;
+		while (index) {
+			const Node &node = nodes[index];
+			const size_t left_feeds = nodes[node.left].totalFeeds;
+			if (remaining <= left_feeds) {
+				index = node.left;
+				continue;
+			}
+
+			offset += nodes[node.left].totalLength;
+			remaining -= left_feeds;
+			if (remaining <= node.feeds) {
+				const std::vector<size_t> &feeds = feedsOf(node.added);
+				const auto first = std::lower_bound(feeds.begin(), feeds.end(), node.start);
+				return offset + *(first + remaining - 1) - node.start + 1;
+			}
+
+			offset += node.length;
+			remaining -= node.feeds;
+			index = node.right;
+		}
+
+		return size();
+	}
+
+	size_t PieceTable::lineEnd(size_t line) const {
+		return nodes[root].totalFeeds <= line? size() : lineStart(line + 1) - 1;
+	}
+
+	size_t PieceTable::lineOf(size_t offset) const {
+		offset = std::min(offset, size());
+		size_t line = 0;
+		Index index = root;
+		while (index) {
+			const Node &node = nodes[index];
+			const size_t left_length = nodes[node.left].totalLength;
+			if (offset <= left_length) {
+				index = node.left;
+				continue;
+			}
+
+			line += nodes[node.left].totalFeeds;
+			offset -= left_length;
+			if (offset <= node.length)
+				return line + countFeeds(node.added, node.start, offset);
+
+			line += node.feeds;
+			offset -= node.length;
+			index = node.right;
+		}
+
+		return line;
+	}
+
+	std::string PieceTable::line(size_t line_) const {
+		const size_t start = lineStart(line_);
+		return substr(start, lineEnd(line_) - start);
+	}
+
+	std::string PieceTable::substr(size_t offset, size_t length) const {
+		if (size() < offset)
+			throw std::out_of_range("PieceTable");
+
+		const size_t end = size() - offset < length? size() : offset + length;
+		std::string out;
+		out.reserve(end - offset);
+		appendTo(root, offset, end, 0, out);
+		return out;
+	}
+
+	void PieceTable::insert(size_t offset, std::string_view text) {
+		if (size() < offset)
+			throw std::out_of_range("PieceTable");
+
+		if (text.empty())
+			return;
+
+		const Node &last = nodes[lastInsert];
+		if (lastInsert && offset == lastInsertEnd && last.start + last.length == added.size()) {
+			const size_t feeds_before = addedFeeds.size();
+			store(text);
+			grow(root, offset, text.size(), addedFeeds.size() - feeds_before);
+		} else {
+			const size_t start = store(text);
+			const Index piece = allocate(true, start, text.size());
+			Index first, second;
+			split(root, offset, first, second);
+			root = merge(merge(first, piece), second);
+			lastInsert = piece;
+		}
+
+		lastInsertEnd = offset + text.size();
+	}
+
+	void PieceTable::erase(size_t offset, size_t length) {
+		if (size() <= offset || length == 0)
+			return;
+
+		Index first, rest, middle, last;
+		split(root, offset, first, rest);
+		split(rest, length, middle, last);
+		release(middle);
+		root = merge(first, last);
+		lastInsert = 0;
+	}
+
+	void PieceTable::assign(std::string_view text) {
+		original = text;
+		originalFeeds.clear();
+		for (size_t i = 0; i < original.size(); ++i)
+			if (original[i] == '\n')
+				originalFeeds.push_back(i);
+
+		added.clear();
+		addedFeeds.clear();
+		nodes.assign(1, Node());
+		freeNodes.clear();
+		lastInsert = 0;
+		root = text.empty()? 0 : allocate(false, 0, text.size());
+	}
+}
@@ -1,7 +1,5 @@
-#include <fstream>
-#include <sstream>
-#include <iostream>
-#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
 
 #include "haunted/core/Defs.h"
 
@@ -10,64 +8,146 @@
 #include "lib/formicine/ansi.h"
 
 namespace Haunted {
-	Superstring::Superstring(const std::string &str) {
-		size_t length = str.length();
-		for (size_t i = 0; i < length; ++i) {
-			unsigned char c = str[i];
-			if (c < 0x80) {
-				chunks.push_back(std::string(1, c));
+	Superchar::Superchar(Superchar &&other) noexcept: length_(other.length_) {
+		if (other.isInline()) {
+			std::memcpy(small, other.small, inlineCapacity);
+		} else {
+			large = other.large;
+			other.length_ = 0;
+		}
+	}
+
+	Superchar & Superchar::operator=(const Superchar &other) {
+		if (this != &other)
+			assign(other.data(), other.size());
+		return *this;
+	}
+
+	Superchar & Superchar::operator=(Superchar &&other) noexcept {
+		if (this != &other) {
+			release();
+			length_ = other.length_;
+			if (other.isInline()) {
+				std::memcpy(small, other.small, inlineCapacity);
 			} else {
-				chunks.push_back(str.substr(i, UTF8::width(c)));
+				large = other.large;
+				other.length_ = 0;
 			}
 		}
+
+		return *this;
+	}
+
+	void Superchar::assign(const char *data_, size_t len) {
+		// The source could conceivably point into our own heap buffer, so copy before releasing anything.
+		if (len <= inlineCapacity) {
+			char copy[inlineCapacity];
+			std::memcpy(copy, data_, len);
+			release();
+			std::memcpy(small, copy, len);
+		} else {
+			char *copy = new char[len];
+			std::memcpy(copy, data_, len);
+			release();
+			large = copy;
+		}
+
+		length_ = len;
 	}
 
-	Superstring::iterator Superstring::nth(size_t pos) {
-		iterator iter = begin();
-		for (size_t i = 0; i < pos; ++i, ++iter);
-		return iter;
+	void Superchar::release() {
+		if (!isInline())
+			delete[] large;
+		length_ = 0;
 	}
 
-	std::string Superstring::str() const {
-		std::string out;
-		for (const std::string &sub: chunks)
-			out.append(sub);
-		return out;
+	std::ostream & operator<<(std::ostream &os, const Superchar &sc) {
+		return os.write(sc.data(), sc.size());
 	}
 
-	Superchar & Superstring::operator[](ssize_t pos) {
-		if (pos < 0) {
-			for (ssize_t i = 0; pos < i; --i)
-				chunks.push_front({});
-			return *chunks.begin();
-		} else if (size() <= size_t(pos)) {
-			for (ssize_t i = size(); i <= pos; ++i)
-				chunks.push_back({});
-			return *--chunks.end();
+	Superstring::Superstring(const std::string &str): bytes(str) {
+		const size_t length = str.length();
+		widths.reserve(length);
+		for (size_t i = 0; i < length;) {
+			// Invalid start bytes and truncated sequences are kept as single-byte characters.
+			size_t width = UTF8::width(str[i]);
+			if (width == 0 || length - i < width)
+				width = 1;
+			widths.push_back(width);
+			i += width;
 		}
 
-		return *nth(pos);
+		reindex(0);
+	}
+
+	size_t Superstring::offsetOf(size_t index) const {
+		size_t offset = marks[index / stride];
+		for (size_t i = index - index % stride; i < index; ++i)
+			offset += widths[i];
+		return offset;
+	}
+
+	void Superstring::reindex(size_t from) {
+		const size_t first_mark = from / stride, count = widths.size();
+		marks.resize(count / stride + 1);
+		size_t offset = marks[first_mark];
+		for (size_t i = first_mark * stride; i < count; ++i) {
+			if (i % stride == 0)
+				marks[i / stride] = offset;
+			offset += widths[i];
+		}
+
+		// If the size is an exact multiple of the stride, the last mark points one past the end.
+		if (count % stride == 0)
+			marks.back() = bytes.size();
+	}
+
+	Superchar Superstring::operator[](size_t pos) const {
+		return view(pos);
 	}
 
-	Superchar & Superstring::at(size_t pos) {
+	Superchar Superstring::at(size_t pos) const {
 		if (size() <= pos)
 			throw std::out_of_range("Superstring");
 
-		return *nth(pos);
+		return view(pos);
+	}
+
+	std::string_view Superstring::view(size_t pos) const {
+		return std::string_view(bytes).substr(offsetOf(pos), widths[pos]);
+	}
+
+	void Superstring::set(size_t pos, const Superchar &item) {
+		if (size() <= pos)
+			throw std::out_of_range("Superstring");
+
+		erase(pos, 1);
+		insert(pos, item);
 	}
 
 	std::string Superstring::substr(size_t pos, size_t n) const {
-		return std::string(*this).substr(pos, n);
+		if (size() < pos)
+			throw std::out_of_range("Superstring");
+
+		const size_t start = offsetOf(pos);
+		if (size() - pos <= n)
+			return bytes.substr(start);
+		return bytes.substr(start, offsetOf(pos + n) - start);
 	}
 
 	void Superstring::insert(size_t pos, const Superchar &item) {
-		if (pos == size()) {
-			chunks.push_back(item);
-		} else if (pos == 0) {
-			chunks.push_front(item);
-		} else {
-			chunks.insert(nth(pos), item);
-		}
+		if (size() < pos)
+			throw std::out_of_range("Superstring");
+
+		if (item.empty())
+			return;
+
+		if (UINT8_MAX < item.size())
+			throw std::length_error("Superchar too long for Superstring: " + std::to_string(item.size()) + " bytes");
+
+		bytes.insert(offsetOf(pos), item.data(), item.size());
+		widths.insert(widths.begin() + pos, item.size());
+		reindex(pos);
 	}
 
 	void Superstring::insert(size_t pos, char ch) {
@@ -76,34 +156,47 @@ namespace Haunted {
 
 	void Superstring::dbg() {
 		std::string str = "[" + std::to_string(size()) + "]";
-		for (const Superchar &sc: chunks)
-			str += " \"" + sc + "\"";
+		for (std::string_view sc: *this)
+			str += " \"" + std::string(sc) + "\"";
+		DBG(str);
 	}
 
 	Superstring & Superstring::erase(size_t pos, size_t len) {
-		if (size() == 0 && pos == 0)
+		if (size() <= pos || len == 0)
 			return *this;
 
-		// ansi::jump(0, 4 - x);
-		// std::cout << "[" << size() << " @ " << index << "] erase(" << pos << ", " << len << ")";
+		if (size() - pos < len)
+			len = size() - pos;
+
+		const size_t start = offsetOf(pos);
+		bytes.erase(start, offsetOf(pos + len) - start);
+		widths.erase(widths.begin() + pos, widths.begin() + pos + len);
+		reindex(pos);
+		return *this;
+	}
 
+	void Superstring::clear() {
+		bytes.clear();
+		widths.clear();
+		marks.assign(1, 0);
+	}
 
-		// DBG("[" << size() << "] erase(" << pos << ", " << len << ")");
 
-		// DBG("--- begin = " << &*begin() << ", cursor = " << &*cursor << ", last = " << &*last << ", index = " << index << ", end = " << &*end());
-		iterator iter = nth(pos);
-		iterator last = iter;
-		for (size_t i = 0; i < len; ++i, ++last);
+// Iterator
 
-		chunks.erase(iter, last);
 
+	std::string_view Superstring::iterator::operator*() const {
+		return std::string_view(owner->bytes).substr(offset, owner->widths[index]);
+	}
+
+	Superstring::iterator & Superstring::iterator::operator++() {
+		offset += owner->widths[index++];
 		return *this;
 	}
 
-	size_t Superstring::textLength() const {
-		size_t out = 0;
-		for (const Superchar &sc: chunks)
-			out += sc.length();
-		return out;
+	Superstring::iterator Superstring::iterator::operator++(int) {
+		iterator copy = *this;
+		++*this;
+		return copy;
 	}
 }
@@ -1,6 +1,369 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAUNTED_UTF8_X86
+#endif
+
 #include "lib/UTF8.h"
 
 namespace Haunted {
+	namespace {
+		struct Kernels {
+			const char *name;
+			size_t (*asciiPrefix)(const unsigned char *, size_t);
+			bool (*validate)(const unsigned char *, size_t);
+		};
+
+		/** Returns the length of the sequence started by a lead byte and narrows the range of the byte after it.
+		 *  Returns 0 for bytes that can't start a sequence. */
+		size_t leadLength(unsigned char byte, unsigned char &lower, unsigned char &upper) {
+			lower = 0x80;
+			upper = 0xbf;
+			if (0xc2 <= byte && byte <= 0xdf)
+				return 2;
+
+			if (0xe0 <= byte && byte <= 0xef) {
+				if (byte == 0xe0)
+					lower = 0xa0;
+				else if (byte == 0xed)
+					upper = 0x9f;
+				return 3;
+			}
+
+			if (0xf0 <= byte && byte <= 0xf4) {
+				if (byte == 0xf0)
+					lower = 0x90;
+				else if (byte == 0xf4)
+					upper = 0x8f;
+				return 4;
+			}
+
+			return 0;
+		}
+
+		size_t asciiPrefixScalar(const unsigned char *bytes, size_t length) {
+			size_t i = 0;
+			for (; i + 8 <= length; i += 8) {
+				uint64_t word;
+				std::memcpy(&word, bytes + i, 8);
+				if (word & 0x8080808080808080ull)
+					break;
+			}
+
+			while (i < length && bytes[i] < 0x80)
+				++i;
+			return i;
+		}
+
+		/** Validates with a scalar state machine, skipping ASCII runs with the given kernel. */
+		template <size_t (*AsciiPrefix)(const unsigned char *, size_t)>
+		bool validateScalar(const unsigned char *bytes, size_t length) {
+			for (size_t i = 0; i < length;) {
+				i += AsciiPrefix(bytes + i, length - i);
+				if (i == length)
+					break;
+
+				unsigned char lower, upper;
+				const size_t width = leadLength(bytes[i], lower, upper);
+				if (width == 0 || length - i < width || bytes[i + 1] < lower || upper < bytes[i + 1])
+					return false;
+
+				for (size_t j = 2; j < width; ++j)
+					if ((bytes[i + j] & 0xc0) != 0x80)
+						return false;
+
+				i += width;
+			}
+
+			return true;
+		}
+
+#ifdef HAUNTED_UTF8_X86
+		size_t asciiPrefixSSE2(const unsigned char *bytes, size_t length) {
+			size_t i = 0;
+			for (; i + 16 <= length; i += 16) {
+				const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i)));
+				if (mask != 0)
+					return i + __builtin_ctz(mask);
+			}
+
+			return i + asciiPrefixScalar(bytes + i, length - i);
+		}
+
+#define HAUNTED_AVX2 __attribute__((target("avx2")))
+
+		HAUNTED_AVX2 size_t asciiPrefixAVX2(const unsigned char *bytes, size_t length) {
+			size_t i = 0;
+			for (; i + 32 <= length; i += 32) {
+				const int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + i)));
+				if (mask != 0)
+					return i + __builtin_ctz(static_cast<unsigned>(mask));
+			}
+
+			return i + asciiPrefixScalar(bytes + i, length - i);
+		}
+
+		// The AVX2 validator classifies every pair of adjacent bytes with three nibble lookups and checks that the
+		// continuation bytes line up with the lead bytes two and three positions before them (Keiser & Lemire,
+		// "Validating UTF-8 in less than one instruction per byte").
+		struct Table {
+			alignas(32) uint8_t bytes[32];
+		};
+
+		constexpr Table repeat(const std::array<uint8_t, 16> &values) {
+			Table table {};
+			for (size_t i = 0; i < 32; ++i)
+				table.bytes[i] = values[i % 16];
+			return table;
+		}
+
+		constexpr uint8_t TOO_SHORT  = 1 << 0, TOO_LONG = 1 << 1, OVERLONG_3 = 1 << 2, TOO_LARGE = 1 << 3,
+		                  SURROGATE  = 1 << 4, OVERLONG_2 = 1 << 5, TOO_LARGE_1000 = 1 << 6, OVERLONG_4 = 1 << 6,
+		                  TWO_CONTS  = 1 << 7, CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+		constexpr Table byte1High = repeat({
+			TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+			TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+			TOO_SHORT | OVERLONG_2,
+			TOO_SHORT,
+			TOO_SHORT | OVERLONG_3 | SURROGATE,
+			TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+		});
+
+		constexpr Table byte1Low = repeat({
+			CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+			CARRY | OVERLONG_2,
+			CARRY,
+			CARRY,
+			CARRY | TOO_LARGE,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+		});
+
+		constexpr Table byte2High = repeat({
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		});
+
+		/** Bytes greater than these at the end of a block start a sequence that continues into the next block. */
+		constexpr Table incompleteLimits = [] {
+			Table table {};
+			for (size_t i = 0; i < 32; ++i)
+				table.bytes[i] = 0xff;
+			table.bytes[29] = 0xf0 - 1;
+			table.bytes[30] = 0xe0 - 1;
+			table.bytes[31] = 0xc0 - 1;
+			return table;
+		}();
+
+		HAUNTED_AVX2 inline __m256i load(const Table &table) {
+			return _mm256_load_si256(reinterpret_cast<const __m256i *>(table.bytes));
+		}
+
+		/** Returns the input shifted right by N bytes, with the last N bytes of the previous block shifted in. */
+		template <int N>
+		HAUNTED_AVX2 inline __m256i shiftIn(__m256i input, __m256i previous) {
+			return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+		}
+
+		HAUNTED_AVX2 inline __m256i highNibbles(__m256i input) {
+			return _mm256_and_si256(_mm256_srli_epi16(input, 4), _mm256_set1_epi8(0x0f));
+		}
+
+		struct AVX2State {
+			__m256i previous, incomplete, error;
+		};
+
+		HAUNTED_AVX2 inline void checkBlock(AVX2State &state, __m256i input) {
+			if (_mm256_movemask_epi8(input) == 0) {
+				state.error = _mm256_or_si256(state.error, state.incomplete);
+				state.incomplete = _mm256_setzero_si256();
+				state.previous = input;
+				return;
+			}
+
+			const __m256i prev1 = shiftIn<1>(input, state.previous);
+			const __m256i special = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(load(byte1High), highNibbles(prev1)),
+					_mm256_shuffle_epi8(load(byte1Low), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+				_mm256_shuffle_epi8(load(byte2High), highNibbles(input)));
+
+			// Only bytes two after a 111_____ or three after a 1111____ end up with their high bit set here.
+			const __m256i third  = _mm256_subs_epu8(shiftIn<2>(input, state.previous), _mm256_set1_epi8(0xe0 - 0x80));
+			const __m256i fourth = _mm256_subs_epu8(shiftIn<3>(input, state.previous), _mm256_set1_epi8(0xf0 - 0x80));
+			const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+				_mm256_set1_epi8(static_cast<char>(0x80)));
+
+			state.error = _mm256_or_si256(state.error, _mm256_xor_si256(must23, special));
+			state.incomplete = _mm256_subs_epu8(input, load(incompleteLimits));
+			state.previous = input;
+		}
+
+		HAUNTED_AVX2 bool validateAVX2(const unsigned char *bytes, size_t length) {
+			AVX2State state {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+			size_t i = 0;
+			for (; i + 32 <= length; i += 32)
+				checkBlock(state, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + i)));
+
+			if (i < length) {
+				// Pad the tail with NULs; a sequence cut off by the end of the input is then followed by ASCII and
+				// gets flagged as too short.
+				alignas(32) unsigned char tail[32] = {0};
+				std::memcpy(tail, bytes + i, length - i);
+				checkBlock(state, _mm256_load_si256(reinterpret_cast<const __m256i *>(tail)));
+			}
+
+			state.error = _mm256_or_si256(state.error, state.incomplete);
+			return _mm256_testz_si256(state.error, state.error);
+		}
+#endif
+
+		const Kernels & kernels() {
+			static const Kernels chosen = [] {
+#ifdef HAUNTED_UTF8_X86
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2"))
+					return Kernels {"avx2", asciiPrefixAVX2, validateAVX2};
+				if (__builtin_cpu_supports("sse2"))
+					return Kernels {"sse2", asciiPrefixSSE2, validateScalar<asciiPrefixSSE2>};
+#endif
+				return Kernels {"scalar", asciiPrefixScalar, validateScalar<asciiPrefixScalar>};
+			}();
+			return chosen;
+		}
+
+		template <typename Unit>
+		void widen(const unsigned char *bytes, size_t length, Unit *out) {
+			size_t i = 0;
+#ifdef __SSE2__
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= length; i += 16) {
+				const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+				const __m128i low = _mm_unpacklo_epi8(input, zero), high = _mm_unpackhi_epi8(input, zero);
+				if constexpr (sizeof(Unit) == 2) {
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), low);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), high);
+				} else {
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),      _mm_unpacklo_epi16(low, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4),  _mm_unpackhi_epi16(low, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8),  _mm_unpacklo_epi16(high, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 12), _mm_unpackhi_epi16(high, zero));
+				}
+			}
+#endif
+			for (; i < length; ++i)
+				out[i] = bytes[i];
+		}
+
+		size_t put(char32_t codepoint, char32_t *out) {
+			*out = codepoint;
+			return 1;
+		}
+
+		size_t put(char32_t codepoint, char16_t *out) {
+			if (codepoint < 0x10000) {
+				*out = codepoint;
+				return 1;
+			}
+
+			codepoint -= 0x10000;
+			out[0] = 0xd800 | (codepoint >> 10);
+			out[1] = 0xdc00 | (codepoint & 0x3ff);
+			return 2;
+		}
+
+		template <typename Unit>
+		size_t decodeInto(std::string_view in, Unit *out) {
+			const Kernels &chosen = kernels();
+			const auto *bytes = reinterpret_cast<const unsigned char *>(in.data());
+			const size_t length = in.size();
+
+			UTF8::Decoder decoder;
+			char32_t decoded[2];
+			size_t i = 0, written = 0;
+			while (i < length) {
+				if (!decoder.pending() && bytes[i] < 0x80) {
+					const size_t run = chosen.asciiPrefix(bytes + i, length - i);
+					widen(bytes + i, run, out + written);
+					i += run;
+					written += run;
+					continue;
+				}
+
+				const int count = decoder.feed(bytes[i++], decoded);
+				for (int j = 0; j < count; ++j)
+					written += put(decoded[j], out + written);
+			}
+
+			if (decoder.finish())
+				written += put(UTF8::replacement, out + written);
+
+			return written;
+		}
+	}
+
+	int UTF8::Decoder::feed(unsigned char byte, char32_t out[2]) {
+		if (needed == 0) {
+			if (byte < 0x80) {
+				out[0] = byte;
+				return 1;
+			}
+
+			const size_t width = leadLength(byte, lower, upper);
+			if (width == 0) {
+				out[0] = replacement;
+				return 1;
+			}
+
+			needed = width - 1;
+			codepoint = byte & (0x7f >> width);
+			return 0;
+		}
+
+		if (byte < lower || upper < byte) {
+			// The sequence so far is a maximal invalid subpart. Replace it and start over with this byte.
+			finish();
+			out[0] = replacement;
+			return 1 + feed(byte, out + 1);
+		}
+
+		lower = 0x80;
+		upper = 0xbf;
+		codepoint = (codepoint << 6) | (byte & 0x3f);
+		if (++seen < needed)
+			return 0;
+
+		out[0] = codepoint;
+		finish();
+		return 1;
+	}
+
+	bool UTF8::Decoder::finish() {
+		const bool had_partial = needed != 0;
+		codepoint = 0;
+		needed = seen = 0;
+		lower = 0x80;
+		upper = 0xbf;
+		return had_partial;
+	}
+
 	size_t UTF8::width(unsigned char uch) {
 		if (uch < 0x80)           return 1;
 		if ((uch & 0xe0) == 0xc0) return 2;
@@ -8,4 +371,68 @@ namespace Haunted {
 		if ((uch & 0xf8) == 0xf0) return 4;
 		return 0;
 	}
+
+	const char * UTF8::implementation() {
+		return kernels().name;
+	}
+
+	size_t UTF8::asciiPrefix(std::string_view str) {
+		return kernels().asciiPrefix(reinterpret_cast<const unsigned char *>(str.data()), str.size());
+	}
+
+	bool UTF8::isValid(std::string_view str) {
+		return kernels().validate(reinterpret_cast<const unsigned char *>(str.data()), str.size());
+	}
+
+	size_t UTF8::decode(std::string_view in, char32_t *out) {
+		return decodeInto(in, out);
+	}
+
+	size_t UTF8::decode(std::string_view in, char16_t *out) {
+		return decodeInto(in, out);
+	}
+
+	std::u32string UTF8::decode32(std::string_view in) {
+		std::u32string out(in.size(), U'\0');
+		out.resize(decode(in, out.data()));
+		return out;
+	}
+
+	std::u16string UTF8::decode16(std::string_view in) {
+		std::u16string out(in.size(), u'\0');
+		out.resize(decode(in, out.data()));
+		return out;
+	}
+
+	void UTF8::encode(char32_t codepoint, std::string &out) {
+		if ((0xd800 <= codepoint && codepoint <= 0xdfff) || 0x10ffff < codepoint)
+			codepoint = replacement;
+
+		if (codepoint < 0x80) {
+			out.push_back(codepoint);
+		} else if (codepoint < 0x800) {
+			out.push_back(0xc0 | (codepoint >> 6));
+			out.push_back(0x80 | (codepoint & 0x3f));
+		} else if (codepoint < 0x10000) {
+			out.push_back(0xe0 | (codepoint >> 12));
+			out.push_back(0x80 | ((codepoint >> 6) & 0x3f));
+			out.push_back(0x80 | (codepoint & 0x3f));
+		} else {
+			out.push_back(0xf0 | (codepoint >> 18));
+			out.push_back(0x80 | ((codepoint >> 12) & 0x3f));
+			out.push_back(0x80 | ((codepoint >> 6) & 0x3f));
+			out.push_back(0x80 | (codepoint & 0x3f));
+		}
+	}
+
+	std::string UTF8::sanitize(std::string_view in) {
+		if (isValid(in))
+			return std::string(in);
+
+		std::string out;
+		out.reserve(in.size() + 8);
+		for (char32_t codepoint: decode32(in))
+			encode(codepoint, out);
+		return out;
+	}
 }
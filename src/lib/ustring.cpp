@@ -1,18 +1,24 @@
 #ifdef ENABLE_ICU
 
+#include <algorithm>
 #include <cstring>
 
 #include "lib/ustring.h"
+#include "lib/UTF8.h"
 #include "lib/formicine/ansi.h"
 
 namespace Haunted {
-	ustring::ustring(const char *str) {
-		data = icu::UnicodeString::fromUTF8(str);
-		scanLength();
-	}
+	ustring::ustring(const char *str): ustring(std::string_view(str)) {}
+
+	ustring::ustring(const std::string &str): ustring(std::string_view(str)) {}
 
-	ustring::ustring(const std::string &str) {
-		data = icu::UnicodeString::fromUTF8(str);
+	ustring::ustring(std::string_view str) {
+		// A UTF-8 string never decodes to more UTF-16 code units than it has bytes, so decode straight into ICU's
+		// buffer instead of going through fromUTF8.
+		char16_t *units = data.getBuffer(std::max<int32_t>(str.size(), 1));
+		if (!units)
+			throw std::bad_alloc();
+		data.releaseBuffer(UTF8::decode(str, units));
 		scanLength();
 	}
 
@@ -59,7 +65,7 @@ namespace Haunted {
 
 		icu::UnicodeString raw;
 		ustring::iterator end_ = end();
-		for (size_t i = 0; i < len && iter < end_; ++i) {
+		for (size_t i = 0; i < len && iter != end_; ++i) {
 			raw.append(data.tempSubString(iter.prev, iter.pos - iter.prev));
 			++iter;
 		}
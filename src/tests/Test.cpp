@@ -1,28 +1,53 @@
 // #define NODEBUG
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
 #include <cassert>
+#include <csignal>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/ioctl.h>
 
 #include "lib/formicine/ansi.h"
 #include "haunted/tests/Test.h"
 #include "haunted/core/CSI.h"
+#include "haunted/core/Coroutine.h"
 #include "haunted/core/DummyTerminal.h"
 #include "haunted/core/Key.h"
+#include "haunted/core/OffscreenTerminal.h"
+#include "haunted/core/TaskQueue.h"
+#include "haunted/core/ThreadPool.h"
+#include "haunted/core/TimerWheel.h"
 #include "haunted/core/Util.h"
 #include "haunted/core/Terminal.h"
 #include "haunted/ui/boxes/SimpleBox.h"
 #include "haunted/ui/boxes/ExpandoBox.h"
+#include "haunted/ui/boxes/PropoBox.h"
+#include "haunted/ui/boxes/SwapBox.h"
+#include "haunted/ui/Arena.h"
+#include "haunted/ui/HitIndex.h"
 #include "haunted/ui/Label.h"
+#include "haunted/ui/ListView.h"
+#include "haunted/ui/PaintContext.h"
+#include "haunted/ui/Table.h"
+#include "haunted/ui/TextArea.h"
 #include "haunted/ui/Textbox.h"
 #include "haunted/ui/TextInput.h"
+#include "haunted/ui/TreeView.h"
+#include "lib/Fenwick.h"
+#include "lib/PieceTable.h"
+#include "lib/Superstring.h"
+#include "lib/UTF8.h"
 #include "lib/ustring.h"
 
 #ifdef NODEBUG
@@ -32,6 +57,84 @@
 #endif
 
 namespace Haunted::Tests {
+	namespace {
+		/** A control that only counts how many times it's been painted. */
+		class PaintCounter: public UI::Control {
+			public:
+				int paints = 0;
+				PaintCounter(): Control(nullptr, Position()) {}
+				void draw() override { if (canDraw()) ++paints; }
+		};
+
+		/** A colored control that only counts how many times it's been painted. */
+		class ColoredCounter: public UI::Control, public UI::Colored {
+			public:
+				int paints = 0;
+				ColoredCounter(bool inherit_bg):
+					Control(nullptr, Position()), Colored(ansi::color::normal, ansi::color::normal, false, inherit_bg) {}
+				void draw() override { if (canDraw()) ++paints; }
+				Terminal * getTerminal() override { return terminal; }
+				UI::Container * getParent() const override { return parent; }
+		};
+
+		/** An offscreen terminal that follows the window's size like a real one. */
+		class ResizableTerminal: public OffscreenTerminal {
+			public:
+				using OffscreenTerminal::OffscreenTerminal;
+				void watchSize() override { Terminal::watchSize(); }
+
+			protected:
+				void winch(int rows_, int cols_) override { Terminal::winch(rows_, cols_); }
+		};
+
+		/** A control that writes a line of text and counts how many times it's been painted. */
+		class Writer: public UI::Control {
+			public:
+				std::string text;
+				int paints = 0;
+				Writer(const std::string &text_): Control(nullptr, Position()), text(text_) {}
+				void draw() override {
+					if (!canDraw())
+						return;
+					++paints;
+					terminal->jump(position.left, position.top);
+					*terminal << text;
+				}
+		};
+
+		Task<int> addAfterFrame(Terminal &term, int a, int b) {
+			co_await term.nextFrame();
+			co_return a + b;
+		}
+
+		Task<> throwing() {
+			throw std::runtime_error("oops");
+			co_return;
+		}
+
+		Task<> catching(bool &caught) {
+			try {
+				co_await throwing();
+			} catch (const std::runtime_error &) {
+				caught = true;
+			}
+		}
+
+		/** Waits for a submission, a delay, a key and a frame, noting its progress in the counters. */
+		Task<> prompt(Terminal &term, UI::TextInput &input, std::vector<int> &stages, bool &correct) {
+			const std::string name = co_await input.submitted();
+			correct = correct && name == "abc";
+			++stages[0];
+			co_await term.sleep(std::chrono::milliseconds(5));
+			++stages[1];
+			const Key key = co_await term.nextKey();
+			correct = correct && key == Key('y');
+			++stages[2];
+			correct = correct && co_await addAfterFrame(term, 2, 3) == 5;
+			++stages[3];
+		}
+	}
+
 	std::pair<int, int> maintest::parse_csi(const std::string &input) {
 		Haunted::CSI testcsi(input);
 		return {testcsi.first, testcsi.second};
@@ -468,6 +571,1031 @@ namespace Haunted::Tests {
 		ansi::out << ansi::endl;
 	}
 
+	void maintest::unittest_flex(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::Boxes::Flex.\n", ansi::style::bold));
+
+		std::vector<int> lengths;
+		auto join = [&] {
+			std::string out;
+			for (const int length: lengths)
+				out += (out.empty()? "" : " ") + std::to_string(length);
+			return out;
+		};
+
+		Flex::layout({{10}, {-1}, {-1}, {-1}}, 100, lengths);
+		unit.check(join(), std::string("10 30 30 30"), "equal split");
+		Flex::layout({{-1}, {-1}, {-1}}, 10, lengths);
+		unit.check(join(), std::string("4 3 3"), "remainder goes first");
+		Flex::layout({{-1, 1}, {-1, 3}}, 100, lengths);
+		unit.check(join(), std::string("25 75"), "weights 1:3");
+		Flex::layout({{-1, 1, 0, 10}, {-1}, {-1}}, 100, lengths);
+		unit.check(join(), std::string("10 45 45"), "maximum");
+		Flex::layout({{-1, 1, 40}, {-1, 1}, {-1, 2}}, 100, lengths);
+		unit.check(join(), std::string("40 20 40"), "minimum");
+		Flex::layout({{-1, 1, 0, 10}, {-1, 1, 0, 20}}, 100, lengths);
+		unit.check(join(), std::string("10 20"), "every maximum reached");
+		Flex::layout({{60}, {-1, 1, 30}, {20}}, 100, lengths);
+		unit.check(join(), std::string("60 30 10"), "overflow is cut off at the end");
+		Flex::layout({{-1}, {-1}}, -1, lengths);
+		unit.check(join(), std::string("0 0"), "negative length");
+
+		// Many panes with a mix of constraints should still fill the length exactly and respect every limit.
+		std::vector<Flex::Item> items;
+		for (int i = 0; i < 500; ++i)
+			items.push_back(i % 7 == 0? Flex::Item {3} : Flex::Item {-1, 1.0 + i % 3, i % 5, i % 11 == 0? 8 : -1});
+		Flex::layout(items, 9973, lengths);
+		int sum = 0;
+		bool within_limits = true;
+		for (size_t i = 0; i < items.size(); ++i) {
+			sum += lengths[i];
+			if (items[i].expands())
+				within_limits = within_limits && items[i].minimum <= lengths[i] &&
+					(items[i].maximum < 0 || lengths[i] <= items[i].maximum);
+		}
+		unit.check(sum, 9973, "sum of 500 lengths");
+		unit.check(within_limits, true, "500 lengths within limits");
+
+		DummyTerminal dummy;
+		SimpleBox wrapper(&dummy);
+		wrapper.resize({0, 0, 90, 30});
+
+		UI::VectorBox *tb1 = new UI::VectorBox(nullptr);
+		UI::VectorBox *tb2 = new UI::VectorBox(nullptr);
+		UI::VectorBox *tb3 = new UI::VectorBox(nullptr);
+		PropoBox *propo = new PropoBox(&wrapper, BoxOrientation::Horizontal, {{tb1, 1}, {tb2, 2}, {tb3, 3}},
+			wrapper.getPosition());
+		propo->resize();
+		unit.check(tb1->getPosition(), {0,  0, 15, 30}, "tb1 position");
+		unit.check(tb2->getPosition(), {15, 0, 30, 30}, "tb2 position");
+		unit.check(tb3->getPosition(), {45, 0, 45, 30}, "tb3 position");
+		propo->setWeight(0, 4);
+		unit.check(tb1->getPosition(), {0,  0, 40, 30}, "tb1 position after setWeight(0, 4)");
+
+		INFO("Resizing nested boxes.");
+		PaintCounter *counters[] = {new PaintCounter, new PaintCounter, new PaintCounter};
+		SimpleBox root(&dummy);
+		ExpandoBox *outer = new ExpandoBox(&root, BoxOrientation::Vertical);
+		new PropoBox(outer, 1.0, BoxOrientation::Horizontal, counters[0], counters[1]);
+		counters[2]->setParent(outer);
+		outer->addChild(counters[2], 1);
+		root.resize({0, 0, 80, 24});
+		outer->resize({0, 0, 80, 24});
+		unit.check(counters[0]->paints + counters[1]->paints + counters[2]->paints, 0, "paints after resize()");
+		root.draw();
+		unit.check(counters[0]->paints == 1 && counters[1]->paints == 1 && counters[2]->paints == 1, true,
+			"each control painted once after draw()");
+		unit.check(counters[1]->getPosition(), {40, 0, 40, 23}, "nested position");
+
+		INFO("Growing an autoresizing label.");
+		PaintCounter *row[] = {new PaintCounter, new PaintCounter, new PaintCounter};
+		UI::Label *status = new UI::Label("Ready", true);
+		ExpandoBox *bar = new ExpandoBox(&root, BoxOrientation::Horizontal);
+		for (UI::Control *control: std::initializer_list<UI::Control *> {row[0], status, row[1], row[2]})
+			control->setParent(bar);
+		bar->addChild(row[0], 10);
+		bar->addChild(status, 5);
+		bar->addChild(row[1], -1);
+		bar->addChild(row[2], 10);
+		bar->resize({0, 0, 80, 1});
+		bar->draw();
+		status->setText("Loading");
+		unit.check(status->getPosition(), {10, 0, 7, 1}, "label position");
+		unit.check(row[1]->getPosition(), {17, 0, 53, 1}, "expanding sibling position");
+		unit.check(row[0]->paints == 1 && row[1]->paints == 2 && row[2]->paints == 1, true,
+			"only the expanding sibling is repainted");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_hitindex(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::HitIndex.\n", ansi::style::bold));
+
+		DummyTerminal dummy;
+		UI::HitIndex &index = dummy.hitIndex;
+		index.resize(80, 24);
+
+		PaintCounter *panes[] = {new PaintCounter, new PaintCounter, new PaintCounter};
+		SimpleBox root(&dummy);
+		ExpandoBox *outer = new ExpandoBox(&root, BoxOrientation::Vertical);
+		new PropoBox(outer, 1.0, BoxOrientation::Horizontal, panes[0], panes[1]);
+		panes[2]->setParent(outer);
+		outer->addChild(panes[2], 1);
+		root.resize({0, 0, 80, 24});
+		outer->resize({0, 0, 80, 24});
+
+		unit.check(index.isStale(), true, "isStale() after building the tree");
+		index.rebuild(&root);
+		unit.check(index.at(0,  0)  == panes[0], true, "at(0, 0)");
+		unit.check(index.at(40, 22) == panes[1], true, "at(40, 22)");
+		unit.check(index.at(79, 23) == panes[2], true, "at(79, 23)");
+		unit.check(index.at(80, 0)  == nullptr,  true, "at(80, 0)");
+
+		INFO("Growing the bottom pane.");
+		outer->setItem(panes[2], {3});
+		unit.check(index.isStale(), false, "isStale() after setItem()");
+		unit.check(index.at(40, 21) == panes[2], true, "at(40, 21)");
+		unit.check(index.at(39, 20) == panes[0], true, "at(39, 20)");
+
+		// The incrementally updated index should agree with a fresh one everywhere.
+		std::vector<UI::Control *> incremental;
+		for (int y = 0; y < 24; ++y)
+			for (int x = 0; x < 80; ++x)
+				incremental.push_back(index.at(x, y));
+		index.rebuild(&root);
+		bool same = true;
+		for (int y = 0; y < 24; ++y)
+			for (int x = 0; x < 80; ++x)
+				same = same && incremental[y * 80 + x] == index.at(x, y);
+		unit.check(same, true, "incremental index matches rebuilt index");
+
+		unit.check(outer->asContainer() == outer && outer->asControl() == outer, true, "ExpandoBox interfaces");
+		unit.check(outer->asColored() == static_cast<UI::Colored *>(outer), true, "ExpandoBox::asColored()");
+		unit.check(panes[0]->asContainer() == nullptr && panes[0]->asColored() == nullptr, true, "PaintCounter interfaces");
+		unit.check(dummy.asContainer() == &dummy && dummy.asControl() == nullptr, true, "Terminal interfaces");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_colored(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::Colored.\n", ansi::style::bold));
+
+		DummyTerminal dummy;
+		SimpleBox root(&dummy);
+		ExpandoBox *outer = new ExpandoBox(&root, BoxOrientation::Horizontal);
+		ExpandoBox *inner = new ExpandoBox(outer, BoxOrientation::Vertical);
+		ColoredCounter *inheriting = new ColoredCounter(true), *fixed = new ColoredCounter(false);
+		ColoredCounter *nested[] = {new ColoredCounter(true), new ColoredCounter(true)};
+		for (ColoredCounter *counter: {inheriting, fixed}) {
+			counter->setParent(outer);
+			outer->addChild(counter, -1);
+		}
+		for (ColoredCounter *counter: nested) {
+			counter->setParent(inner);
+			inner->addChild(counter, -1);
+		}
+		root.resize({0, 0, 80, 24});
+		outer->resize({0, 0, 80, 24});
+		inner->setInherit(false, true);
+
+		auto paints = [&] {
+			return std::to_string(inheriting->paints) + " " + std::to_string(fixed->paints) + " "
+				+ std::to_string(nested[0]->paints) + " " + std::to_string(nested[1]->paints);
+		};
+
+		nested[0]->paints = nested[1]->paints = 0;
+		outer->setBackground(ansi::color::blue);
+		unit.check(paints(), std::string("1 0 1 1"), "paints after setBackground(blue)");
+		unit.check(nested[1]->getBackground() == ansi::color::blue, true, "nested background");
+		outer->setBackground(ansi::color::blue);
+		unit.check(paints(), std::string("1 0 1 1"), "paints after setting the same background");
+		outer->setForeground(ansi::color::red);
+		unit.check(paints(), std::string("1 0 1 1"), "paints after setForeground(red)");
+
+		INFO("Stopping inheritance in the inner box.");
+		inner->setInherit(false, false);
+		outer->setBackground(ansi::color::green);
+		unit.check(paints(), std::string("2 0 1 1"), "paints after setBackground(green)");
+		unit.check(nested[0]->getBackground() == ansi::color::blue, true, "nested background");
+
+		INFO("Moving a control out of the inner box.");
+		unit.check(nested[0]->asColored() == nested[0], true, "asColored()");
+		nested[0]->applyColors();
+		unit.check(dummy.colors.getBackground() == ansi::color::blue, true, "background before moving");
+		inner->removeChild(nested[0]);
+		nested[0]->setParent(outer);
+		outer->addChild(nested[0], -1);
+		nested[0]->applyColors();
+		unit.check(dummy.colors.getBackground() == ansi::color::green, true, "background after moving");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_arena(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::Arena.\n", ansi::style::bold));
+
+		DummyTerminal dummy;
+		SimpleBox root(&dummy);
+		UI::Arena arena;
+
+		for (int round = 0; round < 2; ++round) {
+			ExpandoBox *view = arena.make<ExpandoBox>(&root, BoxOrientation::Vertical);
+			for (int i = 0; i < 999; ++i) {
+				PaintCounter *counter = arena.make<PaintCounter>();
+				counter->setParent(view);
+				view->addChild(counter, 1);
+			}
+
+			unit.check(arena.size(), 1000UL, "size() in round " + std::to_string(round));
+			unit.check(arena.blockCount() <= 3, true, "few blocks in round " + std::to_string(round));
+			unit.check(root.size(), 1UL, "root.size() in round " + std::to_string(round));
+			arena.clear();
+			unit.check(root.size(), 0UL, "root.size() after clear() in round " + std::to_string(round));
+		}
+
+		INFO("Mixing arena-owned and heap-allocated controls.");
+		bool deleted = false;
+		struct Tracker: PaintCounter {
+			bool &deleted;
+			Tracker(bool &deleted_): deleted(deleted_) {}
+			~Tracker() { deleted = true; }
+		};
+
+		ExpandoBox *view = arena.make<ExpandoBox>(&root, BoxOrientation::Vertical);
+		Tracker *heap = new Tracker(deleted);
+		heap->setParent(view);
+		view->addChild(heap, -1);
+		unit.check(view->isArenaOwned() && !heap->isArenaOwned(), true, "isArenaOwned()");
+		arena.clear();
+		unit.check(deleted, true, "heap-allocated child deleted with its arena-owned parent");
+
+		INFO("Reusing blocks.");
+		UI::Arena small(1024);
+		small.make<std::array<std::byte, 64 * 1024>>();
+		small.make<std::array<std::byte, 512>>();
+		unit.check(small.blockCount(), 2UL, "an oversize block followed by a regular one");
+		small.clear();
+		small.make<std::array<std::byte, 64 * 1024>>();
+		unit.check(small.blockCount(), 1UL, "largest block kept by clear()");
+
+		INFO("Destroying a terminal before the arena that owns its root.");
+		UI::Arena view_arena;
+		{
+			OffscreenTerminal screen(24, 80);
+			screen.setRoot(view_arena.make<SimpleBox>(&screen));
+		}
+		unit.check(view_arena.size(), 1UL, "root left to its arena");
+		view_arena.clear();
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_swapbox(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::Boxes::SwapBox.\n", ansi::style::bold));
+
+		OffscreenTerminal screen(24, 80);
+		SimpleBox root(&screen);
+		Writer *alpha = new Writer("alpha"), *beta = new Writer("beta");
+		SwapBox *swap = new SwapBox(&root, {0, 0, 80, 24}, {alpha, beta});
+		root.resize({0, 0, 80, 24});
+		swap->resize({0, 0, 80, 24});
+		beta->resize({0, 0, 80, 24});
+		root.draw();
+		unit.check(alpha->paints, 1, "alpha paints after draw()");
+
+		auto shown = [&](const std::string &text) {
+			return screen.getRecording().find(text) != std::string::npos;
+		};
+
+		screen.clearRecording();
+		swap->setActive(beta);
+		unit.check(alpha->paints == 2 && beta->paints == 1, true, "alpha recorded and beta drawn");
+		unit.check(swap->hasFrame(alpha), true, "hasFrame(alpha)");
+		unit.check(shown("beta") && !shown("alpha"), true, "only beta shown");
+
+		screen.clearRecording();
+		swap->setActive(alpha);
+		unit.check(alpha->paints, 2, "alpha paints after replaying its frame");
+		unit.check(shown("alpha"), true, "alpha shown after replaying its frame");
+		unit.check(swap->hasFrame(beta) && !swap->hasFrame(alpha), true, "frames after swapping back");
+
+		screen.hitIndex.resize(80, 24);
+		screen.hitIndex.rebuild(&root);
+		unit.check(screen.hitIndex.at(0, 0) == alpha, true, "hidden children aren't hit-tested");
+
+		INFO("Updating a hidden child.");
+		beta->text = "gamma";
+		beta->draw();
+		const int beta_paints = beta->paints;
+		screen.clearRecording();
+		swap->setActive(beta);
+		unit.check(beta->paints, beta_paints, "beta paints after replaying its frame");
+		unit.check(shown("gamma") && !shown("alpha"), true, "update made while hidden shown");
+
+		INFO("Resizing while a child is hidden.");
+		swap->resize({0, 0, 80, 12});
+		int alpha_paints = alpha->paints;
+		swap->setActive(alpha);
+		unit.check(alpha->paints, alpha_paints + 1, "alpha drawn after the box was resized");
+		unit.check(alpha->getPosition(), {0, 0, 80, 12}, "alpha position");
+
+		INFO("Disabling and limiting frames.");
+		swap->setFrameCapacity(0);
+		unit.check(swap->hasFrame(beta), false, "no frames with a capacity of zero");
+		alpha_paints = alpha->paints;
+		swap->setActive(beta);
+		unit.check(alpha->paints, alpha_paints, "alpha not recorded with a capacity of zero");
+		swap->setFrameCapacity(4);
+		swap->setFrameLimit(4);
+		swap->setActive(alpha);
+		unit.check(swap->hasFrame(beta), true, "hasFrame(beta) with a small limit");
+		screen.clearRecording();
+		swap->setActive(beta);
+		unit.check(shown("gamma"), true, "beta drawn after its frame overflowed");
+
+		INFO("Switching on a terminal with a UI thread.");
+		OffscreenTerminal threaded(24, 80);
+		threaded.setUIThread();
+		SimpleBox threaded_root(&threaded);
+		Writer *delta = new Writer("delta"), *epsilon = new Writer("epsilon");
+		SwapBox *threaded_swap = new SwapBox(&threaded_root, {0, 0, 80, 24}, {delta, epsilon});
+		threaded_root.resize({0, 0, 80, 24});
+		threaded_swap->resize({0, 0, 80, 24});
+		epsilon->resize({0, 0, 80, 24});
+		threaded_root.draw();
+
+		// Timers fire on the tick after the one they're set in.
+		auto tick = [&] {
+			const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			while (threaded.runTimers() == 0 && std::chrono::steady_clock::now() < give_up)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		};
+
+		threaded_swap->setActive(epsilon);
+		unit.check(delta->paints, 1, "delta not recorded during the switch");
+		threaded_swap->setActive(delta);
+		unit.check(delta->paints, 2, "delta drawn when its frame hasn't been recorded");
+		tick();
+		unit.check(epsilon->paints, 2, "epsilon recorded by the timer");
+
+		// Once both children have frames, a switch only replays one and the timer records the other.
+		threaded.clearRecording();
+		threaded_swap->setActive(epsilon);
+		unit.check(delta->paints == 2 && epsilon->paints == 2, true, "nothing drawn during the switch");
+		unit.check(threaded.getRecording().find("epsilon") != std::string::npos, true, "epsilon replayed");
+		tick();
+		unit.check(delta->paints, 3, "delta recorded by the timer");
+		threaded_swap->setActive(delta);
+		unit.check(delta->paints == 3 && epsilon->paints == 2, true, "nothing drawn switching back");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_paint(Testing &unit) {
+		INFO(wrap("Testing Haunted::UI::PaintContext.\n", ansi::style::bold));
+
+		OffscreenTerminal screen(24, 80);
+		UI::PaintContext paint(screen, {10, 2, 5, 3});
+		auto shown = [&](const std::string &text) {
+			return screen.getRecording().find(text) != std::string::npos;
+		};
+
+		paint.write(0, 0, "abcdefgh");
+		unit.check(shown("abcde") && !shown("abcdef"), true, "text cut off at the right edge");
+		screen.clearRecording();
+		paint.write(3, 1, "xyz");
+		unit.check(shown("xy") && !shown("xyz"), true, "text cut off after an offset");
+		screen.clearRecording();
+		paint.write(0, 3, "below");
+		paint.write(5, 0, "right");
+		paint.write(-1, 0, "left");
+		unit.check(screen.getRecording(), "", "text outside the rectangle ignored");
+
+		paint.clearRow(1, 2);
+		unit.check(shown("   ") && !shown("    "), true, "clearRow() prints spaces up to the right edge");
+		screen.clearRecording();
+		paint.clear();
+		unit.check(shown("     ") && !shown("      "), true, "clear() prints spaces within the rectangle");
+
+		unit.check(paint.scroll(1), false, "scroll() without horizontal margins");
+		screen.hmarginsSupported = true;
+		unit.check(paint.scroll(1), true, "scroll() with horizontal margins");
+		screen.hmarginsSupported = false;
+		unit.check(UI::PaintContext(screen, {0, 2, 80, 3}).scroll(1), true, "scroll() across the full width");
+		unit.check(UI::PaintContext(screen, {0, 2, 80, 3}).clearsCheaply(), true, "clearsCheaply() at the edges");
+		unit.check(paint.clearsCheaply(), false, "clearsCheaply() away from the edges");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_listview(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::ListView.\n", ansi::style::bold));
+
+		OffscreenTerminal screen(24, 80);
+		SimpleBox root(&screen);
+		root.resize({0, 0, 80, 24});
+
+		size_t fetched = 0;
+		UI::ListView *list = new UI::ListView(&root, {0, 0, 80, 10}, 2'000'000, [&](size_t index) {
+			++fetched;
+			return "user" + std::to_string(index);
+		});
+
+		auto shown = [&](const std::string &text) {
+			return screen.getRecording().find(text) != std::string::npos;
+		};
+
+		list->draw();
+		unit.check(fetched, 10UL, "items fetched by draw()");
+		unit.check(shown("user9") && !shown("user10"), true, "only visible items shown");
+
+		fetched = 0;
+		list->select(3);
+		unit.check(fetched, 1UL, "items fetched when selecting without scrolling");
+
+		size_t selections = 0, activated = UI::ListView::NONE;
+		list->listen(UI::ListView::Event::Select, [&](const UI::ListView &, size_t) { ++selections; });
+		list->listen(UI::ListView::Event::Activate, [&](const UI::ListView &, size_t index) { activated = index; });
+
+		list->select(9);
+		fetched = 0;
+		screen.clearRecording();
+		list->onKey(Key(KeyType::DownArrow));
+		unit.check(list->getSelected(), 10UL, "selection after down arrow");
+		unit.check(list->getTop(), 1UL, "top after scrolling by one");
+		unit.check(fetched <= 3, true, "few items fetched when scrolling by one");
+		unit.check(shown("user10"), true, "new row shown");
+
+		list->onKey(Key(KeyType::End));
+		unit.check(list->getSelected(), 1'999'999UL, "selection after end");
+		unit.check(list->getTop(), 1'999'990UL, "top after end");
+		list->onKey(Key(KeyType::PageUp));
+		unit.check(list->getSelected(), 1'999'989UL, "selection after page up");
+		list->onKey(Key(KeyType::Home));
+		unit.check(list->getSelected() == 0 && list->getTop() == 0, true, "selection and top after home");
+		unit.check(selections, 5UL, "select events");
+
+		list->onMouse(MouseReport(0, 'M', 4, 6));
+		unit.check(list->getSelected(), 6UL, "selection after a click");
+		list->onMouse(MouseReport(65, 'M', 4, 6));
+		unit.check(list->getTop(), 3UL, "top after scrolling the wheel");
+		list->onKey(Key(KeyType::Enter));
+		unit.check(activated, 6UL, "activated item");
+
+		INFO("Changing the number of items.");
+		list->setItems(5, [&](size_t index) { ++fetched; return "item" + std::to_string(index); });
+		fetched = 0;
+		list->setCount(7);
+		unit.check(fetched, 2UL, "items fetched after appending two");
+		list->select(6);
+		list->setCount(4);
+		unit.check(list->getSelected(), 3UL, "selection after removing items");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_table(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::Table.\n", ansi::style::bold));
+
+		OffscreenTerminal screen(60, 200);
+		SimpleBox root(&screen);
+		root.resize({0, 0, 200, 60});
+
+		std::vector<int> values;
+		for (int i = 0; i < 1000; ++i)
+			values.push_back((i * 7919) % 1000);
+
+		size_t fetched = 0;
+		auto accessor = [&](size_t row, size_t column) {
+			++fetched;
+			if (column == 0)
+				return "host" + std::to_string(row);
+			const std::string value = std::to_string(values[row]);
+			return std::string(4 - value.size(), '0') + value;
+		};
+
+		UI::Table *table = new UI::Table(&root, {0, 0, 200, 60}, {{"Host"}, {"Value", 6}}, values.size(), accessor);
+		fetched = 0;
+		table->draw();
+		unit.check(fetched, 118UL, "cells fetched by draw()");
+		unit.check(table->getColumnWidth(0), 6, "fitted width after draw()");
+
+		fetched = 0;
+		values[5] = 1;
+		table->updateCell(5, 1);
+		unit.check(fetched, 1UL, "cells fetched by updateCell()");
+		table->updateCell(500, 1);
+		unit.check(fetched, 1UL, "cells fetched when updating an invisible row");
+
+		INFO("Sorting and filtering.");
+		auto sorted = [&]() {
+			for (size_t i = 1; i < table->getVisibleCount(); ++i)
+				if (values[table->sourceRow(i)] < values[table->sourceRow(i - 1)])
+					return false;
+			return true;
+		};
+
+		table->sortBy(1);
+		unit.check(sorted(), true, "rows sorted");
+		values[42] = 0;
+		table->updateCell(42, 1);
+		unit.check(table->viewRow(42) <= 1 && sorted(), true, "row moved after its sort key changed");
+
+		values.push_back(500);
+		values.push_back(-1);
+		table->setRowCount(values.size());
+		unit.check(sorted() && table->sourceRow(0) == 1001, true, "appended rows merged into the order");
+
+		table->setFilter([&](size_t row) { return values[row] % 2 == 0; });
+		unit.check(table->viewRow(5), UI::Table::NONE, "filtered row hidden");
+		values[5] = 2;
+		table->updateCell(5, 1);
+		unit.check(table->viewRow(5) != UI::Table::NONE && sorted(), true, "row shown after it passed the filter");
+		values.push_back(3);
+		table->setRowCount(values.size());
+		unit.check(table->viewRow(1002), UI::Table::NONE, "appended row hidden by the filter");
+		values[1002] = 4;
+		table->updateCell(1002, 1);
+		unit.check(table->viewRow(1002) != UI::Table::NONE && sorted(), true,
+			"appended row shown after it passed the filter");
+		table->setFilter({});
+		table->unsort();
+		unit.check(table->viewRow(42), 42UL, "original order restored");
+
+		INFO("Deferring updates.");
+		table->setDeferred(true);
+		fetched = 0;
+		for (int i = 0; i < 3; ++i)
+			table->updateCell(3, 1);
+		unit.check(fetched, 0UL, "no cells fetched while deferred");
+		table->drawUpdates();
+		unit.check(fetched, 1UL, "repeated updates to a cell painted once");
+		table->setDeferred(false);
+
+		INFO("Virtualizing columns.");
+		std::vector<UI::Table::Column> columns(100, {"", 9});
+		table->setColumns(columns);
+		fetched = 0;
+		table->draw();
+		unit.check(fetched, 59UL * 20, "cells fetched with 100 columns");
+		table->setFirstColumn(95);
+		unit.check(fetched, 59UL * 25, "cells fetched after scrolling right");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_treeview(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing Haunted::UI::TreeView.\n", ansi::style::bold));
+
+		Fenwick counts({3, 1, 4, 1, 5});
+		unit.check(counts.prefix(3), 8UL, "Fenwick prefix");
+		unit.check(counts.find(7), 2UL, "Fenwick find");
+		counts.add(2, -3);
+		unit.check(counts.total(), 11UL, "Fenwick total after subtracting");
+		unit.check(counts.find(5), 3UL, "Fenwick find after subtracting");
+
+		OffscreenTerminal screen(24, 80);
+		SimpleBox root(&screen);
+		root.resize({0, 0, 80, 24});
+
+		// Every node has ten children, named after their path, down to a depth of four.
+		size_t loads = 0;
+		UI::TreeView *tree = nullptr;
+		auto provider = [&](size_t node) {
+			++loads;
+			const std::string prefix = node == UI::TreeView::ROOT? "n" : tree->getText(node) + ".";
+			const size_t depth = node == UI::TreeView::ROOT? 0 : tree->getDepth(node) + 1;
+			std::vector<UI::TreeView::Item> items;
+			for (size_t i = 0; i < 10; ++i)
+				items.push_back({prefix + std::to_string(i), depth < 3, i});
+			return items;
+		};
+
+		tree = new UI::TreeView(&root, {0, 0, 80, 10});
+		tree->setProvider(provider);
+		unit.check(loads, 1UL, "provider calls for the top level");
+		unit.check(tree->getRowCount(), 10UL, "rows before expanding");
+
+		auto shown = [&](const std::string &text) {
+			return screen.getRecording().find(text) != std::string::npos;
+		};
+
+		auto consistent = [&] {
+			for (size_t row = 0; row < tree->getRowCount(); ++row)
+				if (tree->rowOf(tree->nodeAt(row)) != row)
+					return false;
+			return tree->nodeAt(tree->getRowCount()) == UI::TreeView::NONE;
+		};
+
+		const size_t first = tree->nodeAt(0);
+		screen.clearRecording();
+		tree->expand(first);
+		unit.check(loads, 2UL, "provider calls after expanding");
+		unit.check(tree->getRowCount(), 20UL, "rows after expanding");
+		unit.check(shown("- n0") && shown("n0.8") && !shown("n0.9"), true, "expanded node and its children drawn");
+		unit.check(shown("n1") || shown("n2"), false, "shifted rows moved instead of redrawn");
+		unit.check(consistent(), true, "rows and nodes agree after expanding");
+
+		const size_t child = tree->getChildren(first)[5];
+		tree->expand(child);
+		const size_t grandchild = tree->getChildren(child)[7];
+		unit.check(tree->getText(grandchild), std::string("n0.5.7"), "text of a grandchild");
+		tree->collapse(child);
+		unit.check(tree->rowOf(grandchild), UI::TreeView::NONE, "row of a hidden node");
+		tree->select(grandchild);
+		unit.check(loads, 3UL, "provider calls after selecting a hidden node");
+		unit.check(tree->rowOf(grandchild), 14UL, "row of the selected node");
+		unit.check(tree->getTop(), 5UL, "top after selecting");
+		unit.check(consistent(), true, "rows and nodes agree after selecting");
+
+		tree->collapse(first);
+		unit.check(tree->getRowCount(), 10UL, "rows after collapsing");
+		unit.check(tree->getSelected(), first, "selection moved out of the collapsed subtree");
+		unit.check(tree->getTop(), 0UL, "top after collapsing");
+		tree->expand(first);
+		unit.check(loads, 3UL, "provider calls after expanding again");
+		unit.check(tree->getRowCount(), 30UL, "rows after expanding again");
+		unit.check(consistent(), true, "rows and nodes agree after expanding again");
+
+		tree->select(tree->nodeAt(0));
+		tree->onKey(Key(KeyType::DownArrow));
+		tree->onKey(Key(KeyType::RightArrow));
+		unit.check(tree->getRowCount(), 40UL, "rows after expanding with the right arrow");
+		tree->onKey(Key(KeyType::RightArrow));
+		unit.check(tree->getText(tree->getSelected()), std::string("n0.0.0"), "selection after the right arrow");
+		tree->onKey(Key(KeyType::LeftArrow));
+		tree->onKey(Key(KeyType::LeftArrow));
+		unit.check(tree->getRowCount(), 30UL, "rows after collapsing with the left arrow");
+
+		tree->onKey(Key(KeyType::End));
+		unit.check(tree->getText(tree->getSelected()), std::string("n9"), "selection after end");
+		tree->onMouse(MouseReport(0, 'M', 0, 9));
+		unit.check(tree->getRowCount(), 40UL, "rows after clicking a marker");
+		unit.check(consistent(), true, "rows and nodes agree after clicking");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_overlay(Testing &unit) {
+		using namespace Haunted::UI::Boxes;
+		INFO(wrap("Testing overlays.\n", ansi::style::bold));
+
+		OffscreenTerminal screen(24, 80);
+		SimpleBox *root = new SimpleBox(&screen);
+		Writer *left = new Writer("left"), *right = new Writer("right");
+		PropoBox *halves = new PropoBox(root, 1.0, BoxOrientation::Horizontal, left, right);
+		screen.setRoot(root);
+		halves->resize({0, 0, 80, 24});
+		screen.draw();
+		unit.check(left->getPosition(), Position(0, 0, 40, 24), "left half");
+		unit.check(left->paints == 1 && right->paints == 1, true, "paints before adding overlays");
+
+		auto shown = [&](const std::string &text) {
+			return screen.getRecording().find(text) != std::string::npos;
+		};
+
+		Writer *cover = new Writer("cover");
+		cover->resize({0, 0, 40, 24});
+		screen.addOverlay(cover);
+		unit.check(cover->paints, 1, "overlay painted when added");
+		unit.check(screen.isOccluded(left) && !screen.isOccluded(right), true, "occlusion");
+		unit.check(screen.childAtOffset(5, 5) == cover, true, "hit test on an overlay");
+		unit.check(screen.childAtOffset(45, 5) == right, true, "hit test beside an overlay");
+
+		screen.draw();
+		unit.check(left->paints, 1, "occluded control skipped");
+		unit.check(right->paints == 2 && cover->paints == 2, true, "other controls painted");
+
+		Writer *popup = new Writer("popup");
+		popup->resize({50, 5, 10, 3});
+		screen.addOverlay(popup, 1, false);
+		UI::PaintContext paint(screen, right->getPosition(), right);
+		unit.check(paint.isCovered(), false, "transparent overlay doesn't cover");
+
+		INFO("Removing overlays.");
+		screen.clearRecording();
+		unit.check(screen.removeOverlay(popup), true, "removing an overlay");
+		unit.check(right->paints == 3 && left->paints == 1 && cover->paints == 2, true,
+			"only the control under the overlay repainted");
+		unit.check(screen.removeOverlay(popup, false), false, "removing an overlay twice");
+
+		Writer *menu = new Writer("menu");
+		menu->resize({43, 0, 4, 1});
+		screen.addOverlay(menu, 2);
+		screen.clearRecording();
+		UI::PaintContext covered(screen, right->getPosition(), right);
+		covered.write(0, 0, "abcdefghij");
+		unit.check(shown("abc") && shown("hij") && !shown("abcd") && !shown("defg"), true,
+			"writes clipped around overlays");
+		unit.check(covered.scroll(1), false, "scrolling under an overlay");
+		unit.check(UI::PaintContext(screen, menu->getPosition(), menu).isCovered(), false,
+			"overlay not covered by itself");
+
+		screen.removeOverlay(cover);
+		unit.check(left->paints == 2 && right->paints == 3, true, "control repainted after removing its cover");
+		unit.check(screen.childAtOffset(5, 5) == left, true, "hit test after removing an overlay");
+
+		INFO("Highlighted rows under overlays.");
+		OffscreenTerminal list_screen(10, 20);
+		SimpleBox *list_root = new SimpleBox(&list_screen);
+		UI::ListView *list = new UI::ListView(list_root, {0, 0, 20, 3}, 3, [](size_t index) {
+			return "item" + std::to_string(index) + "-abcdefghijk";
+		});
+		list_screen.setRoot(list_root);
+		list->select(0);
+		Writer *middle_cover = new Writer("##"), *end_cover = new Writer("####");
+		middle_cover->resize({6, 0, 2, 1});
+		end_cover->resize({16, 0, 4, 1});
+		list_screen.addOverlay(middle_cover);
+		list_screen.addOverlay(end_cover);
+		list_screen.clearRecording();
+		list->draw();
+		const std::string list_drawn = list_screen.getRecording();
+		unit.check(list_drawn.find("\e[7mitem0-\e[27m") != std::string::npos, true,
+			"highlight closed before an overlay");
+		unit.check(list_drawn.find("\e[7mcdefghij\e[27m") != std::string::npos, true,
+			"highlight kept after an overlay and closed before one covering the end of the row");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_taskqueue(Testing &unit) {
+		INFO(wrap("Testing Haunted::TaskQueue.\n", ansi::style::bold));
+
+		constexpr int producers = 4, per_producer = 20'000;
+		TaskQueue queue;
+		std::vector<int> last(producers, -1);
+		bool ordered = true;
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; ++p)
+			threads.emplace_back([&, p] {
+				for (int i = 0; i < per_producer; ++i)
+					queue.push([&, p, i] {
+						ordered = ordered && last[p] == i - 1;
+						last[p] = i;
+					});
+			});
+
+		int popped = 0;
+		TaskQueue::Task task;
+		while (popped < producers * per_producer) {
+			if (queue.pop(task)) {
+				task();
+				++popped;
+			} else {
+				queue.wait();
+			}
+		}
+
+		for (std::thread &thread: threads)
+			thread.join();
+
+		unit.check(popped, producers * per_producer, "tasks popped");
+		unit.check(ordered, true, "tasks from each producer run in order");
+		unit.check(queue.empty() && !queue.pop(task), true, "queue empty afterward");
+
+		INFO("Posting to a UI thread.");
+		OffscreenTerminal screen(24, 80);
+		unit.check(screen.isSingleThreaded(), false, "no UI thread by default");
+		unit.check(screen.lockRender().owns_lock(), true, "render lock taken without a UI thread");
+		screen.setUIThread();
+		unit.check(screen.onUIThread() && screen.isSingleThreaded(), true, "UI thread set");
+		unit.check(screen.lockRender().owns_lock(), false, "render lock skipped on the UI thread");
+
+		bool other_thread = true;
+		int ran = 0;
+		std::thread poster([&] {
+			other_thread = screen.onUIThread();
+			for (int i = 0; i < 100; ++i)
+				screen.post([&] { ++ran; });
+			screen.post([&] { screen.stop(); });
+		});
+
+		screen.run();
+		poster.join();
+		unit.check(other_thread, false, "other threads aren't the UI thread");
+		unit.check(ran, 100, "posted tasks run by run()");
+		unit.check(screen.alive.load(), false, "run() stopped");
+
+		INFO("Resizing with a UI thread.");
+		ResizableTerminal resizable(3, 5);
+		resizable.setUIThread();
+		resizable.watchSize();
+		std::raise(SIGWINCH);
+		// The new size arrives as a task posted by the thread that reads the signal handler's pipe.
+		size_t resizes = 0;
+		for (int i = 0; i < 100 && resizes == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			resizes = resizable.runPending();
+		}
+		winsize size;
+		ioctl(STDIN_FILENO, TIOCGWINSZ, &size);
+		unit.check(resizes, 1UL, "resize posted to the UI thread");
+		unit.check(resizable.getRows() == size.ws_row && resizable.getCols() == size.ws_col, true,
+			"size changed on the UI thread");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_threadpool(Testing &unit) {
+		INFO(wrap("Testing Haunted::ThreadPool.\n", ansi::style::bold));
+
+		ThreadPool pool(4);
+		unit.check(pool.size(), 4UL, "size()");
+
+		std::vector<Future<long>> sums;
+		for (long i = 0; i < 100; ++i)
+			sums.push_back(pool.submit([i] {
+				long sum = 0;
+				for (long j = 0; j <= i * 1000; ++j)
+					sum += j;
+				return sum;
+			}));
+
+		bool correct = true;
+		for (long i = 0; i < 100; ++i)
+			correct = correct && sums[i].get() == i * 1000 * (i * 1000 + 1) / 2;
+		unit.check(correct, true, "submitted results");
+
+		// Tasks that submit more tasks from inside the pool.
+		std::atomic<int> leaves = 0;
+		std::function<void(int)> spawn = [&](int depth) {
+			if (depth == 0) {
+				++leaves;
+				return;
+			}
+
+			for (int i = 0; i < 4; ++i)
+				pool.execute([&spawn, depth] { spawn(depth - 1); });
+		};
+
+		pool.submit([&] { spawn(6); }).get();
+		while (leaves < 4096)
+			std::this_thread::yield();
+		unit.check(leaves.load(), 4096, "nested tasks run");
+
+		auto chained = pool.submit([] { return 20; }).then([](int n) { return n + 1; }).then([](int n) {
+			return std::to_string(n * 2);
+		});
+		unit.check(chained.get(), std::string("42"), "chained continuations");
+
+		auto failed = pool.submit([]() -> int { throw std::runtime_error("oops"); }).then([](int n) { return n; });
+		bool caught = false;
+		try {
+			failed.get();
+		} catch (const std::runtime_error &) {
+			caught = true;
+		}
+		unit.check(caught, true, "exceptions passed along continuations");
+
+		INFO("Posting results to a UI thread.");
+		OffscreenTerminal screen(24, 80);
+		screen.setUIThread();
+		const std::thread::id ui = std::this_thread::get_id();
+		bool on_ui = false;
+		auto posted = pool.submit([] { return 7; }).then(screen, [&](int n) {
+			on_ui = std::this_thread::get_id() == ui;
+			return n * 6;
+		});
+
+		while (!posted.isReady())
+			screen.runPending();
+		unit.check(posted.get(), 42, "result of a posted continuation");
+		unit.check(on_ui, true, "continuation ran on the UI thread");
+
+		const std::string path = "/tmp/haunted_history_test";
+		UI::History saved;
+		for (const char *line: {"one", "two", "three"})
+			saved.add(line);
+		saved.save(path);
+		auto loaded = UI::History::loadInBackground(path, 10, pool).get();
+		unit.check(loaded && loaded->size() == 3 && loaded->at(loaded->newest()) == "three", true,
+			"history loaded in the background");
+		unit.check(UI::History::loadInBackground(path + ".missing", 10, pool).get() == nullptr, true,
+			"missing history file");
+		std::remove(path.c_str());
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_timerwheel(Testing &unit) {
+		INFO(wrap("Testing Haunted::TimerWheel.\n", ansi::style::bold));
+
+		using ms = std::chrono::milliseconds;
+		const TimerWheel::Clock::time_point start = TimerWheel::Clock::now();
+		TimerWheel wheel(ms(10), start);
+		unit.check(wheel.nextDeadline().has_value(), false, "no deadline while idle");
+
+		std::vector<int> fired;
+		wheel.schedule(ms(25), [&] { fired.push_back(25); }, start);
+		unit.check(wheel.nextDeadline() == start + ms(30), true, "deadline rounded up to a tick");
+		unit.check(wheel.advance(start + ms(29)), 0UL, "nothing fires early");
+		unit.check(wheel.advance(start + ms(30)), 1UL, "timer fires at its tick");
+		unit.check(fired.size() == 1 && wheel.empty(), true, "one-shot timer freed");
+
+		for (int delay: {101, 105, 109})
+			wheel.schedule(ms(delay), [&, delay] { fired.push_back(delay); }, start);
+		unit.check(wheel.advance(start + ms(110)), 3UL, "timers due in the same tick fire together");
+
+		auto cancelled = wheel.schedule(ms(50), [&] { fired.push_back(-1); }, start);
+		unit.check(wheel.isScheduled(cancelled), true, "isScheduled()");
+		unit.check(wheel.cancel(cancelled), true, "cancel()");
+		unit.check(wheel.cancel(cancelled), false, "cancel() twice");
+		unit.check(wheel.advance(start + ms(200)), 0UL, "cancelled timer doesn't fire");
+
+		int ticks = 0;
+		TimerWheel::Handle interval;
+		interval = wheel.repeat(ms(50), [&] {
+			if (++ticks == 3)
+				wheel.cancel(interval);
+		}, start + ms(200));
+		wheel.advance(start + ms(250));
+		wheel.advance(start + ms(300));
+		unit.check(ticks, 2, "repeating timer");
+		wheel.advance(start + ms(1000));
+		unit.check(ticks, 3, "missed repetitions skipped");
+		wheel.advance(start + ms(2000));
+		unit.check(ticks == 3 && wheel.empty(), true, "timer cancelled from its own callback");
+
+		// Ten minutes is 60,000 ticks, far enough to start two levels up.
+		bool far = false;
+		wheel.schedule(std::chrono::minutes(10), [&] { far = true; }, start + ms(2000));
+		const auto due = start + ms(2000) + std::chrono::minutes(10);
+		bool early = false;
+		int wakeups = 0;
+		while (!far) {
+			const auto deadline = wheel.nextDeadline();
+			if (!deadline)
+				break;
+			wheel.advance(*deadline);
+			early = early || (far && *deadline < due);
+			++wakeups;
+		}
+
+		unit.check(far, true, "distant timer cascades down and fires");
+		unit.check(early, false, "distant timer doesn't fire early");
+		unit.check(wakeups <= 3, true, "empty ticks skipped");
+		unit.check(wheel.nextDeadline().has_value(), false, "idle again");
+
+		INFO("Running timers on a UI thread.");
+		OffscreenTerminal screen(24, 80);
+		screen.setUIThread();
+		int blinks = 0;
+		auto blink = screen.setInterval(ms(1), [&] { ++blinks; });
+		screen.setTimeout(ms(20), [&] {
+			screen.cancelTimer(blink);
+			screen.stop();
+		});
+
+		screen.run();
+		unit.check(0 < blinks && blinks <= 20, true, "interval runs in run()");
+		unit.check(screen.alive.load(), false, "timeout stops run()");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_coroutine(Testing &unit) {
+		INFO(wrap("Testing Haunted::Task.\n", ansi::style::bold));
+
+		bool caught = false;
+		spawn(catching(caught));
+		unit.check(caught, true, "exceptions rethrown in the awaiting coroutine");
+
+		OffscreenTerminal screen(24, 80);
+		screen.setUIThread();
+		UI::TextInput *input = new UI::TextInput(&screen);
+		screen.setRoot(input);
+		input->focus();
+
+		// Every flow waits on the same input and terminal at once, on this thread alone.
+		constexpr int flows = 200;
+		std::vector<int> stages(4, 0);
+		bool correct = true;
+		for (int i = 0; i < flows; ++i)
+			spawn(prompt(screen, *input, stages, correct));
+
+		auto drive = [&](int stage) {
+			const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (stages[stage] < flows && std::chrono::steady_clock::now() < give_up) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				screen.runPending();
+				screen.runTimers();
+			}
+		};
+
+		for (char ch: std::string("abc"))
+			screen.postKey(Key(ch));
+		screen.postKey(Key(KeyType::Enter));
+		screen.runPending();
+		unit.check(stages[0], flows, "input.submitted()");
+		unit.check(stages[1], 0, "flows asleep");
+
+		drive(1);
+		unit.check(stages[1], flows, "term.sleep()");
+
+		screen.postKey(Key('y'));
+		screen.runPending();
+		unit.check(stages[2], flows, "term.nextKey()");
+		unit.check(input->getText(), std::string("abc"), "awaited key not sent to the input");
+
+		drive(3);
+		unit.check(stages[3], flows, "term.nextFrame() in a nested task");
+		unit.check(correct, true, "values passed to flows");
+
+		screen.postKey(Key('z'));
+		screen.runPending();
+		unit.check(input->getText(), std::string("abcz"), "keys go to controls once nothing is waiting");
+
+		ansi::out << ansi::endl;
+	}
+
 	void maintest::unittest_ustring(Testing &unit) {
 		std::string example = "foo🎉🇩🇪👮🏻‍♂️bar👨‍👨‍👧‍👦";
 		ustring uexample(example);
@@ -509,7 +1637,7 @@ namespace Haunted::Tests {
 		i = 0;
 #ifdef ENABLE_ICU
 		for (size_t len: {1, 1, 1, 2, 1, 1, 1, 2, 2, 1, 1, 1, 2}) {
-			unit.check(uexample.width_at(i), len, "width_at(" + std::to_string(i) + ")");
+			unit.check(uexample.widthAt(i), len, "widthAt(" + std::to_string(i) + ")");
 			++i;
 		}
 #endif
@@ -528,6 +1656,279 @@ namespace Haunted::Tests {
 
 		ansi::out << ansi::endl;
 	}
+
+	void maintest::unittest_superstring(Testing &unit) {
+		INFO(wrap("Testing Haunted::Superstring.\n", ansi::style::bold));
+
+		Superstring sstr("foo🎉bar");
+		unit.check(sstr.size(), 7UL, "size()");
+		unit.check(sstr.textLength(), 10UL, "textLength()");
+		unit.check(sstr[3].str(), std::string("🎉"), "sstr[3]");
+		unit.check(sstr.substr(2, 3), std::string("o🎉b"), "substr(2, 3)");
+		unit.check("at(7)", typeid(std::out_of_range), "Superstring", &sstr, &Superstring::at, 7UL);
+
+		ansi::out << ansi::info << "Inserting " << "\""_d << "👨‍👨‍👧‍👦"_b << "\""_d << " at index 4." << ansi::endl;
+		sstr.insert(4, Superchar("👨‍👨‍👧‍👦"));
+		unit.check(sstr.str(), std::string("foo🎉👨‍👨‍👧‍👦bar"), "sstr");
+		unit.check(sstr[4].str(), std::string("👨‍👨‍👧‍👦"), "sstr[4]");
+		unit.check(sstr[5].str(), std::string("b"), "sstr[5]");
+
+		ansi::out << ansi::info << "Erasing 2 characters at index 3." << ansi::endl;
+		sstr.erase(3, 2);
+		unit.check(sstr.str(), std::string("foobar"), "sstr");
+		unit.check(sstr.size(), 6UL, "size()");
+
+		// Enough characters to span several index marks.
+		std::string long_str;
+		for (int i = 0; i < 200; ++i)
+			long_str += i % 3? "a" : "é";
+		Superstring long_sstr(long_str);
+		unit.check(long_sstr.size(), 200UL, "long size()");
+		unit.check(long_sstr[129].str(), std::string("é"), "long[129]");
+		unit.check(long_sstr[130].str(), std::string("a"), "long[130]");
+		long_sstr.erase(0, 1);
+		unit.check(long_sstr[128].str(), std::string("é"), "long[128] after erase(0, 1)");
+		unit.check(long_sstr.substr(197), std::string("éa"), "long.substr(197)");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_utf8(Testing &unit) {
+		INFO(wrap("Testing Haunted::UTF8 (" + std::string(UTF8::implementation()) + ").\n", ansi::style::bold));
+
+		unit.check(UTF8::isValid("foo🎉bar"), true, "isValid(\"foo🎉bar\")");
+		unit.check(UTF8::isValid("\xc0\xaf"), false, "isValid(overlong)");
+		unit.check(UTF8::isValid("\xed\xa0\x80"), false, "isValid(surrogate)");
+		unit.check(UTF8::isValid("\xf4\x90\x80\x80"), false, "isValid(too large)");
+		unit.check(UTF8::isValid("abc\xe2\x82"), false, "isValid(truncated)");
+		unit.check(UTF8::decode32("foo🎉bar").size(), 7UL, "decode32(\"foo🎉bar\").size()");
+		unit.check(UTF8::decode16("foo🎉bar").size(), 8UL, "decode16(\"foo🎉bar\").size()");
+
+		// Each maximal invalid subpart becomes one replacement character.
+		unit.check(UTF8::sanitize("a\xf0\x9f\x8e" "b"), std::string("a\ufffdb"), "sanitize(truncated)");
+		unit.check(UTF8::sanitize("\xc0\xaf"), std::string("\ufffd\ufffd"), "sanitize(overlong)");
+		unit.check(UTF8::sanitize("\xed\xa0\x80"), std::string("\ufffd\ufffd\ufffd"), "sanitize(surrogate)");
+
+		// Long enough to cover whole vector blocks, with a codepoint straddling the first block boundary.
+		std::string long_str(30, 'a');
+		for (int i = 0; i < 20; ++i)
+			long_str += "🎉é";
+		unit.check(UTF8::isValid(long_str), true, "isValid(long)");
+		unit.check(UTF8::asciiPrefix(long_str), 30UL, "asciiPrefix(long)");
+		unit.check(UTF8::decode32(long_str).size(), 70UL, "decode32(long).size()");
+		long_str[65] = 'x';
+		unit.check(UTF8::isValid(long_str), false, "isValid(long, corrupted)");
+
+		// The bulk validator has to agree with the scalar decoder on arbitrary input.
+		const unsigned char alphabet[] = {'a', 0x80, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xc3, 0xe0, 0xe2, 0xed, 0xf0, 0xf4,
+			0xff};
+		uint32_t seed = 1;
+		size_t disagreements = 0;
+		for (int i = 0; i < 2000; ++i) {
+			std::string random;
+			for (size_t length = seed % 80; random.size() < length;) {
+				seed = seed * 1103515245 + 12345;
+				random += alphabet[(seed >> 16) % sizeof(alphabet)];
+			}
+
+			const std::u32string decoded = UTF8::decode32(random);
+			if (UTF8::isValid(random) != (decoded.find(UTF8::replacement) == std::u32string::npos))
+				++disagreements;
+		}
+		unit.check(disagreements, 0UL, "validator/decoder disagreements");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_piecetable(Testing &unit) {
+		INFO(wrap("Testing Haunted::PieceTable.\n", ansi::style::bold));
+
+		PieceTable table("one\ntwo\nthree");
+		unit.check(table.lineCount(), 3UL, "lineCount()");
+		unit.check(table.line(1), std::string("two"), "line(1)");
+		unit.check(table.lineStart(2), 8UL, "lineStart(2)");
+		unit.check(table.lineOf(5), 1UL, "lineOf(5)");
+
+		ansi::out << ansi::info << "Inserting " << "\""_d << "\\nfour"_b << "\""_d << " at offset 3." << ansi::endl;
+		table.insert(3, "\nfour");
+		unit.check(table.str(), std::string("one\nfour\ntwo\nthree"), "str()");
+		unit.check(table.line(1), std::string("four"), "line(1)");
+		unit.check(table.lineEnd(1), 8UL, "lineEnd(1)");
+
+		ansi::out << ansi::info << "Erasing 6 bytes at offset 2." << ansi::endl;
+		table.erase(2, 6);
+		unit.check(table.str(), std::string("on\ntwo\nthree"), "str()");
+		unit.check(table.lineCount(), 3UL, "lineCount()");
+
+		// Compare against a plain string after a long series of random edits.
+		std::string model;
+		PieceTable random;
+		uint32_t seed = 3;
+		size_t mismatches = 0;
+		for (int i = 0; i < 3000; ++i) {
+			seed = seed * 1103515245 + 12345;
+			const size_t offset = model.empty()? 0 : (seed >> 8) % (model.size() + 1);
+			if (seed % 3 == 0 && !model.empty()) {
+				const size_t length = (seed >> 4) % 5;
+				model.erase(offset, length);
+				random.erase(offset, length);
+			} else {
+				const std::string piece = seed % 5 == 0? "\n" : std::string(1 + (seed >> 12) % 3, 'a' + i % 26);
+				model.insert(offset, piece);
+				random.insert(offset, piece);
+			}
+
+			const size_t line = std::count(model.begin(), model.begin() + offset, '\n');
+			const size_t line_start = offset == 0? 0 : model.rfind('\n', offset - 1) + 1;
+			if (random.lineOf(offset) != line || random.lineStart(line) != line_start)
+				++mismatches;
+		}
+		unit.check(random.str() == model, true, "random edits match");
+		unit.check(random.lineCount(), static_cast<size_t>(std::count(model.begin(), model.end(), '\n') + 1),
+			"random lineCount()");
+		unit.check(mismatches, 0UL, "random line index mismatches");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_completer(Testing &unit) {
+		INFO(wrap("Testing Haunted::UI::Completer.\n", ansi::style::bold));
+
+		auto completer = std::make_shared<UI::Completer>();
+		for (int i = 0; i < 100000; ++i)
+			completer->add("user" + std::to_string(i));
+		completer->add("Kai");
+		completer->add("kate");
+		completer->add("zed");
+		unit.check(completer->size(), 100003UL, "size()");
+		unit.check(completer->matches("us", 3) == std::vector<std::string> {"user0", "user1", "user10"}, true,
+			"matches(\"us\", 3)");
+		unit.check(completer->next("K").value_or(""), std::string("Kai"), "next(\"K\")");
+		unit.check(completer->next("k", "Kai").value_or(""), std::string("kate"), "next(\"k\", \"Kai\")");
+		unit.check(completer->next("k", "kate").value_or(""), std::string("Kai"), "next(\"k\", \"kate\")");
+		unit.check(completer->next("k", "Kai", true).value_or(""), std::string("kate"), "next(\"k\", \"Kai\", true)");
+		unit.check(completer->next("user9999", "user99999").value_or(""), std::string("user9999"),
+			"next(\"user9999\", \"user99999\")");
+		unit.check(completer->next("q").has_value(), false, "next(\"q\").has_value()");
+		unit.check(completer->remove("zed"), true, "remove(\"zed\")");
+		unit.check(completer->next("z").has_value(), false, "next(\"z\").has_value()");
+		unit.check(completer->contains("KATE") || !completer->contains("kate"), false, "contains()");
+
+		// The end of the range for "foo@" is "fooA", which mustn't be folded into "fooa".
+		for (const char *candidate: {"foo@x", "foo[1]", "foo_bar", "fooZ"})
+			completer->add(candidate);
+		unit.check(completer->matches("foo@") == std::vector<std::string> {"foo@x"}, true, "matches(\"foo@\")");
+		unit.check(completer->next("foo@", "foo@x").value_or(""), std::string("foo@x"), "next(\"foo@\", \"foo@x\")");
+
+		UI::Completer sensitive(true);
+		for (const char *candidate: {"Kai", "kate", "Kate"})
+			sensitive.add(candidate);
+		unit.check(sensitive.matches("K") == std::vector<std::string> {"Kai", "Kate"}, true,
+			"case-sensitive matches(\"K\")");
+
+		ansi::out << ansi::info << "Completing in a TextInput." << ansi::endl;
+		completer->startSuffix = ": ";
+		UI::TextInput input;
+		input.setCompleter(completer);
+		input.insert("ka");
+		input.onKey(Key(KeyType::Tab));
+		unit.check(input.getText(), std::string("Kai: "), "getText()");
+		input.onKey(Key(KeyType::Tab));
+		unit.check(input.getText(), std::string("kate: "), "getText()");
+		input.onKey(Key(KeyType::Tab, KeyMod::Shift));
+		unit.check(input.getText(), std::string("Kai: "), "getText()");
+		input.insert("hi zed");
+		input.onKey(Key(KeyType::Tab));
+		unit.check(input.getText(), std::string("Kai: hi zed"), "getText()");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_history(Testing &unit) {
+		INFO(wrap("Testing Haunted::UI::History.\n", ansi::style::bold));
+
+		UI::History history(4);
+		for (const char *line: {"make test", "git status", "make bench", "ls -la", "git status"})
+			history.add(line);
+		unit.check(history.size(), 4UL, "size()");
+		unit.check(history.at(history.newest()), std::string("git status"), "newest entry");
+		unit.check(history.at(history.older(history.newest())), std::string("ls -la"), "second newest entry");
+		unit.check(history.find("make").size(), 2UL, "find(\"make\").size()");
+		unit.check(history.find("zzz").empty(), true, "find(\"zzz\").empty()");
+		history.add(history.at(history.older(history.newest())));
+		unit.check(history.at(history.newest()), std::string("ls -la"), "entry re-added through at()");
+		unit.check(history.size(), 4UL, "size() after re-adding an entry");
+
+		ansi::out << ansi::info << "Searching for " << "\""_d << "git"_b << "\""_d << "." << ansi::endl;
+		UI::History::Search search(history);
+		search.push("g");
+		search.push("i");
+		unit.check(history.at(search.push("t")), std::string("git status"), "push(\"t\")");
+		unit.check(search.older(), 0UL, "older()");
+		unit.check(history.at(search.pop()), std::string("git status"), "pop()");
+
+		// Many entries sharing a common trigram, only a few of which contain the whole query.
+		UI::History big(200000);
+		for (int i = 0; i < 200000; ++i)
+			big.add("command " + std::to_string(i) + (i % 50000 == 0? " needle" : ""));
+		UI::History::Search big_search(big);
+		uint64_t match = 0;
+		for (const char ch: std::string("needle"))
+			match = big_search.push(std::string(1, ch));
+		unit.check(big.at(match), std::string("command 150000 needle"), "newest match");
+		unit.check(big.at(big_search.older()), std::string("command 100000 needle"), "older()");
+
+		ansi::out << ansi::info << "Browsing history in a TextInput." << ansi::endl;
+		auto shared = std::make_shared<UI::History>();
+		UI::TextInput input;
+		input.setHistory(shared);
+		input.insert("first");
+		input.onKey(Key(KeyType::Enter));
+		input.clear();
+		input.insert("second");
+		input.onKey(Key(KeyType::Enter));
+		input.clear();
+		input.insert("draft");
+		input.onKey(Key(KeyType::UpArrow));
+		input.onKey(Key(KeyType::UpArrow));
+		unit.check(input.getText(), std::string("first"), "getText() after up, up");
+		input.onKey(Key(KeyType::DownArrow));
+		input.onKey(Key(KeyType::DownArrow));
+		unit.check(input.getText(), std::string("draft"), "getText() after down, down");
+		input.onKey(Key(KeyType::r, KeyMod::Ctrl));
+		input.onKey(Key(KeyType::f));
+		unit.check(input.getText(), std::string("first"), "getText() after ^r f");
+		input.onKey(Key(KeyType::g, KeyMod::Ctrl));
+		unit.check(input.getText(), std::string("draft"), "getText() after ^g");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_textarea(Testing &unit) {
+		INFO(wrap("Testing Haunted::UI::TextArea.\n", ansi::style::bold));
+
+		UI::TextArea area(nullptr, Position(0, 0, 20, 5));
+		area.insert("héllo\nworld");
+		unit.check(area.lineCount(), 2UL, "lineCount()");
+		unit.check(area.getCursorLine(), 1UL, "getCursorLine()");
+		unit.check(area.getCursorColumn(), 5UL, "getCursorColumn()");
+
+		ansi::out << ansi::info << "Moving up and erasing the previous character." << ansi::endl;
+		area.up();
+		area.erase();
+		unit.check(area.getLine(0), std::string("héll"), "getLine(0)");
+		unit.check(area.getCursorColumn(), 4UL, "getCursorColumn()");
+
+		ansi::out << ansi::info << "Joining the lines." << ansi::endl;
+		area.eraseForward();
+		unit.check(area.str(), std::string("héllworld"), "str()");
+		area.newline();
+		unit.check(area.str(), std::string("héll\nworld"), "str()");
+		unit.check(area.getCursorLine(), 1UL, "getCursorLine()");
+		unit.check(area.getCursorColumn(), 0UL, "getCursorColumn()");
+
+		ansi::out << ansi::endl;
+	}
 }
 
 
@@ -589,14 +1990,74 @@ int main(int argc, char **argv) {
 		Haunted::Tests::maintest::unittest_textbox(unit);
 	} else if (arg == "unitexpandobox") {
 		Haunted::Tests::maintest::unittest_expandobox(unit);
+	} else if (arg == "unitflex") {
+		Haunted::Tests::maintest::unittest_flex(unit);
+	} else if (arg == "unithitindex") {
+		Haunted::Tests::maintest::unittest_hitindex(unit);
+	} else if (arg == "unitcolored") {
+		Haunted::Tests::maintest::unittest_colored(unit);
+	} else if (arg == "unitarena") {
+		Haunted::Tests::maintest::unittest_arena(unit);
+	} else if (arg == "unitswapbox") {
+		Haunted::Tests::maintest::unittest_swapbox(unit);
+	} else if (arg == "unitpaint") {
+		Haunted::Tests::maintest::unittest_paint(unit);
+	} else if (arg == "unitlistview") {
+		Haunted::Tests::maintest::unittest_listview(unit);
+	} else if (arg == "unittable") {
+		Haunted::Tests::maintest::unittest_table(unit);
+	} else if (arg == "unittreeview") {
+		Haunted::Tests::maintest::unittest_treeview(unit);
+	} else if (arg == "unitoverlay") {
+		Haunted::Tests::maintest::unittest_overlay(unit);
+	} else if (arg == "unittaskqueue") {
+		Haunted::Tests::maintest::unittest_taskqueue(unit);
+	} else if (arg == "unitthreadpool") {
+		Haunted::Tests::maintest::unittest_threadpool(unit);
+	} else if (arg == "unittimerwheel") {
+		Haunted::Tests::maintest::unittest_timerwheel(unit);
+	} else if (arg == "unitcoroutine") {
+		Haunted::Tests::maintest::unittest_coroutine(unit);
 	} else if (arg == "unitustring") {
 		Haunted::Tests::maintest::unittest_ustring(unit);
+	} else if (arg == "unitsuperstring") {
+		Haunted::Tests::maintest::unittest_superstring(unit);
+	} else if (arg == "unitutf8") {
+		Haunted::Tests::maintest::unittest_utf8(unit);
+	} else if (arg == "unitpiecetable") {
+		Haunted::Tests::maintest::unittest_piecetable(unit);
+	} else if (arg == "unittextarea") {
+		Haunted::Tests::maintest::unittest_textarea(unit);
+	} else if (arg == "unitcompleter") {
+		Haunted::Tests::maintest::unittest_completer(unit);
+	} else if (arg == "unithistory") {
+		Haunted::Tests::maintest::unittest_history(unit);
 	} else if (arg == "unit") {
 		ansi::out << ansi::endl;
 		Haunted::Tests::maintest::unittest_csiu(unit);
 		Haunted::Tests::maintest::unittest_textbox(unit);
 		Haunted::Tests::maintest::unittest_expandobox(unit);
+		Haunted::Tests::maintest::unittest_flex(unit);
+		Haunted::Tests::maintest::unittest_hitindex(unit);
+		Haunted::Tests::maintest::unittest_colored(unit);
+		Haunted::Tests::maintest::unittest_arena(unit);
+		Haunted::Tests::maintest::unittest_swapbox(unit);
+		Haunted::Tests::maintest::unittest_paint(unit);
+		Haunted::Tests::maintest::unittest_listview(unit);
+		Haunted::Tests::maintest::unittest_table(unit);
+		Haunted::Tests::maintest::unittest_treeview(unit);
+		Haunted::Tests::maintest::unittest_overlay(unit);
+		Haunted::Tests::maintest::unittest_taskqueue(unit);
+		Haunted::Tests::maintest::unittest_threadpool(unit);
+		Haunted::Tests::maintest::unittest_timerwheel(unit);
+		Haunted::Tests::maintest::unittest_coroutine(unit);
 		Haunted::Tests::maintest::unittest_ustring(unit);
+		Haunted::Tests::maintest::unittest_superstring(unit);
+		Haunted::Tests::maintest::unittest_utf8(unit);
+		Haunted::Tests::maintest::unittest_piecetable(unit);
+		Haunted::Tests::maintest::unittest_textarea(unit);
+		Haunted::Tests::maintest::unittest_completer(unit);
+		Haunted::Tests::maintest::unittest_history(unit);
 	} else {
 		Haunted::Tests::maintest::unittest_textbox(unit);
 	}
@@ -68,3 +68,63 @@ kmtest: build/test
 
 ustest: build/test
 	./$^ unitustring
+
+sstest: build/test
+	./$^ unitsuperstring
+
+u8test: build/test
+	./$^ unitutf8
+
+pttest: build/test
+	./$^ unitpiecetable
+
+tatest: build/test
+	./$^ unittextarea
+
+cptest: build/test
+	./$^ unitcompleter
+
+hitest: build/test
+	./$^ unithistory
+
+fxtest: build/test
+	./$^ unitflex
+
+hxtest: build/test
+	./$^ unithitindex
+
+cltest: build/test
+	./$^ unitcolored
+
+artest: build/test
+	./$^ unitarena
+
+swtest: build/test
+	./$^ unitswapbox
+
+pctest: build/test
+	./$^ unitpaint
+
+lvtest: build/test
+	./$^ unitlistview
+
+tbtest: build/test
+	./$^ unittable
+
+trtest: build/test
+	./$^ unittreeview
+
+ovtest: build/test
+	./$^ unitoverlay
+
+tqtest: build/test
+	./$^ unittaskqueue
+
+tptest: build/test
+	./$^ unitthreadpool
+
+twtest: build/test
+	./$^ unittimerwheel
+
+cotest: build/test
+	./$^ unitcoroutine
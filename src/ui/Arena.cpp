@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "haunted/ui/Arena.h"
+#include "haunted/ui/Container.h"
+
+namespace Haunted::UI {
+
+
+// Private instance methods
+
+
+	void * Arena::allocate(size_t size, size_t alignment) {
+		const auto align = [alignment](std::byte *pointer) {
+			const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+			return reinterpret_cast<std::byte *>((address + alignment - 1) & ~(alignment - 1));
+		};
+
+		std::byte *start = cursor? align(cursor) : nullptr;
+		if (!start || end < start + size) {
+			const size_t capacity = std::max(blockSize, size + alignment);
+			blockSize *= 2;
+			blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[capacity]), capacity});
+			cursor = blocks.back().data.get();
+			end = cursor + capacity;
+			start = align(cursor);
+		}
+
+		cursor = start + size;
+		return start;
+	}
+
+
+// Public instance methods
+
+
+	void Arena::clear() {
+		// Detach every control from its parent first, while they're all still alive. Afterwards no container can reach
+		// an arena-owned control, so the order of destruction doesn't matter. Containers in the arena are simply
+		// emptied of their arena-owned children; only containers outside the arena need removeChild().
+		for (const Object &object: objects) {
+			if (!object.control)
+				continue;
+
+			if (Container *container = object.control->asContainer()) {
+				auto &children = container->children;
+				children.erase(std::remove_if(children.begin(), children.end(), [](Control *child) {
+					return child->isArenaOwned();
+				}), children.end());
+			}
+
+			if (Container *parent = object.control->getParent()) {
+				Control *parent_control = parent->asControl();
+				if (!parent_control || !parent_control->isArenaOwned())
+					parent->removeChild(object.control);
+			}
+		}
+
+		for (auto iter = objects.rbegin(); iter != objects.rend(); ++iter)
+			iter->destroy(iter->pointer);
+
+		objects.clear();
+		if (blocks.empty())
+			return;
+
+		// The last block is usually the largest, but not after an allocation too big for the block size.
+		if (1 < blocks.size()) {
+			auto largest = std::max_element(blocks.begin(), blocks.end(), [](const Block &left, const Block &right) {
+				return left.capacity < right.capacity;
+			});
+			Block kept = std::move(*largest);
+			blocks.clear();
+			blocks.push_back(std::move(kept));
+		}
+
+		// Growth starts over from the kept block, so that repeatedly filling and clearing the arena doesn't make every
+		// new block larger than the last.
+		blockSize = std::max(initialBlockSize, blocks.front().capacity);
+		cursor = blocks.front().data.get();
+		end = cursor + blocks.front().capacity;
+	}
+}
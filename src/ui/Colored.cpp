@@ -1,4 +1,4 @@
-#include <deque>
+#include <vector>
 
 #include "haunted/core/Terminal.h"
 #include "haunted/ui/Colored.h"
@@ -7,8 +7,6 @@ namespace Haunted::UI {
 	Colored::~Colored() = default;
 
 	ansi::color Colored::findColor(ansi::color_type type) const {
-		Container *p = getParent();
-
 		// If the control doesn't need to inherit a color, that would save us the effort of checking its ancestors.
 		if (type == ansi::color_type::background && !inheritBackground)
 			return background;
@@ -16,12 +14,24 @@ namespace Haunted::UI {
 		if (type == ansi::color_type::foreground && !inheritForeground)
 			return foreground;
 
+		if (!resolved) {
+			resolvedForeground = inheritForeground? resolveColor(ansi::color_type::foreground) : foreground;
+			resolvedBackground = inheritBackground? resolveColor(ansi::color_type::background) : background;
+			resolved = true;
+		}
+
+		return type == ansi::color_type::background? resolvedBackground : resolvedForeground;
+	}
+
+	ansi::color Colored::resolveColor(ansi::color_type type) const {
+		Container *p = const_cast<Colored *>(this)->getParent();
+
 		while (p != nullptr) {
-			if (Colored *pcolored = dynamic_cast<Colored *>(p)) {
+			if (Colored *pcolored = p->asColored()) {
 				// If we find a control that's also an instance of colored, let it determine the color for us.
 				ansi::color found = pcolored->findColor(type);
 				return found;
-			} else if (Control *pcontrol = dynamic_cast<Control *>(p)) {
+			} else if (Control *pcontrol = p->asControl()) {
 				if (pcontrol->getTerminal() == pcontrol->getParent()) {
 					// If we've reached the terminal and still haven't found any control with a color preference,
 					// give up.
@@ -45,6 +55,27 @@ namespace Haunted::UI {
 		return ansi::color::normal;
 	}
 
+	void Colored::invalidateTree(Control *control) {
+		std::vector<Control *> stack {control};
+		while (!stack.empty()) {
+			Control *current = stack.back();
+			stack.pop_back();
+			if (Colored *colored = current->asColored())
+				colored->resolved = false;
+			if (Container *container = current->asContainer())
+				stack.insert(stack.end(), container->getChildren().begin(), container->getChildren().end());
+		}
+	}
+
+	Container * Colored::containerSelf() const {
+		if (!containerKnown) {
+			container = dynamic_cast<Container *>(const_cast<Colored *>(this));
+			containerKnown = true;
+		}
+
+		return container;
+	}
+
 	void Colored::draw() {
 		applyColors();
 	}
@@ -83,56 +114,66 @@ namespace Haunted::UI {
 
 	bool Colored::propagate(ansi::color_type type) {
 		// If this isn't a container, there's nothing to propagate to.
-		Container *cont = dynamic_cast<Container *>(this);
+		Container *cont = containerSelf();
 		if (cont == nullptr)
 			return false;
 
 		bool is_bg = (static_cast<int>(type) & static_cast<int>(ansi::color_type::background)) != 0;
 		bool is_fg = (static_cast<int>(type) & static_cast<int>(ansi::color_type::foreground)) != 0;
 
-		std::deque<Control *> queue(cont->getChildren().begin(), cont->getChildren().end());
-
-		while (!queue.empty()) {
-			Control *child = queue.front();
-			queue.pop_front();
-
-			Colored *colored_child = dynamic_cast<Colored *>(child);
-			if (colored_child == nullptr) {
-				if (Container *container_child = dynamic_cast<Container *>(child)) {
-					queue.insert(queue.end(), container_child->getChildren().begin(),
-					                          container_child->getChildren().end());
-				}
-
-				continue;
+		// Descend only through children that inherit the changed colors and whose resolved colors actually changed.
+		// Containers have no cells of their own, so only the leaves among them need to be redrawn.
+		std::vector<Control *> stack(cont->getChildren().rbegin(), cont->getChildren().rend());
+		std::vector<Control *> changed_leaves;
+
+		while (!stack.empty()) {
+			Control *child = stack.back();
+			stack.pop_back();
+
+			Colored *colored_child = child->asColored();
+			if (colored_child != nullptr) {
+				const bool inherits_bg = is_bg && colored_child->inheritBackground;
+				const bool inherits_fg = is_fg && colored_child->inheritForeground;
+				if (!inherits_bg && !inherits_fg)
+					continue;
+
+				const bool was_resolved = colored_child->resolved;
+				const ansi::color old_fg = colored_child->resolvedForeground, old_bg = colored_child->resolvedBackground;
+
+				if (inherits_bg)
+					colored_child->background = background;
+				if (inherits_fg)
+					colored_child->foreground = foreground;
+
+				colored_child->resolved = false;
+				const bool changed = !was_resolved
+					|| colored_child->findColor(ansi::color_type::foreground) != old_fg
+					|| colored_child->findColor(ansi::color_type::background) != old_bg;
+				if (!changed)
+					continue;
 			}
 
-			bool changed = false;
-
-			if (is_bg && colored_child->inheritBackground && colored_child->getBackground() != background) {
-				colored_child->background = background;
-				changed = true;
-			}
-			
-			if (is_fg && colored_child->inheritForeground && colored_child->getForeground() != foreground) {
-				colored_child->foreground = foreground;
-				changed = true;
-			}
+			if (Container *container_child = child->asContainer())
+				stack.insert(stack.end(), container_child->getChildren().rbegin(), container_child->getChildren().rend());
+			else if (colored_child != nullptr)
+				changed_leaves.push_back(child);
+		}
 
-			if (changed) {
-				if (Container *container_child = dynamic_cast<Container *>(child)) {
-					queue.insert(queue.end(), container_child->getChildren().begin(),
-					                          container_child->getChildren().end());
-				}
-			}
+		if (!changed_leaves.empty()) {
+			std::unique_lock<std::recursive_mutex> lock;
+			if (Terminal *term = getTerminal())
+				lock = term->lockRender();
+			for (Control *leaf: changed_leaves)
+				leaf->draw();
 		}
 
-		draw();
 		return true;
 	}
 
 	bool Colored::setForeground(ansi::color foreground_) {
 		if (foreground != foreground_) {
 			foreground = foreground_;
+			resolved = false;
 			propagate(ansi::color_type::foreground);
 			return true;
 		}
@@ -143,6 +184,7 @@ namespace Haunted::UI {
 	bool Colored::setBackground(ansi::color background_) {
 		if (background != background_) {
 			background = background_;
+			resolved = false;
 			propagate(ansi::color_type::background);
 			return true;
 		}
@@ -155,7 +197,9 @@ namespace Haunted::UI {
 		bool bg_changed = setBackground(background_);
 
 		if (fg_changed || bg_changed) {
-			draw();
+			// A container's descendants have already been redrawn by propagate() as needed.
+			if (containerSelf() == nullptr)
+				draw();
 			return true;
 		}
 
@@ -172,15 +216,22 @@ namespace Haunted::UI {
 		bool changed = false;
 
 		if (inheritForeground != inherit_fg) {
+			const ansi::color old = findColor(ansi::color_type::foreground);
 			inheritForeground = inherit_fg;
+			resolved = false;
 			changed = true;
-			setForeground(findColor(ansi::color_type::foreground));
+			// Toggling inheritance can change the effective color without changing the stored one.
+			if (!setForeground(findColor(ansi::color_type::foreground)) && findColor(ansi::color_type::foreground) != old)
+				propagate(ansi::color_type::foreground);
 		}
 
 		if (inheritBackground != inherit_bg) {
+			const ansi::color old = findColor(ansi::color_type::background);
 			inheritBackground = inherit_bg;
+			resolved = false;
 			changed = true;
-			setBackground(findColor(ansi::color_type::background));
+			if (!setBackground(findColor(ansi::color_type::background)) && findColor(ansi::color_type::background) != old)
+				propagate(ansi::color_type::background);
 		}
 		
 		return changed;
@@ -191,5 +242,6 @@ namespace Haunted::UI {
 		std::swap(left.foreground, right.foreground);
 		std::swap(left.inheritForeground, right.inheritForeground);
 		std::swap(left.inheritBackground, right.inheritBackground);
+		left.resolved = right.resolved = false;
 	}
 }
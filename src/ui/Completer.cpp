@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#include "haunted/ui/Completer.h"
+
+namespace Haunted::UI {
+
+
+// Private instance methods
+
+
+	int Completer::Order::compare(std::string_view left, std::string_view right, bool right_folded) const {
+		if (caseSensitive)
+			return left.compare(right);
+
+		const size_t length = std::min(left.size(), right.size());
+		for (size_t i = 0; i < length; ++i) {
+			unsigned char left_ch = left[i], right_ch = right[i];
+			if ('A' <= left_ch && left_ch <= 'Z')
+				left_ch += 'a' - 'A';
+			if (!right_folded && 'A' <= right_ch && right_ch <= 'Z')
+				right_ch += 'a' - 'A';
+			if (left_ch != right_ch)
+				return left_ch < right_ch? -1 : 1;
+		}
+
+		return left.size() < right.size()? -1 : left.size() != right.size();
+	}
+
+	std::pair<Completer::Iterator, Completer::Iterator> Completer::range(const std::string &folded_prefix) const {
+		const Iterator first = entries.lower_bound(Prefix {folded_prefix});
+
+		// The matches end at the first string greater than every string with the prefix: the prefix with its last
+		// byte incremented (after dropping any trailing 0xff bytes, which can't be incremented).
+		std::string after = folded_prefix;
+		while (!after.empty() && static_cast<unsigned char>(after.back()) == 0xff)
+			after.pop_back();
+
+		if (after.empty())
+			return {first, entries.end()};
+
+		++after.back();
+		return {first, entries.lower_bound(Prefix {after})};
+	}
+
+
+// Public instance methods
+
+
+	std::string Completer::fold(const std::string &str) const {
+		if (caseSensitive)
+			return str;
+
+		std::string folded = str;
+		for (char &ch: folded)
+			if ('A' <= ch && ch <= 'Z')
+				ch += 'a' - 'A';
+		return folded;
+	}
+
+	bool Completer::add(const std::string &candidate) {
+		return entries.insert(candidate).second;
+	}
+
+	bool Completer::remove(const std::string &candidate) {
+		return entries.erase(candidate) != 0;
+	}
+
+	bool Completer::contains(const std::string &candidate) const {
+		return entries.count(candidate) != 0;
+	}
+
+	std::vector<std::string> Completer::matches(const std::string &prefix, size_t limit) const {
+		std::vector<std::string> out;
+		auto [iter, end] = range(fold(prefix));
+		for (; iter != end && out.size() < limit; ++iter)
+			out.push_back(*iter);
+		return out;
+	}
+
+	std::optional<std::string> Completer::next(const std::string &prefix, const std::string &current,
+	                                           bool reverse) const {
+		const auto [first, end] = range(fold(prefix));
+		if (first == end)
+			return std::nullopt;
+
+		if (current.empty())
+			return reverse? *std::prev(end) : *first;
+
+		// Wrap around when the current candidate is at (or somehow outside) either end of the matches.
+		const Order less = entries.key_comp();
+		const Iterator last = std::prev(end);
+
+		if (reverse)
+			return less(*first, current) && !less(*last, current)? *std::prev(entries.lower_bound(current)) : *last;
+
+		return !less(current, *first) && less(current, *last)? *entries.upper_bound(current) : *first;
+	}
+}
@@ -6,7 +6,8 @@
 namespace Haunted::UI {
 	Container::~Container() {
 		for (Control *child: children)
-			delete child;
+			if (!child->isArenaOwned())
+				delete child;
 	}
 
 	Control * Container::operator[](size_t index) {
@@ -15,6 +16,8 @@ namespace Haunted::UI {
 
 	bool Container::addChild(Control *child) {
 		children.push_back(child);
+		if (Terminal *terminal = getTerminal())
+			terminal->hitIndex.invalidate();
 		return true;
 	}
 
@@ -23,6 +26,8 @@ namespace Haunted::UI {
 			if (*iter == to_remove) {
 				children.erase(iter);
 				to_remove->setParent(nullptr);
+				if (Terminal *terminal = getTerminal())
+					terminal->hitIndex.invalidate();
 				return true;
 			}
 
@@ -2,19 +2,24 @@
 
 #include "haunted/core/Terminal.h"
 #include "haunted/core/Util.h"
+#include "haunted/ui/Colored.h"
 #include "haunted/ui/Control.h"
+#include "haunted/ui/PaintContext.h"
 
 #include "lib/formicine/ansi.h"
 
 namespace Haunted::UI {
 	Control::Control(Container *parent_, const Haunted::Position &position_):
 	Child(parent_), terminal(nullptr), position(position_) {
+		selfControl = this;
 		if (parent_)
 			terminal = parent_->getTerminal();
 	}
 
 	Control::Control(Container *parent_, Terminal *terminal_):
-		Child(parent_), terminal(terminal_) {}
+	Child(parent_), terminal(terminal_) {
+		selfControl = this;
+	}
 
 	Control::Control(Container *parent_):
 		Control(parent_, parent_ == nullptr? nullptr : parent_->getTerminal()) {}
@@ -45,6 +50,8 @@ namespace Haunted::UI {
 
 	void Control::resize(const Haunted::Position &new_pos) {
 		// It's up to the caller of resize() to also call draw().
+		if (terminal)
+			terminal->hitIndex.update(this, position, new_pos);
 		position = new_pos;
 	}
 
@@ -75,7 +82,8 @@ namespace Haunted::UI {
 	}
 
 	bool Control::canDraw() const {
-		return parent != nullptr && terminal != nullptr && 0 <= position.left && 0 <= position.top && !suppressDraw;
+		return parent != nullptr && terminal != nullptr && 0 <= position.left && 0 <= position.top && !suppressDraw
+			&& !terminal->isOccluded(this);
 	}
 
 	void Control::resize() {
@@ -83,6 +91,8 @@ namespace Haunted::UI {
 	}
 
 	void Control::move(int left, int top) {
+		if (terminal)
+			terminal->hitIndex.update(this, position, {left, top, position.width, position.height});
 		position.left = left;
 		position.top = top;
 	}
@@ -94,14 +104,30 @@ namespace Haunted::UI {
 
 	void Control::setParent(Container *parent_) {
 		Child::setParent(parent_);
+		Colored::invalidateTree(this);
+		if (terminal)
+			terminal->hitIndex.invalidate();
 		if (parent_ != nullptr) {
 			if (Terminal *parent_term = parent_->getTerminal())
 				setTerminal(parent_term);
 		}
 	}
 
+	void Control::setTerminal(Terminal *terminal_) {
+		if (terminal != terminal_) {
+			if (terminal)
+				terminal->hitIndex.invalidate();
+			if (terminal_)
+				terminal_->hitIndex.invalidate();
+			terminal = terminal_;
+		}
+	}
+
 	void Control::jump() {
-		position.jump();
+		if (terminal)
+			terminal->jump(position.left, position.top);
+		else
+			position.jump();
 	}
 
 	void Control::jumpFocus() {
@@ -109,39 +135,8 @@ namespace Haunted::UI {
 	}
 
 	void Control::clearRect() {
-		if (!terminal)
-			return;
-
-		tryMargins([&, this]() {
-			if (atLeft() && atRight()) {
-				// Galaxy brain trickery here. If this control is as wide as the entire terminal, we can vscroll the
-				// contents into oblivion very efficiently.
-				terminal->vscroll(position.height);
-			} else if (atLeft()) {
-				// If we're at the left, we can clear each line from the end of the line to the left edge of the screen.
-				terminal->jump(position.width - 1, 0);
-				for (int i = 0; i < position.height; ++i) {
-					if (i)
-						terminal->down();
-					terminal->clearLeft();
-				}
-			} else if (atRight()) {
-				// If we're at the right, we can clear each line from the start of the line to the right edge.
-				terminal->jump(position.left, 0);
-				for (int i = 0; i < position.height; ++i) {
-					if (i)
-						terminal->down();
-					terminal->clearRight();
-				}
-			} else {
-				// If we're at neither edge, we have to print a total of width*height spaces. Very sad.
-				std::string spaces(static_cast<size_t>(position.width), ' ');
-				for (int i = 0; i < position.height; ++i) {
-					terminal->jump(position.left, i);
-					*terminal << spaces;
-				}
-			}
-		});
+		if (terminal)
+			PaintContext(*terminal, position, this).clear();
 	}
 
 	void Control::flush() {
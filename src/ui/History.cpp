@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "haunted/core/ThreadPool.h"
+#include "haunted/ui/History.h"
+
+namespace Haunted::UI {
+	namespace {
+		std::string escape(const std::string &str) {
+			std::string out;
+			out.reserve(str.size());
+			for (const char ch: str) {
+				if (ch == '\\')
+					out += "\\\\";
+				else if (ch == '\n')
+					out += "\\n";
+				else if (ch == '\r')
+					out += "\\r";
+				else
+					out += ch;
+			}
+
+			return out;
+		}
+
+		std::string unescape(const std::string &str) {
+			std::string out;
+			out.reserve(str.size());
+			for (size_t i = 0; i < str.size(); ++i) {
+				if (str[i] != '\\' || i + 1 == str.size()) {
+					out += str[i];
+					continue;
+				}
+
+				const char next = str[++i];
+				out += next == 'n'? '\n' : next == 'r'? '\r' : next;
+			}
+
+			return out;
+		}
+	}
+
+
+// Private static methods
+
+
+	std::vector<uint32_t> History::trigrams(std::string_view str) {
+		std::vector<uint32_t> out;
+		if (str.size() < 3)
+			return out;
+
+		out.reserve(str.size() - 2);
+		for (size_t i = 0; i + 3 <= str.size(); ++i) {
+			out.push_back(static_cast<uint32_t>(static_cast<unsigned char>(str[i])) << 16
+			            | static_cast<uint32_t>(static_cast<unsigned char>(str[i + 1])) << 8
+			            | static_cast<unsigned char>(str[i + 2]));
+		}
+
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+		return out;
+	}
+
+
+// Private instance methods
+
+
+	void History::index(uint64_t id, std::string_view text) {
+		for (const uint32_t trigram: trigrams(text)) {
+			postings[trigram].push_back(id);
+			++postingCount;
+		}
+	}
+
+	void History::remove(std::map<uint64_t, std::string>::iterator iter) {
+		stalePostings += trigrams(iter->second).size();
+		ids.erase(iter->second);
+		entries.erase(iter);
+
+		if (1024 < stalePostings && postingCount < 2 * stalePostings)
+			compact();
+	}
+
+	void History::compact() {
+		postings.clear();
+		postingCount = stalePostings = 0;
+		for (const auto &[id, text]: entries)
+			index(id, text);
+	}
+
+
+// Public instance methods
+
+
+	void History::add(std::string text) {
+		if (text.empty())
+			return;
+
+		if (auto iter = ids.find(text); iter != ids.end())
+			remove(entries.find(iter->second));
+
+		const uint64_t id = nextID++;
+		const std::string &stored = entries.emplace_hint(entries.end(), id, std::move(text))->second;
+		ids.emplace(stored, id);
+		index(id, stored);
+
+		while (capacity < entries.size())
+			remove(entries.begin());
+	}
+
+	void History::clear() {
+		entries.clear();
+		ids.clear();
+		postings.clear();
+		postingCount = stalePostings = 0;
+	}
+
+	void History::setCapacity(size_t capacity_) {
+		capacity = capacity_;
+		while (capacity < entries.size())
+			remove(entries.begin());
+	}
+
+	const std::string & History::at(uint64_t id) const {
+		auto iter = entries.find(id);
+		if (iter == entries.end())
+			throw std::out_of_range("Invalid history ID: " + std::to_string(id));
+		return iter->second;
+	}
+
+	uint64_t History::newest() const {
+		return entries.empty()? 0 : entries.rbegin()->first;
+	}
+
+	uint64_t History::older(uint64_t id) const {
+		auto iter = entries.lower_bound(id);
+		return iter == entries.begin()? 0 : std::prev(iter)->first;
+	}
+
+	uint64_t History::newer(uint64_t id) const {
+		auto iter = entries.upper_bound(id);
+		return iter == entries.end()? 0 : iter->first;
+	}
+
+	std::vector<uint64_t> History::find(std::string_view query) const {
+		std::vector<uint64_t> out;
+
+		if (query.size() < 3) {
+			for (const auto &[id, text]: entries)
+				if (text.find(query) != std::string::npos)
+					out.push_back(id);
+			return out;
+		}
+
+		// Every match contains all of the query's trigrams, so checking the entries with the rarest one is enough.
+		const std::vector<uint64_t> *rarest = nullptr;
+		for (const uint32_t trigram: trigrams(query)) {
+			auto iter = postings.find(trigram);
+			if (iter == postings.end())
+				return out;
+			if (!rarest || iter->second.size() < rarest->size())
+				rarest = &iter->second;
+		}
+
+		for (const uint64_t id: *rarest) {
+			auto iter = entries.find(id);
+			if (iter != entries.end() && iter->second.find(query) != std::string::npos)
+				out.push_back(id);
+		}
+
+		return out;
+	}
+
+	uint64_t History::findBefore(std::string_view query, uint64_t before) const {
+		auto iter = before == 0? entries.end() : entries.lower_bound(before);
+		while (iter != entries.begin()) {
+			--iter;
+			if (iter->second.find(query) != std::string::npos)
+				return iter->first;
+		}
+
+		return 0;
+	}
+
+	bool History::load(const std::string &path) {
+		std::ifstream in(path);
+		if (!in)
+			return false;
+
+		clear();
+		std::string line;
+		while (std::getline(in, line))
+			add(unescape(line));
+		return true;
+	}
+
+	Future<std::shared_ptr<History>> History::loadInBackground(const std::string &path, size_t capacity,
+	ThreadPool &pool) {
+		return pool.submit([path, capacity] {
+			auto history = std::make_shared<History>(capacity);
+			return history->load(path)? history : nullptr;
+		});
+	}
+
+	Future<std::shared_ptr<History>> History::loadInBackground(const std::string &path, size_t capacity) {
+		return loadInBackground(path, capacity, ThreadPool::shared());
+	}
+
+	void History::save(const std::string &path) const {
+		std::ofstream out(path);
+		for (const auto &[id, text]: entries)
+			out << escape(text) << '\n';
+
+		if (!out)
+			throw std::runtime_error("Couldn't write history to " + path);
+	}
+
+
+// Search
+
+
+	uint64_t History::Search::matchAtOrBefore(uint64_t limit) const {
+		const Level &top = levels.back();
+		if (top.query.empty())
+			return 0;
+
+		if (!top.indexed)
+			return history.findBefore(top.query, limit == 0? 0 : limit + 1);
+
+		auto iter = limit == 0? top.candidates.end() :
+			std::upper_bound(top.candidates.begin(), top.candidates.end(), limit);
+		while (iter != top.candidates.begin()) {
+			--iter;
+			if (history.contains(*iter))
+				return *iter;
+		}
+
+		return 0;
+	}
+
+	uint64_t History::Search::push(std::string_view text) {
+		const Level &previous = levels.back();
+		const uint64_t previous_match = previous.match;
+
+		Level next;
+		next.query = previous.query + std::string(text);
+		if (3 <= next.query.size()) {
+			next.indexed = true;
+			if (previous.indexed) {
+				for (const uint64_t id: previous.candidates)
+					if (history.contains(id) && history.at(id).find(next.query) != std::string::npos)
+						next.candidates.push_back(id);
+			} else {
+				next.candidates = history.find(next.query);
+			}
+		}
+
+		levels.push_back(std::move(next));
+		Level &top = levels.back();
+		top.match = previous_match == 0? 0 : matchAtOrBefore(previous_match);
+		if (top.match == 0)
+			top.match = matchAtOrBefore(0);
+		return top.match;
+	}
+
+	uint64_t History::Search::pop() {
+		if (1 < levels.size())
+			levels.pop_back();
+		return getMatch();
+	}
+
+	uint64_t History::Search::older() {
+		Level &top = levels.back();
+		if (top.match <= 1)
+			return 0;
+
+		const uint64_t id = matchAtOrBefore(top.match - 1);
+		if (id != 0)
+			top.match = id;
+		return id;
+	}
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+
+#include "haunted/ui/Container.h"
+#include "haunted/ui/Control.h"
+#include "haunted/ui/HitIndex.h"
+
+namespace Haunted::UI {
+
+
+// Private instance methods
+
+
+	void HitIndex::add(Control *control) {
+		if (Container *container = control->asContainer()) {
+			Terminal *terminal = control->getTerminal();
+			for (Control *child: container->getChildren())
+				if (child && child->getTerminal() && child->getTerminal() == terminal)
+					add(child);
+			return;
+		}
+
+		Position pos = control->getPosition();
+		if (!clip(pos))
+			return;
+
+		for (int y = pos.top; y <= pos.bottom(); ++y) {
+			auto row = cells.begin() + y * width;
+			for (int x = pos.left; x <= pos.right(); ++x)
+				if (!row[x])
+					row[x] = control;
+		}
+	}
+
+	bool HitIndex::clip(Position &pos) const {
+		const int right  = std::min(pos.right(),  width  - 1);
+		const int bottom = std::min(pos.bottom(), height - 1);
+		pos.left = std::max(pos.left, 0);
+		pos.top  = std::max(pos.top,  0);
+		pos.width  = right  - pos.left + 1;
+		pos.height = bottom - pos.top  + 1;
+		return 0 < pos.width && 0 < pos.height;
+	}
+
+
+// Public instance methods
+
+
+	void HitIndex::resize(int width_, int height_) {
+		width  = std::max(width_,  0);
+		height = std::max(height_, 0);
+		cells.assign(static_cast<size_t>(width) * height, nullptr);
+		stale = true;
+	}
+
+	void HitIndex::update(Control *control, const Position &old_position, const Position &new_position) {
+		if (stale || old_position == new_position || control->asContainer())
+			return;
+
+		if (layered) {
+			stale = true;
+			return;
+		}
+
+		bool found = false;
+		Position pos = old_position;
+		if (clip(pos)) {
+			for (int y = pos.top; y <= pos.bottom(); ++y) {
+				auto row = cells.begin() + y * width;
+				for (int x = pos.left; x <= pos.right(); ++x) {
+					if (row[x] == control) {
+						row[x] = nullptr;
+						found = true;
+					}
+				}
+			}
+		}
+
+		// A control that had no cells may not be part of the tree at all, so let the next rebuild decide.
+		if (!found) {
+			stale = true;
+			return;
+		}
+
+		pos = new_position;
+		if (clip(pos)) {
+			for (int y = pos.top; y <= pos.bottom(); ++y)
+				std::fill_n(cells.begin() + y * width + pos.left, pos.width, control);
+		}
+	}
+
+	void HitIndex::rebuild(Control *root) {
+		std::fill(cells.begin(), cells.end(), nullptr);
+		stale = layered = false;
+		if (root)
+			add(root);
+	}
+
+	void HitIndex::rebuild(const std::vector<Control *> &layers) {
+		std::fill(cells.begin(), cells.end(), nullptr);
+		stale = false;
+		layered = 1 < layers.size();
+		for (Control *layer: layers)
+			if (layer)
+				add(layer);
+	}
+
+	Control * HitIndex::at(int x, int y) const {
+		if (x < 0 || y < 0 || width <= x || height <= y)
+			return nullptr;
+		return cells[y * width + x];
+	}
+}
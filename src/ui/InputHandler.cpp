@@ -1,7 +1,15 @@
+#include "haunted/ui/Colored.h"
 #include "haunted/ui/InputHandler.h"
 #include "haunted/ui/Control.h"
 
 namespace Haunted::UI {
+	Colored * InputHandler::asColored() const {
+		// A null result isn't cached, since that's also the answer while a subclass of Colored is being constructed.
+		if (!colored)
+			colored = dynamic_cast<Colored *>(const_cast<InputHandler *>(this));
+		return colored;
+	}
+
 	bool InputHandler::onKey(const Key &k) {
 		return keyFunction? keyFunction(k) : false;
 	}
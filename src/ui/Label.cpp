@@ -20,7 +20,14 @@ namespace Haunted::UI {
 	void Label::setText(const std::string &text_) {
 		if (text != text_) {
 			text = text_;
-			draw();
+
+			// If the parent grants a new size, it redraws the label if that changed its position.
+			const Position old_position = position;
+			if (autoresize && parent && static_cast<size_t>(position.width) != length())
+				parent->requestResize(this, length(), position.height);
+
+			if (position == old_position)
+				draw();
 		}
 	}
 
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "haunted/core/Terminal.h"
+#include "haunted/ui/ListView.h"
+#include "haunted/ui/PaintContext.h"
+
+#include "lib/formicine/ansi.h"
+
+namespace Haunted::UI {
+	ListView::ListView(Container *parent_, const Position &pos_, size_t count_, const Accessor_f &accessor_):
+	Control(parent_, pos_), count(count_), accessor(accessor_) {
+		if (parent_)
+			parent_->addChild(this);
+	}
+
+
+// Private instance methods
+
+
+	size_t ListView::rows() const {
+		return std::max(position.height, 0);
+	}
+
+	size_t ListView::maxTop() const {
+		return rows() < count? count - rows() : 0;
+	}
+
+	std::string ListView::rowText(size_t index) const {
+		const size_t width = std::max(position.width, 0);
+		if (count <= index || !accessor)
+			return std::string(width, ' ');
+
+		std::string text = accessor(index);
+		const size_t length = ansi::length(text);
+		if (length < width)
+			text.append(width - length, ' ');
+		else if (width < length)
+			text = ansi::substr(text, 0, width);
+
+		// The selected item is shown in reverse video so that it stands out whatever the colors are.
+		return index == selected? "\e[7m" + text + "\e[27m" : text;
+	}
+
+	void ListView::drawRows(size_t first, size_t last) {
+		if (!canDraw() || position.width <= 0 || position.height <= 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		last = std::min(last, rows() - 1);
+
+		PaintContext paint(*terminal, position, this);
+		applyColors();
+		for (size_t row = first; row <= last; ++row)
+			paint.write(0, row, rowText(top + row));
+
+		terminal->resetColors();
+		terminal->jumpToFocused();
+		flush();
+	}
+
+	void ListView::drawItem(size_t index) {
+		if (index != NONE && top <= index && index - top < rows())
+			drawRows(index - top, index - top);
+	}
+
+
+// Public instance methods
+
+
+	void ListView::setItems(size_t count_, const Accessor_f &accessor_) {
+		count = count_;
+		accessor = accessor_;
+		top = 0;
+		selected = NONE;
+		draw();
+	}
+
+	void ListView::setCount(size_t new_count) {
+		const size_t old_count = count, old_top = top, old_selected = selected;
+		count = new_count;
+		if (selected != NONE && count <= selected)
+			selected = count == 0? NONE : count - 1;
+		top = std::min(top, maxTop());
+
+		if (top != old_top || selected != old_selected || new_count < old_count) {
+			draw();
+		} else if (old_count < top + rows()) {
+			// The only rows that could have changed are the ones that used to be past the end.
+			drawRows(old_count < top? 0 : old_count - top, rows() - 1);
+		}
+	}
+
+	void ListView::setTop(size_t new_top) {
+		new_top = std::min(new_top, maxTop());
+		if (new_top == top)
+			return;
+
+		const size_t old_top = top;
+		top = new_top;
+
+		if (!canDraw())
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t distance = old_top < new_top? new_top - old_top : old_top - new_top;
+		if (rows() <= distance) {
+			draw();
+			return;
+		}
+
+		// The rows that stay on screen are moved with the scrolling region and only the newly exposed ones are drawn.
+		const int delta = old_top < new_top? -static_cast<int>(distance) : static_cast<int>(distance);
+		applyColors();
+		const bool scrolled = PaintContext(*terminal, position, this).scroll(delta);
+		terminal->resetColors();
+
+		if (!scrolled)
+			draw();
+		else if (old_top < new_top)
+			drawRows(rows() - distance, rows() - 1);
+		else
+			drawRows(0, distance - 1);
+	}
+
+	void ListView::scrollTo(size_t index) {
+		if (index == NONE || rows() == 0)
+			return;
+
+		if (index < top)
+			setTop(index);
+		else if (top + rows() <= index)
+			setTop(index - rows() + 1);
+	}
+
+	void ListView::select(size_t index) {
+		if (count == 0)
+			index = NONE;
+		else if (index != NONE)
+			index = std::min(index, count - 1);
+
+		if (index == selected)
+			return;
+
+		const size_t old_selected = selected;
+		selected = index;
+		scrollTo(selected);
+		drawItem(old_selected);
+		drawItem(selected);
+
+		if (onSelect)
+			onSelect(*this, selected);
+	}
+
+	void ListView::listen(Event event, const Listener_f &fn) {
+		if (event == Event::Select) {
+			onSelect = fn;
+		} else if (event == Event::Activate) {
+			onActivate = fn;
+		} else {
+			throw std::invalid_argument("Invalid event type: " + std::to_string(static_cast<int>(event)));
+		}
+	}
+
+	void ListView::up() {
+		if (selected == NONE)
+			select(top);
+		else if (0 < selected)
+			select(selected - 1);
+	}
+
+	void ListView::down() {
+		select(selected == NONE? top : selected + 1);
+	}
+
+	void ListView::pageUp() {
+		const size_t page = std::max<size_t>(rows(), 1);
+		select(selected == NONE? top : selected < page? 0 : selected - page);
+	}
+
+	void ListView::pageDown() {
+		select(selected == NONE? top : selected + std::max<size_t>(rows(), 1));
+	}
+
+	bool ListView::onMouse(const MouseReport &report) {
+		if (report.action == MouseAction::ScrollUp) {
+			setTop(top < 3? 0 : top - 3);
+			return true;
+		}
+
+		if (report.action == MouseAction::ScrollDown) {
+			setTop(top + 3);
+			return true;
+		}
+
+		Control::focus();
+		if (report.action == MouseAction::Down && report.button == MouseButton::Left) {
+			const size_t index = top + std::max(report.y - position.top, 0L);
+			if (index < count)
+				select(index);
+		}
+
+		return true;
+	}
+
+	bool ListView::onKey(const Key &key) {
+		if (key.mods.any())
+			return false;
+
+		switch (key.type) {
+			case KeyType::UpArrow:   up();       return true;
+			case KeyType::DownArrow: down();     return true;
+			case KeyType::PageUp:    pageUp();   return true;
+			case KeyType::PageDown:  pageDown(); return true;
+			case KeyType::Home:      select(0);  return true;
+			case KeyType::End:       select(count == 0? NONE : count - 1); return true;
+			case KeyType::Enter:
+			case KeyType::CarriageReturn:
+				if (selected != NONE && onActivate)
+					onActivate(*this, selected);
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void ListView::resize(const Position &new_pos) {
+		Control::resize(new_pos);
+		top = std::min(top, maxTop());
+	}
+
+	void ListView::draw() {
+		drawRows(0, rows() - 1);
+	}
+
+	bool ListView::canDraw() const {
+		return Control::canDraw() && !terminal->suppressOutput;
+	}
+}
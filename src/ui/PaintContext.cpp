@@ -0,0 +1,197 @@
+#include <algorithm>
+
+#include "haunted/core/Terminal.h"
+#include "haunted/ui/PaintContext.h"
+
+#include "lib/formicine/ansi.h"
+
+namespace Haunted::UI {
+	namespace {
+		/** Returns the length of the escape sequence starting at an index, or 0 if none starts there. */
+		size_t escapeLength(const std::string &text, size_t index) {
+			if (text[index] != '\e' || text.size() <= index + 1)
+				return 0;
+			if (text[index + 1] != '[')
+				return 2;
+			size_t end = index + 2;
+			while (end < text.size() && (text[end] < 0x40 || 0x7e < text[end]))
+				++end;
+			return std::min(end + 1, text.size()) - index;
+		}
+
+		/** Returns the visible characters of a string in a span of columns along with every SGR sequence outside the
+		 *  span, so that the span is drawn with the attributes it has in the full string and leaves the attributes as
+		 *  the full string would. Cutting a highlighted row at an overlay would otherwise lose the highlight in later
+		 *  spans or leak it past the end of the row. */
+		std::string clip(const std::string &text, size_t start, size_t count) {
+			std::string out;
+			size_t column = 0;
+			for (size_t i = 0; i < text.size();) {
+				const bool inside = start <= column && column < start + count;
+				if (const size_t length = escapeLength(text, i)) {
+					if (inside || text[i + length - 1] == 'm')
+						out.append(text, i, length);
+					i += length;
+					continue;
+				}
+
+				// Continuation bytes of a UTF-8 sequence stay with the character they belong to.
+				size_t end = i + 1;
+				while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xc0) == 0x80)
+					++end;
+				if (inside)
+					out.append(text, i, end - i);
+				i = end;
+				++column;
+			}
+
+			return out;
+		}
+	}
+
+	PaintContext::PaintContext(Terminal &terminal_, const Position &position_, const Control *owner):
+	terminal(terminal_), position(position_) {
+		if (owner && terminal.hasOverlays())
+			covers = terminal.getCovers(owner, position);
+	}
+
+
+// Private instance methods
+
+
+	std::vector<std::pair<int, int>> PaintContext::visibleRuns(int y, int x, int length) const {
+		std::vector<std::pair<int, int>> runs {{x, length}}, remaining;
+		const int row = position.top + y;
+		for (const Position &cover: covers) {
+			if (row < cover.top || cover.bottom() < row)
+				continue;
+
+			const int cover_left = cover.left - position.left, cover_end = cover_left + cover.width;
+			remaining.clear();
+			for (const auto &[start, count]: runs) {
+				const int end = start + count;
+				if (end <= cover_left || cover_end <= start) {
+					remaining.emplace_back(start, count);
+					continue;
+				}
+
+				if (start < cover_left)
+					remaining.emplace_back(start, cover_left - start);
+				if (cover_end < end)
+					remaining.emplace_back(cover_end, end - cover_end);
+			}
+
+			runs.swap(remaining);
+		}
+
+		return runs;
+	}
+
+
+// Public instance methods
+
+
+	bool PaintContext::atLeft() const {
+		return position.left == 0;
+	}
+
+	bool PaintContext::atRight() const {
+		return position.left + position.width == terminal.getCols();
+	}
+
+	void PaintContext::write(int x, int y, const std::string &text) {
+		if (text.empty() || x < 0 || position.width <= x || y < 0 || position.height <= y)
+			return;
+
+		const size_t available = position.width - x;
+		if (!covers.empty()) {
+			const int length = std::min(ansi::length(text), available);
+			for (const auto &[start, count]: visibleRuns(y, x, length)) {
+				terminal.jump(position.left + start, position.top + y);
+				terminal << clip(text, start - x, count);
+			}
+			return;
+		}
+
+		terminal.jump(position.left + x, position.top + y);
+		if (ansi::length(text) <= available)
+			terminal << text;
+		else
+			terminal << clip(text, 0, available);
+	}
+
+	void PaintContext::clearRow(int y, int x) {
+		if (x < 0 || position.width <= x || y < 0 || position.height <= y)
+			return;
+
+		if (!covers.empty()) {
+			for (const auto &[start, count]: visibleRuns(y, x, position.width - x)) {
+				terminal.jump(position.left + start, position.top + y);
+				terminal << std::string(count, ' ');
+			}
+			return;
+		}
+
+		terminal.jump(position.left + x, position.top + y);
+		if (atRight())
+			terminal.clearRight();
+		else
+			terminal << std::string(position.width - x, ' ');
+	}
+
+	void PaintContext::clear() {
+		if (!covers.empty()) {
+			for (int y = 0; y < position.height; ++y)
+				clearRow(y);
+		} else if (atLeft() && atRight()) {
+			// If the rectangle is as wide as the screen, its contents can be scrolled away with vertical margins alone.
+			terminal.vmargins(position.top, position.bottom());
+			terminal.vscroll(position.height);
+			terminal.vmargins();
+		} else if (atLeft()) {
+			for (int y = 0; y < position.height; ++y) {
+				terminal.jump(position.right(), position.top + y);
+				terminal.clearLeft();
+			}
+		} else if (atRight()) {
+			for (int y = 0; y < position.height; ++y) {
+				terminal.jump(position.left, position.top + y);
+				terminal.clearRight();
+			}
+		} else {
+			// If we're at neither edge, we have to print a total of width*height spaces. Very sad.
+			const std::string spaces(position.width, ' ');
+			for (int y = 0; y < position.height; ++y) {
+				terminal.jump(position.left, position.top + y);
+				terminal << spaces;
+			}
+		}
+	}
+
+	bool PaintContext::scroll(int rows) {
+		if (rows == 0)
+			return true;
+
+		// Scrolling would drag the overlays' cells along with the rectangle's contents.
+		if (!covers.empty())
+			return false;
+
+		const bool full_width = atLeft() && atRight();
+		if (!full_width && !terminal.hmarginsSupported)
+			return false;
+
+		if (full_width) {
+			terminal.vmargins(position.top, position.bottom());
+			terminal.vscroll(rows);
+			terminal.vmargins();
+		} else {
+			terminal.enableHmargins();
+			terminal.margins(position.top, position.bottom(), position.left, position.right());
+			terminal.vscroll(rows);
+			terminal.margins();
+			terminal.disableHmargins();
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "haunted/core/Terminal.h"
+#include "haunted/ui/PaintContext.h"
+#include "haunted/ui/Table.h"
+
+#include "lib/formicine/ansi.h"
+
+namespace Haunted::UI {
+	namespace {
+		/** Cuts off or pads text to a given width. */
+		std::string fitText(std::string text, size_t width) {
+			const size_t length = ansi::length(text);
+			if (length < width)
+				text.append(width - length, ' ');
+			else if (width < length)
+				text = ansi::substr(text, 0, width);
+			return text;
+		}
+	}
+
+	Table::Table(Container *parent_, const Position &pos_, const std::vector<Column> &columns_, size_t rows_,
+	const Accessor_f &accessor_): Control(parent_, pos_), rowCount(rows_), accessor(accessor_) {
+		if (parent_)
+			parent_->addChild(this);
+		setColumns(columns_);
+	}
+
+
+// Private instance methods
+
+
+	size_t Table::bodyRows() const {
+		return std::max(position.height - 1, 0);
+	}
+
+	size_t Table::maxTop() const {
+		const size_t visible = getVisibleCount();
+		return bodyRows() < visible? visible - bodyRows() : 0;
+	}
+
+	bool Table::before(size_t left, size_t right) const {
+		const std::string &left_key = sortKeys[left], &right_key = sortKeys[right];
+		if (left_key != right_key)
+			return ascending? left_key < right_key : right_key < left_key;
+		return left < right;
+	}
+
+	void Table::layout() {
+		offsets.assign(columns.size(), -1);
+		int x = 0;
+		for (size_t column = firstColumn; column < columns.size() && x < position.width; ++column) {
+			offsets[column] = x;
+			x += widths[column] + 1;
+		}
+	}
+
+	bool Table::fit(size_t column, size_t length) {
+		const Column &info = columns[column];
+		if (0 <= info.width)
+			return false;
+
+		int width = static_cast<int>(length);
+		if (0 <= info.maximum)
+			width = std::min(width, info.maximum);
+
+		if (width <= widths[column])
+			return false;
+
+		widths[column] = width;
+		return true;
+	}
+
+	void Table::rebuild() {
+		identity = !filter && sortColumn == NONE;
+		order.clear();
+		sortKeys.clear();
+
+		if (!identity) {
+			for (size_t row = 0; row < rowCount; ++row)
+				if (!filter || filter(row))
+					order.push_back(row);
+
+			if (sortColumn != NONE) {
+				// Keys are only needed for the rows that are shown; the others get theirs if they start passing.
+				sortKeys.resize(rowCount);
+				for (const size_t row: order)
+					sortKeys[row] = accessor(row, sortColumn);
+				std::sort(order.begin(), order.end(), [this](size_t left, size_t right) {
+					return before(left, right);
+				});
+			}
+		}
+
+		top = std::min(top, maxTop());
+	}
+
+	size_t Table::viewRow(size_t row) const {
+		if (rowCount <= row)
+			return NONE;
+
+		if (identity)
+			return row;
+
+		auto iter = sortColumn == NONE? std::lower_bound(order.begin(), order.end(), row) :
+			std::lower_bound(order.begin(), order.end(), row, [this](size_t left, size_t right) {
+				return before(left, right);
+			});
+		return iter != order.end() && *iter == row? iter - order.begin() : NONE;
+	}
+
+	int Table::screenRow(size_t index) const {
+		if (index == NONE || index < top || bodyRows() <= index - top)
+			return -1;
+		return static_cast<int>(index - top) + 1;
+	}
+
+	void Table::drawHeader() {
+		std::string line;
+		for (size_t column = firstColumn; column < columns.size() && offsets[column] != -1; ++column) {
+			if (column != firstColumn)
+				line += ' ';
+			line += fitText(columns[column].header, widths[column]);
+		}
+
+		PaintContext(*terminal, position, this).write(0, 0, "\e[1m" + fitText(line, position.width) + "\e[22m");
+	}
+
+	void Table::drawRows(size_t first, size_t last) {
+		if (!canDraw() || position.width <= 0 || bodyRows() == 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		last = std::min(last, bodyRows() - 1);
+
+		// Every line is formatted before anything is printed, in case a fitted column has to grow to fit a new cell.
+		std::vector<std::string> lines;
+		lines.reserve(last - first + 1);
+		bool grew = false;
+		const size_t visible = getVisibleCount();
+
+		for (size_t row = first; row <= last; ++row) {
+			std::string line;
+			if (top + row < visible) {
+				const size_t source = sourceRow(top + row);
+				for (size_t column = firstColumn; column < columns.size() && offsets[column] != -1; ++column) {
+					const std::string text = accessor? accessor(source, column) : "";
+					grew = fit(column, ansi::length(text)) || grew;
+					if (column != firstColumn)
+						line += ' ';
+					line += fitText(text, widths[column]);
+				}
+			}
+
+			lines.push_back(fitText(line, position.width));
+		}
+
+		if (grew) {
+			draw();
+			return;
+		}
+
+		PaintContext paint(*terminal, position, this);
+		applyColors();
+		for (size_t row = first; row <= last; ++row)
+			paint.write(0, row + 1, lines[row - first]);
+
+		terminal->resetColors();
+		terminal->jumpToFocused();
+		flush();
+	}
+
+	void Table::drawCell(size_t row, size_t column) {
+		if (!canDraw() || !accessor || columns.size() <= column || offsets[column] == -1)
+			return;
+
+		const int y = screenRow(viewRow(row));
+		if (y < 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		const std::string text = accessor(row, column);
+		if (fit(column, ansi::length(text))) {
+			draw();
+			return;
+		}
+
+		applyColors();
+		PaintContext(*terminal, position, this).write(offsets[column], y, fitText(text, widths[column]));
+		terminal->resetColors();
+	}
+
+	bool Table::reposition(size_t row) {
+		const size_t old_index = viewRow(row);
+		const bool shown = !filter || filter(row);
+		std::string key;
+		if (shown && sortColumn != NONE) {
+			key = accessor(row, sortColumn);
+			if (old_index != NONE && key == sortKeys[row])
+				return false;
+		} else if (shown == (old_index != NONE)) {
+			return false;
+		}
+
+		if (old_index != NONE)
+			order.erase(order.begin() + old_index);
+
+		size_t new_index = NONE;
+		if (shown) {
+			std::vector<size_t>::iterator iter;
+			if (sortColumn == NONE) {
+				iter = std::lower_bound(order.begin(), order.end(), row);
+			} else {
+				sortKeys[row] = std::move(key);
+				iter = std::lower_bound(order.begin(), order.end(), row, [this](size_t left, size_t right) {
+					return before(left, right);
+				});
+			}
+
+			new_index = iter - order.begin();
+			order.insert(iter, row);
+		}
+
+		const size_t old_top = top;
+		top = std::min(top, maxTop());
+		if (top != old_top) {
+			draw();
+			return true;
+		}
+
+		// If the row appeared or disappeared, everything after it moves; otherwise only the rows between its old and
+		// new positions do.
+		const size_t first = std::min(old_index, new_index);
+		const size_t last = old_index == NONE || new_index == NONE? top + bodyRows() : std::max(old_index, new_index);
+		if (first < top + bodyRows() && top <= last)
+			drawRows(first < top? 0 : first - top, last - top);
+		return true;
+	}
+
+
+// Public instance methods
+
+
+	void Table::setColumns(const std::vector<Column> &columns_) {
+		columns = columns_;
+		widths.clear();
+		for (const Column &column: columns)
+			widths.push_back(0 <= column.width? column.width : static_cast<int>(ansi::length(column.header)));
+
+		if (sortColumn != NONE && columns.size() <= sortColumn) {
+			sortColumn = NONE;
+			rebuild();
+		}
+
+		firstColumn = columns.empty()? 0 : std::min(firstColumn, columns.size() - 1);
+		dirty.clear();
+		layout();
+		draw();
+	}
+
+	void Table::setData(size_t rows, const Accessor_f &accessor_) {
+		rowCount = rows;
+		accessor = accessor_;
+		dirty.clear();
+		rebuild();
+		draw();
+	}
+
+	void Table::setRowCount(size_t rows) {
+		if (rows < rowCount) {
+			rowCount = rows;
+			dirty.clear();
+			rebuild();
+			draw();
+			return;
+		}
+
+		const size_t old_count = rowCount, old_visible = getVisibleCount();
+		rowCount = rows;
+		size_t lowest = old_visible;
+
+		if (!identity) {
+			// The new rows are sorted among themselves and then merged in, which avoids resorting the old ones.
+			const auto middle = static_cast<std::vector<size_t>::difference_type>(order.size());
+			for (size_t row = old_count; row < rows; ++row)
+				if (!filter || filter(row))
+					order.push_back(row);
+
+			// Rows that are filtered out still need a key slot, since a later change can make them visible.
+			if (sortColumn != NONE)
+				sortKeys.resize(rows);
+
+			if (sortColumn != NONE && order.begin() + middle != order.end()) {
+				auto less = [this](size_t left, size_t right) { return before(left, right); };
+				for (auto iter = order.begin() + middle; iter != order.end(); ++iter)
+					sortKeys[*iter] = accessor(*iter, sortColumn);
+				std::sort(order.begin() + middle, order.end(), less);
+				lowest = std::lower_bound(order.begin(), order.begin() + middle, order[middle], less) - order.begin();
+				std::inplace_merge(order.begin(), order.begin() + middle, order.end(), less);
+			}
+		}
+
+		if (lowest < getVisibleCount() && lowest < top + bodyRows())
+			drawRows(lowest < top? 0 : lowest - top, bodyRows() - 1);
+	}
+
+	void Table::updateCell(size_t row, size_t column) {
+		if (rowCount <= row || columns.size() <= column)
+			return;
+
+		// Any change could affect the filter, but only a change to the sort column can affect the order.
+		if ((filter || column == sortColumn) && reposition(row))
+			return;
+
+		if (deferred) {
+			dirty.emplace_back(row, column);
+		} else {
+			drawCell(row, column);
+			if (terminal) {
+				terminal->jumpToFocused();
+				flush();
+			}
+		}
+	}
+
+	void Table::updateRow(size_t row) {
+		if (rowCount <= row)
+			return;
+
+		if (!identity && reposition(row))
+			return;
+
+		if (deferred) {
+			for (size_t column = 0; column < columns.size(); ++column)
+				dirty.emplace_back(row, column);
+		} else if (const int y = screenRow(viewRow(row)); 0 < y) {
+			drawRows(y - 1, y - 1);
+		}
+	}
+
+	void Table::setDeferred(bool deferred_) {
+		deferred = deferred_;
+		if (!deferred)
+			drawUpdates();
+	}
+
+	void Table::drawUpdates() {
+		if (dirty.empty())
+			return;
+
+		std::sort(dirty.begin(), dirty.end());
+		dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+		std::unique_lock<std::recursive_mutex> lock;
+		if (terminal)
+			lock = terminal->lockRender();
+
+		for (const auto &[row, column]: dirty)
+			if (row < rowCount)
+				drawCell(row, column);
+		dirty.clear();
+
+		if (terminal) {
+			terminal->jumpToFocused();
+			flush();
+		}
+	}
+
+	void Table::sortBy(size_t column, bool ascending_) {
+		if (columns.size() <= column)
+			throw std::out_of_range("Invalid column: " + std::to_string(column));
+
+		sortColumn = column;
+		ascending = ascending_;
+		rebuild();
+		draw();
+	}
+
+	void Table::unsort() {
+		if (sortColumn != NONE) {
+			sortColumn = NONE;
+			rebuild();
+			draw();
+		}
+	}
+
+	void Table::setFilter(const Filter_f &filter_) {
+		filter = filter_;
+		rebuild();
+		draw();
+	}
+
+	void Table::setTop(size_t new_top) {
+		new_top = std::min(new_top, maxTop());
+		if (new_top == top)
+			return;
+
+		const size_t old_top = top;
+		top = new_top;
+
+		if (!canDraw())
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t distance = old_top < new_top? new_top - old_top : old_top - new_top;
+		if (bodyRows() <= distance) {
+			drawRows(0, bodyRows() - 1);
+			return;
+		}
+
+		// The rows below the header that stay on screen are moved with the scrolling region.
+		const int delta = old_top < new_top? -static_cast<int>(distance) : static_cast<int>(distance);
+		const Position body {position.left, position.top + 1, position.width, position.height - 1};
+		applyColors();
+		const bool scrolled = PaintContext(*terminal, body, this).scroll(delta);
+		terminal->resetColors();
+
+		if (!scrolled)
+			drawRows(0, bodyRows() - 1);
+		else if (old_top < new_top)
+			drawRows(bodyRows() - distance, bodyRows() - 1);
+		else
+			drawRows(0, distance - 1);
+	}
+
+	void Table::setFirstColumn(size_t column) {
+		column = columns.empty()? 0 : std::min(column, columns.size() - 1);
+		if (column != firstColumn) {
+			firstColumn = column;
+			layout();
+			draw();
+		}
+	}
+
+	bool Table::onMouse(const MouseReport &report) {
+		if (report.action == MouseAction::ScrollUp) {
+			setTop(top < 3? 0 : top - 3);
+		} else if (report.action == MouseAction::ScrollDown) {
+			setTop(top + 3);
+		} else {
+			Control::focus();
+		}
+
+		return true;
+	}
+
+	bool Table::onKey(const Key &key) {
+		if (key.mods.any())
+			return false;
+
+		const size_t page = std::max<size_t>(bodyRows(), 1);
+		switch (key.type) {
+			case KeyType::UpArrow:    setTop(top == 0? 0 : top - 1);          return true;
+			case KeyType::DownArrow:  setTop(top + 1);                        return true;
+			case KeyType::PageUp:     setTop(top < page? 0 : top - page);     return true;
+			case KeyType::PageDown:   setTop(top + page);                     return true;
+			case KeyType::Home:       setTop(0);                              return true;
+			case KeyType::End:        setTop(maxTop());                       return true;
+			case KeyType::LeftArrow:  setFirstColumn(firstColumn == 0? 0 : firstColumn - 1); return true;
+			case KeyType::RightArrow: setFirstColumn(firstColumn + 1);        return true;
+			default:
+				return false;
+		}
+	}
+
+	void Table::resize(const Position &new_pos) {
+		Control::resize(new_pos);
+		top = std::min(top, maxTop());
+		layout();
+	}
+
+	void Table::draw() {
+		if (!canDraw() || position.width <= 0 || position.height <= 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		layout();
+		applyColors();
+		drawHeader();
+		drawRows(0, bodyRows() - 1);
+		terminal->resetColors();
+		flush();
+	}
+
+	bool Table::canDraw() const {
+		return Control::canDraw() && !terminal->suppressOutput;
+	}
+}
@@ -0,0 +1,593 @@
+#include <algorithm>
+
+#include "haunted/core/Terminal.h"
+#include "haunted/ui/TextArea.h"
+
+namespace Haunted::UI {
+	namespace {
+		bool isContinuation(char ch) {
+			return (static_cast<unsigned char>(ch) & 0xc0) == 0x80;
+		}
+
+		size_t countCodepoints(std::string_view str) {
+			return std::count_if(str.begin(), str.end(), [](char ch) { return !isContinuation(ch); });
+		}
+
+		/** Returns the byte offset of the nth codepoint in a string, or the string's length if it's shorter. */
+		size_t codepointOffset(std::string_view str, size_t n) {
+			for (size_t i = 0; i < str.size(); ++i)
+				if (!isContinuation(str[i]) && n-- == 0)
+					return i;
+			return str.size();
+		}
+	}
+
+	TextArea::TextArea(Container *parent_, const Position &pos_, const std::string &text_):
+	Control(parent_, pos_), text(UTF8::sanitize(text_)) {
+		if (parent_)
+			parent_->addChild(this);
+	}
+
+	TextArea::TextArea(Container *parent_, const std::string &text_):
+	Control(parent_), text(UTF8::sanitize(text_)) {
+		if (parent_)
+			parent_->addChild(this);
+	}
+
+
+// Private instance methods
+
+
+	void TextArea::update() {
+		if (onUpdate)
+			onUpdate(*this);
+	}
+
+	void TextArea::submit() {
+		if (onSubmit)
+			onSubmit(*this);
+	}
+
+	size_t TextArea::wrapWidth() const {
+		return std::max(position.width, 1);
+	}
+
+	size_t TextArea::lineLength(size_t line) {
+		if (auto iter = lineLengths.find(line); iter != lineLengths.end())
+			return iter->second;
+
+		// Scrolling through a huge document shouldn't leave every line's length behind.
+		if (4096 <= lineLengths.size())
+			lineLengths.clear();
+
+		return lineLengths[line] = countCodepoints(text.line(line));
+	}
+
+	size_t TextArea::rowsOf(size_t line) {
+		return lineLength(line) / wrapWidth() + 1;
+	}
+
+	void TextArea::forgetLines(size_t first) {
+		for (auto iter = lineLengths.begin(); iter != lineLengths.end();) {
+			if (first <= iter->first)
+				iter = lineLengths.erase(iter);
+			else
+				++iter;
+		}
+	}
+
+	size_t TextArea::offsetOf(size_t line, size_t column) {
+		return text.lineStart(line) + codepointOffset(text.line(line), column);
+	}
+
+	bool TextArea::nextRow(size_t &line, size_t &row) {
+		if (row + 1 < rowsOf(line)) {
+			++row;
+			return true;
+		}
+
+		if (line + 1 < text.lineCount()) {
+			++line;
+			row = 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool TextArea::prevRow(size_t &line, size_t &row) {
+		if (0 < row) {
+			--row;
+			return true;
+		}
+
+		if (0 < line) {
+			row = rowsOf(--line) - 1;
+			return true;
+		}
+
+		return false;
+	}
+
+	size_t TextArea::screenRow(size_t line, size_t row) {
+		if (line < topLine || (line == topLine && row < topRow))
+			return 0;
+
+		const size_t height = position.height;
+		size_t current_line = topLine, current_row = topRow, screen = 0;
+		while ((current_line != line || current_row != row) && screen < height) {
+			if (!nextRow(current_line, current_row))
+				return height;
+			++screen;
+		}
+
+		return screen;
+	}
+
+	bool TextArea::scrollToCursor() {
+		bool changed = false;
+
+		// Edits can remove the lines the view was scrolled to.
+		if (text.lineCount() <= topLine) {
+			topLine = text.lineCount() - 1;
+			topRow = 0;
+			changed = true;
+		}
+
+		if (rowsOf(topLine) <= topRow) {
+			topRow = rowsOf(topLine) - 1;
+			changed = true;
+		}
+
+		const size_t row = cursorColumn / wrapWidth(), height = std::max(position.height, 1);
+
+		if (cursorLine < topLine || (cursorLine == topLine && row < topRow)) {
+			topLine = cursorLine;
+			topRow = row;
+			return true;
+		}
+
+		// Count the rows between the top and the cursor, but give up as soon as it's clear the cursor is offscreen.
+		size_t line = topLine, current_row = topRow, distance = 0;
+		while ((line != cursorLine || current_row != row) && distance < height && nextRow(line, current_row))
+			++distance;
+
+		if (distance < height)
+			return changed;
+
+		// Put the cursor on the bottom row.
+		topLine = cursorLine;
+		topRow = row;
+		for (size_t i = 1; i < height && prevRow(topLine, topRow); ++i);
+		return true;
+	}
+
+	void TextArea::drawRows(size_t first, size_t last) {
+		if (!canDraw() || position.width <= 0 || position.height <= 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t width = position.width;
+		last = std::min(last, static_cast<size_t>(position.height - 1));
+
+		size_t line = topLine, row = topRow, screen = 0;
+		bool past_end = text.lineCount() <= line;
+		for (; screen < first && !past_end; ++screen)
+			past_end = !nextRow(line, row);
+
+		applyColors();
+		std::string current;
+		size_t current_line = std::string::npos;
+
+		for (screen = first; screen <= last; ++screen) {
+			terminal->jump(position.left, position.top + screen);
+			std::string segment;
+			if (!past_end) {
+				if (current_line != line) {
+					current = text.line(line);
+					current_line = line;
+				}
+
+				const std::string_view view(current);
+				const size_t begin = codepointOffset(view, row * width);
+				segment = view.substr(begin, codepointOffset(view.substr(begin), width));
+				// Control characters would move the terminal cursor, so they're shown as spaces.
+				for (char &ch: segment)
+					if (0 <= ch && ch < 0x20)
+						ch = ' ';
+
+				past_end = !nextRow(line, row);
+			}
+
+			*terminal << segment << std::string(width - countCodepoints(segment), ' ');
+		}
+
+		terminal->resetColors();
+	}
+
+	void TextArea::drawEdit(size_t line, size_t column, bool rows_changed) {
+		if (!canDraw()) {
+			scrollToCursor();
+			return;
+		}
+
+		auto lock = terminal->lockRender();
+		if (scrollToCursor()) {
+			draw();
+			return;
+		}
+
+		const size_t height = position.height, row = column / wrapWidth(), first = screenRow(line, row);
+		if (first < height)
+			drawRows(first, rows_changed? height - 1 : first + rowsOf(line) - 1 - row);
+
+		jumpCursor();
+		flush();
+	}
+
+	void TextArea::insertText(const std::string &bytes, size_t codepoints) {
+		if (bytes.empty())
+			return;
+
+		const size_t line = cursorLine, column = cursorColumn, old_rows = rowsOf(line);
+		text.insert(offsetOf(line, column), bytes);
+
+		const size_t feeds = std::count(bytes.begin(), bytes.end(), '\n');
+		if (feeds == 0) {
+			if (auto iter = lineLengths.find(line); iter != lineLengths.end())
+				iter->second += codepoints;
+			cursorColumn += codepoints;
+		} else {
+			forgetLines(line);
+			cursorLine += feeds;
+			cursorColumn = countCodepoints(std::string_view(bytes).substr(bytes.rfind('\n') + 1));
+		}
+
+		preferredColumn = cursorColumn % wrapWidth();
+		drawEdit(line, column, feeds != 0 || rowsOf(line) != old_rows);
+		update();
+	}
+
+	void TextArea::eraseRange(size_t first_line, size_t first_column, size_t last_line, size_t last_column) {
+		const size_t start = offsetOf(first_line, first_column);
+		text.erase(start, offsetOf(last_line, last_column) - start);
+
+		if (first_line != last_line) {
+			forgetLines(first_line);
+		} else if (auto iter = lineLengths.find(first_line); iter != lineLengths.end()) {
+			iter->second -= last_column - first_column;
+		}
+	}
+
+	void TextArea::setCursor(size_t line, size_t column, bool keep_preferred) {
+		if (line == cursorLine && column == cursorColumn)
+			return;
+
+		cursorLine = line;
+		cursorColumn = column;
+		if (!keep_preferred)
+			preferredColumn = column % wrapWidth();
+
+		if (scrollToCursor())
+			draw();
+
+		update();
+	}
+
+
+// Public instance methods
+
+
+	void TextArea::listen(Event event, const Update_f &fn) {
+		if (event == Event::Update) {
+			onUpdate = fn;
+		} else if (event == Event::Submit) {
+			onSubmit = fn;
+		} else {
+			throw std::invalid_argument("Invalid event type: " + std::to_string(static_cast<int>(event)));
+		}
+	}
+
+	void TextArea::moveTo(size_t line, size_t column) {
+		line = std::min(line, text.lineCount() - 1);
+		setCursor(line, std::min(column, lineLength(line)));
+		tryJump();
+	}
+
+	void TextArea::insert(const std::string &str) {
+		const std::string clean = UTF8::sanitize(str);
+		insertText(clean, countCodepoints(clean));
+	}
+
+	void TextArea::insert(unsigned char ch) {
+		if (ch < 0x20 && ch != '\t' && ch != '\n' && ch != '\r') {
+			DBG("Ignoring " << static_cast<int>(ch) << ".");
+			return;
+		}
+
+		char32_t decoded[2];
+		const int count = decoder.feed(ch, decoded);
+		for (int i = 0; i < count; ++i) {
+			if (decoded[i] == '\r' || decoded[i] == '\n') {
+				newline();
+			} else {
+				std::string bytes;
+				UTF8::encode(decoded[i], bytes);
+				insertText(bytes, 1);
+			}
+		}
+	}
+
+	void TextArea::newline() {
+		insertText("\n", 1);
+	}
+
+	void TextArea::clear() {
+		setText("");
+	}
+
+	void TextArea::setText(const std::string &str) {
+		text.assign(UTF8::sanitize(str));
+		lineLengths.clear();
+		cursorLine = text.lineCount() - 1;
+		cursorColumn = lineLength(cursorLine);
+		preferredColumn = cursorColumn % wrapWidth();
+		topLine = topRow = 0;
+		draw();
+		update();
+	}
+
+	void TextArea::erase() {
+		if (0 < cursorColumn) {
+			const size_t old_rows = rowsOf(cursorLine);
+			eraseRange(cursorLine, cursorColumn - 1, cursorLine, cursorColumn);
+			--cursorColumn;
+			preferredColumn = cursorColumn % wrapWidth();
+			drawEdit(cursorLine, cursorColumn, rowsOf(cursorLine) != old_rows);
+		} else if (0 < cursorLine) {
+			const size_t previous_length = lineLength(cursorLine - 1);
+			eraseRange(cursorLine - 1, previous_length, cursorLine, 0);
+			--cursorLine;
+			cursorColumn = previous_length;
+			preferredColumn = cursorColumn % wrapWidth();
+			drawEdit(cursorLine, cursorColumn, true);
+		} else {
+			return;
+		}
+
+		update();
+	}
+
+	void TextArea::eraseForward() {
+		if (cursorColumn < lineLength(cursorLine)) {
+			const size_t old_rows = rowsOf(cursorLine);
+			eraseRange(cursorLine, cursorColumn, cursorLine, cursorColumn + 1);
+			drawEdit(cursorLine, cursorColumn, rowsOf(cursorLine) != old_rows);
+		} else if (cursorLine + 1 < text.lineCount()) {
+			eraseRange(cursorLine, cursorColumn, cursorLine + 1, 0);
+			drawEdit(cursorLine, cursorColumn, true);
+		} else {
+			return;
+		}
+
+		update();
+	}
+
+	void TextArea::eraseWord() {
+		if (cursorColumn == 0) {
+			erase();
+			return;
+		}
+
+		const std::u32string line = UTF8::decode32(text.line(cursorLine));
+		size_t column = cursorColumn;
+		for (; 0 < column && line[column - 1] == ' '; --column);
+		for (; 0 < column && line[column - 1] != ' '; --column);
+
+		const size_t old_rows = rowsOf(cursorLine);
+		eraseRange(cursorLine, column, cursorLine, cursorColumn);
+		cursorColumn = column;
+		preferredColumn = column % wrapWidth();
+		drawEdit(cursorLine, column, rowsOf(cursorLine) != old_rows);
+		update();
+	}
+
+	void TextArea::left() {
+		if (0 < cursorColumn)
+			setCursor(cursorLine, cursorColumn - 1);
+		else if (0 < cursorLine)
+			setCursor(cursorLine - 1, lineLength(cursorLine - 1));
+	}
+
+	void TextArea::right() {
+		if (cursorColumn < lineLength(cursorLine))
+			setCursor(cursorLine, cursorColumn + 1);
+		else if (cursorLine + 1 < text.lineCount())
+			setCursor(cursorLine + 1, 0);
+	}
+
+	void TextArea::up() {
+		size_t line = cursorLine, row = cursorColumn / wrapWidth();
+		if (prevRow(line, row))
+			setCursor(line, std::min(row * wrapWidth() + preferredColumn, lineLength(line)), true);
+	}
+
+	void TextArea::down() {
+		size_t line = cursorLine, row = cursorColumn / wrapWidth();
+		if (nextRow(line, row))
+			setCursor(line, std::min(row * wrapWidth() + preferredColumn, lineLength(line)), true);
+	}
+
+	void TextArea::pageUp() {
+		size_t line = cursorLine, row = cursorColumn / wrapWidth();
+		for (int i = 1; i < position.height && prevRow(line, row); ++i);
+		setCursor(line, std::min(row * wrapWidth() + preferredColumn, lineLength(line)), true);
+	}
+
+	void TextArea::pageDown() {
+		size_t line = cursorLine, row = cursorColumn / wrapWidth();
+		for (int i = 1; i < position.height && nextRow(line, row); ++i);
+		setCursor(line, std::min(row * wrapWidth() + preferredColumn, lineLength(line)), true);
+	}
+
+	void TextArea::start() {
+		setCursor(cursorLine, 0);
+	}
+
+	void TextArea::end() {
+		setCursor(cursorLine, lineLength(cursorLine));
+	}
+
+	void TextArea::top() {
+		setCursor(0, 0);
+	}
+
+	void TextArea::bottom() {
+		const size_t last = text.lineCount() - 1;
+		setCursor(last, lineLength(last));
+	}
+
+	void TextArea::prevWord() {
+		if (cursorColumn == 0) {
+			left();
+			return;
+		}
+
+		const std::u32string line = UTF8::decode32(text.line(cursorLine));
+		size_t column = cursorColumn;
+		for (; 0 < column && line[column - 1] == ' '; --column);
+		for (; 0 < column && line[column - 1] != ' '; --column);
+		setCursor(cursorLine, column);
+	}
+
+	void TextArea::nextWord() {
+		const std::u32string line = UTF8::decode32(text.line(cursorLine));
+		if (cursorColumn == line.size()) {
+			right();
+			return;
+		}
+
+		size_t column = cursorColumn;
+		for (; column < line.size() && line[column] == ' '; ++column);
+		for (; column < line.size() && line[column] != ' '; ++column);
+		setCursor(cursorLine, column);
+	}
+
+	bool TextArea::onMouse(const MouseReport &report) {
+		if (report.action == MouseAction::ScrollUp || report.action == MouseAction::ScrollDown) {
+			const bool up_ = report.action == MouseAction::ScrollUp;
+			for (int i = 0; i < 3 && (up_? prevRow(topLine, topRow) : nextRow(topLine, topRow)); ++i);
+			draw();
+			return true;
+		}
+
+		focus();
+		if (report.action != MouseAction::Down || report.button != MouseButton::Left)
+			return true;
+
+		size_t line = topLine, row = topRow;
+		for (long i = 0; i < report.y - position.top && nextRow(line, row); ++i);
+		const size_t x = std::max(report.x - position.left, 0L);
+		setCursor(line, std::min(row * wrapWidth() + x, lineLength(line)));
+		tryJump();
+		flush();
+		return true;
+	}
+
+	bool TextArea::onKey(const Key &key) {
+		const int type = int(key.type);
+		ModSet mods = key.mods;
+
+		switch (KeyMod(mods.to_ulong())) {
+			case KeyMod::None:
+				switch (type) {
+					case int(KeyType::RightArrow): right(); break;
+					case int(KeyType::LeftArrow):   left(); break;
+					case int(KeyType::UpArrow):       up(); break;
+					case int(KeyType::DownArrow):   down(); break;
+					case int(KeyType::PageUp):    pageUp(); break;
+					case int(KeyType::PageDown): pageDown(); break;
+					case int(KeyType::Backspace):  erase(); break;
+					case int(KeyType::Enter):    newline(); break;
+					case int(KeyType::Home):       start(); break;
+					case int(KeyType::End):          end(); break;
+					case int(KeyType::Mouse): return true;
+					case int(KeyType::Tab):
+						return false;
+					default:
+						insert(char(key));
+						return true;
+				}
+				break;
+			case KeyMod::Ctrl:
+				switch (type) {
+					case 'a':        start(); break;
+					case 'e':          end(); break;
+					case 'd': eraseForward(); break;
+					case 'h':        erase(); break;
+					case 'u':        clear(); break;
+					case 'w':    eraseWord(); break;
+					default: return false;
+				}
+				break;
+			case KeyMod::Alt:
+				switch (type) {
+					case int(KeyType::Backspace): eraseWord(); break;
+					case int(KeyType::Enter):        submit(); break;
+					case 'b': prevWord(); break;
+					case 'f': nextWord(); break;
+					case 'H': top();      break;
+					case 'F': bottom();   break;
+					default: return false;
+				}
+				break;
+			default: return false;
+		}
+
+		tryJump();
+		flush();
+		return true;
+	}
+
+	void TextArea::draw() {
+		if (!canDraw())
+			return;
+
+		auto lock = terminal->lockRender();
+		Colored::draw();
+		scrollToCursor();
+		drawRows(0, position.height - 1);
+		terminal->jumpToFocused();
+	}
+
+	bool TextArea::canDraw() const {
+		return Control::canDraw() && !terminal->suppressOutput;
+	}
+
+	void TextArea::focus() {
+		Control::focus();
+		Colored::focus();
+		jumpCursor();
+	}
+
+	void TextArea::jumpCursor() {
+		if (!terminal)
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t width = wrapWidth(), row = screenRow(cursorLine, cursorColumn / width);
+		if (row < static_cast<size_t>(position.height))
+			terminal->jump(position.left + cursorColumn % width, position.top + row);
+	}
+
+	void TextArea::jumpFocus() {
+		jumpCursor();
+	}
+
+	bool TextArea::tryJump() {
+		if (!terminal || !hasFocus())
+			return false;
+		jumpCursor();
+		return true;
+	}
+}
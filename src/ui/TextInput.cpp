@@ -2,6 +2,7 @@
 #include <stdexcept>
 
 #include "haunted/core/Terminal.h"
+#include "haunted/ui/PaintContext.h"
 #include "haunted/ui/TextInput.h"
 #include "lib/UUtil.h"
 
@@ -30,8 +31,81 @@ namespace Haunted::UI {
 	}
 
 	void TextInput::submit() {
+		const std::string text = getText();
+		if (history)
+			history->add(text);
+		historyID = 0;
+		historyDraft.clear();
+
 		if (onSubmit)
 			onSubmit(buffer, cursor);
+
+		// The submit listener often clears the buffer, so the waiters get the text from before it was called.
+		if (!submitWaiters.empty())
+			submitWaiters.emit(text);
+	}
+
+	void TextInput::showSearch() {
+		const uint64_t match = search->getMatch();
+		const std::string &query = search->getQuery();
+		setPrefix(std::string(match == 0 && !query.empty()? "(failed reverse-i-search)`" : "(reverse-i-search)`") +
+			query + "': ");
+		if (match != 0)
+			setText(history->at(match));
+		else if (query.empty())
+			setText(historyDraft);
+	}
+
+	bool TextInput::onSearchKey(const Key &key) {
+		const int type = int(key.type);
+
+		switch (KeyMod(key.mods.to_ulong())) {
+			case KeyMod::None:
+				switch (type) {
+					case int(KeyType::Backspace): search->pop(); break;
+					case int(KeyType::Escape): endSearch(false); return true;
+					case int(KeyType::Enter):
+						endSearch(true);
+						submit();
+						return true;
+					case int(KeyType::Tab):
+					case int(KeyType::Home):
+					case int(KeyType::End):
+					case int(KeyType::UpArrow):
+					case int(KeyType::DownArrow):
+					case int(KeyType::RightArrow):
+					case int(KeyType::LeftArrow):
+					case int(KeyType::PageUp):
+					case int(KeyType::PageDown):
+					case int(KeyType::Mouse):
+						endSearch(true);
+						return false;
+					default:
+						if (type < 0x20) {
+							endSearch(true);
+							return false;
+						}
+						search->push(std::string(1, char(key)));
+				}
+				break;
+			case KeyMod::Ctrl:
+				switch (type) {
+					case 'r': search->older(); break;
+					case 'h': search->pop(); break;
+					case 'g': endSearch(false); return true;
+					default:
+						endSearch(true);
+						return false;
+				}
+				break;
+			default:
+				endSearch(true);
+				return false;
+		}
+
+		showSearch();
+		flush();
+		return true;
 	}
 
 	void TextInput::drawCursor() {
@@ -100,16 +174,8 @@ namespace Haunted::UI {
 		if (!canDraw())
 			return;
 
-		terminal->jump(prefixLength + offset, position.top);
 		applyColors();
-		if (position.right() == terminal->getPosition().right()) {
-			// If the TextInput stretches to the right edge of the terminal, we can use clearRight.
-			terminal->outStream.clear_right();
-		} else {
-			// Horizontal margins don't work everywhere, and clearRight doesn't respect them anyway, so we have to use
-			// this unsavory hack to clear just part of the screen.
-			*terminal << std::string(position.width - (prefixLength + offset), ' ');
-		}
+		PaintContext(*terminal, position, this).clearRow(0, prefixLength + offset);
 	}
 
 	Point TextInput::findCursor() const {
@@ -138,6 +204,19 @@ namespace Haunted::UI {
 		return false;
 	}
 
+	size_t TextInput::wordStart(size_t pos, bool skip_spaces) const {
+#ifndef ENABLE_ICU
+		if (skip_spaces)
+			for (; 0 < pos && buffer[pos - 1] == ' '; --pos);
+		for (; 0 < pos && buffer[pos - 1] != ' '; --pos);
+#else
+		if (skip_spaces)
+			for (; 0 < pos && buffer[pos - 1] == " "; --pos);
+		for (; 0 < pos && buffer[pos - 1] != " "; --pos);
+#endif
+		return pos;
+	}
+
 #ifndef ENABLE_ICU
 	char TextInput::prevChar() {
 		return cursor > 0? buffer[cursor - 1]  : '\0';
@@ -148,11 +227,11 @@ namespace Haunted::UI {
 	}
 #else
 	Superchar TextInput::prevChar() {
-		return cursor > 0? buffer[cursor - 1]  : Superchar();
+		return cursor > 0? Superchar(buffer[cursor - 1]) : Superchar();
 	}
 
 	Superchar TextInput::nextChar() {
-		return cursor < size()? buffer[cursor] : Superchar();
+		return cursor < size()? Superchar(buffer[cursor]) : Superchar();
 	}
 #endif
 
@@ -182,7 +261,7 @@ namespace Haunted::UI {
 	}
 
 	void TextInput::insert(const std::string &str) {
-		TextInput::String newstr = str;
+		TextInput::String newstr = UTF8::sanitize(str);
 		buffer.insert(cursor, newstr);
 		cursor += ansi::length(newstr);
 		update();
@@ -194,74 +273,49 @@ namespace Haunted::UI {
 			return;
 		}
 
-		if (!unicodeByteBuffer.empty()) {
-			unicodeByteBuffer.push_back(ch);
-			if (unicodeByteBuffer.size() == bytesExpected) {
-				// The Unicode buffer now contains a complete and valid codepoint. (The first byte is valid, at least.)
-
-				bool do_insert = true;
-
-#ifdef ENABLE_ICU
-				// Extract the full codepoint from the buffer.
-				uint32_t uchar;
-				UErrorCode code = U_ZERO_ERROR;
-				icu::UnicodeString::fromUTF8(unicodeByteBuffer).toUTF32(reinterpret_cast<int *>(&uchar), 1, code);
-				if (0 < code)
-					throw std::runtime_error("TextInput::insert: toUTF32 returned " + std::to_string(code));
-
-
-				// If this is half a flag...
-				if (UUtil::isRegionalIndicator(uchar)) {
-					if (unicodeCodepointBuffer.empty()) {
-						// ...and it's the first half, don't insert it into the TextInput yet, but insert it into the
-						// codepoint buffer.
-						do_insert = false;
-						unicodeCodepointBuffer.push_back(uchar);
-					} else {
-						// Otherwise, if it's the second half, insert both halves into the TextInput.
-						// int uchars[] = {static_cast<int>(unicodeCodepointBuffer[0]), static_cast<int>(uchar)};
-						int uchars[] = {static_cast<int>(unicodeCodepointBuffer[0]), static_cast<int>(uchar)};
-						unicodeByteBuffer.clear();
-						icu::UnicodeString::fromUTF32(uchars, 2).toUTF8String(unicodeByteBuffer);
-						unicodeCodepointBuffer.clear();
-					}
-				}
-#endif
-
-				if (do_insert) { //-V547
-					size_t old_length = buffer.length();
-					DBG("Old length: " << old_length);
-					buffer.insert(cursor, unicodeByteBuffer);
-					DBG("New length: " << buffer.length());
-					cursor += buffer.length() - old_length;
-					DBG("Inserting character from Unicode buffer: \"" << unicodeByteBuffer << "\" (raw length: " <<
-						unicodeByteBuffer.length() << ")");
-					drawInsert();
-					update();
-				}
+		char32_t decoded[2];
+		const int count = decoder.feed(ch, decoded);
+		for (int i = 0; i < count; ++i)
+			insertCodepoint(decoded[i]);
+	}
 
-				unicodeByteBuffer.clear();
-				bytesExpected = 0;
-			}
-		} else {
-			const size_t width = UTF8::width(ch);
-			if (width < 2) {
-				// It seems we've received a plain old ASCII character or an invalid UTF8 start byte.
-				// Either way, append it to the buffer.
+	void TextInput::insertCodepoint(char32_t codepoint) {
+		if (codepoint < 0x80) {
 #ifndef ENABLE_ICU
-				buffer.insert(cursor++, 1, ch);
+			buffer.insert(cursor++, 1, static_cast<char>(codepoint));
 #else
-				buffer.insert(cursor++, ch);
+			buffer.insert(cursor++, static_cast<char16_t>(codepoint));
 #endif
-				drawInsert();
-				update();
-			} else {
-				// This byte is the first of a multi-byte codepoint.
-				// Set the expected width and initialize the Unicode buffer with the byte.
-				bytesExpected = width;
-				unicodeByteBuffer.push_back(ch);
+			drawInsert();
+			update();
+			return;
+		}
+
+		std::string bytes;
+
+#ifdef ENABLE_ICU
+		// If this is half a flag...
+		if (UUtil::isRegionalIndicator(codepoint)) {
+			if (unicodeCodepointBuffer.empty()) {
+				// ...and it's the first half, don't insert it into the TextInput yet, but insert it into the codepoint
+				// buffer.
+				unicodeCodepointBuffer.push_back(codepoint);
+				return;
 			}
+
+			// Otherwise, if it's the second half, insert both halves into the TextInput.
+			UTF8::encode(unicodeCodepointBuffer[0], bytes);
+			unicodeCodepointBuffer.clear();
 		}
+#endif
+
+		UTF8::encode(codepoint, bytes);
+		const size_t old_length = buffer.length();
+		buffer.insert(cursor, bytes);
+		cursor += buffer.length() - old_length;
+		DBG("Inserting codepoint: \"" << bytes << "\" (raw length: " << bytes.length() << ")");
+		drawInsert();
+		update();
 	}
 
 	void TextInput::clear() {
@@ -276,19 +330,9 @@ namespace Haunted::UI {
 		if (cursor == 0 || !canDraw())
 			return;
 
-		size_t to_erase = 0;
-#ifndef ENABLE_ICU
-		for (; prevChar() == ' '; --cursor)
-			to_erase++;
-		for (; prevChar() != '\0' && prevChar() != ' '; --cursor)
-			to_erase++;
-#else
-		for (; prevChar() == " "; --cursor)
-			to_erase++;
-		for (; prevChar() != "" && prevChar() != " "; --cursor)
-			to_erase++;
-#endif
-		buffer.erase(cursor, to_erase);
+		const size_t start = wordStart(cursor, true);
+		buffer.erase(start, cursor - start);
+		cursor = start;
 		checkScroll();
 		drawRight();
 		update();
@@ -411,14 +455,7 @@ namespace Haunted::UI {
 			return;
 
 		const size_t old_cursor = cursor;
-
-#ifndef ENABLE_ICU
-		for (; prevChar() == ' '; --cursor);
-		for (; prevChar() != '\0' && prevChar() != ' '; --cursor);
-#else
-		for (; prevChar() == " "; --cursor);
-		for (; !prevChar().empty() && prevChar() != " "; --cursor);
-#endif
+		cursor = wordStart(cursor, true);
 
 		if (cursor != old_cursor) {
 			if (cursor < scroll) {
@@ -456,6 +493,97 @@ namespace Haunted::UI {
 		}
 	}
 
+	void TextInput::historyUp() {
+		if (!history)
+			return;
+
+		const uint64_t id = historyID == 0? history->newest() : history->older(historyID);
+		if (id == 0)
+			return;
+
+		if (historyID == 0)
+			historyDraft = getText();
+		historyID = id;
+		setText(history->at(id));
+	}
+
+	void TextInput::historyDown() {
+		if (!history || historyID == 0)
+			return;
+
+		historyID = history->newer(historyID);
+		setText(historyID == 0? historyDraft : history->at(historyID));
+	}
+
+	void TextInput::startSearch() {
+		if (!history || search)
+			return;
+
+		if (historyID == 0)
+			historyDraft = getText();
+		search = std::make_unique<History::Search>(*history);
+		searchSavedPrefix = prefix;
+		showSearch();
+	}
+
+	void TextInput::endSearch(bool accept) {
+		if (!search)
+			return;
+
+		const uint64_t match = search->getMatch();
+		search.reset();
+		setPrefix(searchSavedPrefix);
+
+		if (accept && match != 0) {
+			historyID = match;
+		} else if (!accept) {
+			historyID = 0;
+			setText(historyDraft);
+		}
+	}
+
+	bool TextInput::complete(bool reverse) {
+		if (!completer)
+			return false;
+
+		auto suffix_at = [this](size_t start) -> const std::string & {
+			return start == 0 && !completer->startSuffix.empty()? completer->startSuffix : completer->suffix;
+		};
+
+		// If the buffer was changed some other way since the last completion, start over.
+		if (completing && (cursor < completionStart || std::string(buffer.substr(completionStart,
+		    cursor - completionStart)) != completionCurrent + suffix_at(completionStart)))
+			completing = false;
+
+		if (!completing) {
+			completionStart = wordStart(cursor, false);
+			completionPrefix = std::string(buffer.substr(completionStart, cursor - completionStart));
+			completionCurrent.clear();
+		}
+
+		const std::optional<std::string> candidate = completer->next(completionPrefix, completionCurrent, reverse);
+		if (!candidate)
+			return false;
+
+		// Replace the partial word (or the previously inserted candidate) with the new candidate.
+		buffer.erase(completionStart, cursor - completionStart);
+		const size_t old_length = buffer.length();
+		buffer.insert(completionStart, *candidate + suffix_at(completionStart));
+		cursor = completionStart + buffer.length() - old_length;
+		completionCurrent = *candidate;
+		completing = true;
+
+		const size_t twidth = textWidth();
+		if (cursor < scroll)
+			scroll = cursor;
+		else if (twidth < cursor - scroll)
+			scroll = cursor - twidth;
+
+		draw();
+		update();
+		return true;
+	}
+
 	void TextInput::transpose() {
 		const size_t len = length();
 		// If there aren't at least two characters, there's nothing to transpose.
@@ -508,6 +636,13 @@ namespace Haunted::UI {
 		const int type = int(key.type);
 		ModSet mods = key.mods;
 
+		if (search && onSearchKey(key))
+			return true;
+
+		// Any key other than the completion keys ends a completion cycle.
+		const bool was_completing = completing;
+		completing = false;
+
 		switch (KeyMod(mods.to_ulong())) {
 			case KeyMod::None:
 				switch (type) {
@@ -517,13 +652,25 @@ namespace Haunted::UI {
 					case int(KeyType::Enter):      submit(); break;
 					case int(KeyType::Home):        start(); break;
 					case int(KeyType::End):           end(); break;
-					case int(KeyType::DownArrow):
 					case int(KeyType::UpArrow):
+						if (!history)
+							return false;
+						historyUp();
+						break;
+					case int(KeyType::DownArrow):
+						if (!history)
+							return false;
+						historyDown();
+						break;
 					case int(KeyType::PageDown):
 					case int(KeyType::PageUp): return false;
 					case int(KeyType::Mouse):  return true;
 					case int(KeyType::Tab):
-						return false;
+						if (!completer)
+							return false;
+						completing = was_completing;
+						complete();
+						break;
 					default:
 						insert(char(key));
 						if (checkScroll())
@@ -531,11 +678,22 @@ namespace Haunted::UI {
 						return true;
 				}
 				break;
+			case KeyMod::Shift:
+				if (type != int(KeyType::Tab) || !completer)
+					return false;
+				completing = was_completing;
+				complete(true);
+				break;
 			case KeyMod::Ctrl:
 				switch (type) {
 					case 'a':     start(); break;
 					case 'e':       end(); break;
 					case 'h':     erase(); break;
+					case 'r':
+						if (!history)
+							return false;
+						startSearch();
+						break;
 					case 't': transpose(); break;
 					case 'u':     clear(); break;
 					case 'w': eraseWord(); break;
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "haunted/core/Terminal.h"
+#include "haunted/ui/PaintContext.h"
+#include "haunted/ui/TreeView.h"
+
+#include "lib/formicine/ansi.h"
+
+namespace Haunted::UI {
+	TreeView::TreeView(Container *parent_, const Position &pos_, const Provider_f &provider_):
+	Control(parent_, pos_) {
+		setProvider(provider_);
+		if (parent_)
+			parent_->addChild(this);
+	}
+
+
+// Private instance methods
+
+
+	size_t TreeView::rows() const {
+		return std::max(position.height, 0);
+	}
+
+	size_t TreeView::maxTop() const {
+		return rows() < getRowCount()? getRowCount() - rows() : 0;
+	}
+
+	const TreeView::Node & TreeView::at(size_t id) const {
+		if (id == ROOT || nodes.size() <= id)
+			throw std::out_of_range("Invalid node ID: " + std::to_string(id));
+		return nodes[id];
+	}
+
+	void TreeView::load(size_t id) {
+		std::vector<Item> items;
+		if (provider)
+			items = provider(id);
+
+		// The vector of nodes may be reallocated below, so the parent isn't kept as a reference.
+		const size_t depth = id == ROOT? 0 : nodes[id].depth + 1;
+		std::vector<size_t> children;
+		children.reserve(items.size());
+		for (Item &item: items) {
+			children.push_back(nodes.size());
+			Node &node = nodes.emplace_back();
+			node.text = std::move(item.text);
+			node.data = item.data;
+			node.expandable = item.expandable;
+			node.parent = id;
+			node.index = children.size() - 1;
+			node.depth = depth;
+		}
+
+		Node &node = nodes[id];
+		node.children = std::move(children);
+		node.childRows.assign(std::vector<size_t>(node.children.size(), 1));
+		node.loaded = true;
+	}
+
+	void TreeView::propagate(size_t id, ptrdiff_t delta) {
+		for (; id != ROOT; id = nodes[id].parent) {
+			Node &parent_node = nodes[nodes[id].parent];
+			parent_node.childRows.add(nodes[id].index, delta);
+			if (!parent_node.expanded)
+				return;
+			parent_node.rows += delta;
+		}
+	}
+
+	size_t TreeView::next(size_t id) const {
+		if (nodes[id].expanded && !nodes[id].children.empty())
+			return nodes[id].children.front();
+
+		for (; id != ROOT; id = nodes[id].parent) {
+			const Node &parent_node = nodes[nodes[id].parent];
+			if (nodes[id].index + 1 < parent_node.children.size())
+				return parent_node.children[nodes[id].index + 1];
+		}
+
+		return NONE;
+	}
+
+	std::string TreeView::rowText(size_t id) const {
+		const size_t width = std::max(position.width, 0);
+		if (id == NONE)
+			return std::string(width, ' ');
+
+		const Node &node = nodes[id];
+		std::string text = std::string(2 * node.depth, ' ') + (!node.expandable? "  " : node.expanded? "- " : "+ ")
+			+ node.text;
+		const size_t length = ansi::length(text);
+		if (length < width)
+			text.append(width - length, ' ');
+		else if (width < length)
+			text = ansi::substr(text, 0, width);
+
+		return id == selected? "\e[7m" + text + "\e[27m" : text;
+	}
+
+	void TreeView::drawRows(size_t first, size_t last) {
+		if (!canDraw() || position.width <= 0 || position.height <= 0)
+			return;
+
+		auto lock = terminal->lockRender();
+		last = std::min(last, rows() - 1);
+
+		PaintContext paint(*terminal, position, this);
+		applyColors();
+		// Only the first row has to be looked up; the rest follow it in display order.
+		size_t id = nodeAt(top + first);
+		for (size_t row = first; row <= last; ++row) {
+			paint.write(0, row, rowText(id));
+			if (id != NONE)
+				id = next(id);
+		}
+
+		terminal->resetColors();
+		terminal->jumpToFocused();
+		flush();
+	}
+
+	void TreeView::drawNode(size_t id) {
+		if (id == NONE)
+			return;
+
+		const size_t row = rowOf(id);
+		if (row != NONE && top <= row && row - top < rows())
+			drawRows(row - top, row - top);
+	}
+
+	void TreeView::shift(size_t row, ptrdiff_t delta) {
+		const size_t distance = delta < 0? -delta : delta;
+
+		if (row < top) {
+			// Keep the visible rows where they are unless the top row was among the ones just hidden.
+			if (delta < 0 && top <= row + distance) {
+				top = row;
+				draw();
+			} else {
+				top += delta;
+			}
+			return;
+		}
+
+		if (maxTop() < top) {
+			top = maxTop();
+			draw();
+			return;
+		}
+
+		if (top + rows() <= row || !canDraw())
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t screen_row = row - top, below = rows() - screen_row - 1;
+		drawRows(screen_row, screen_row);
+		if (below == 0)
+			return;
+
+		if (below <= distance) {
+			drawRows(screen_row + 1, rows() - 1);
+			return;
+		}
+
+		// Rows below the node that stay on screen are moved with the scrolling region instead of being redrawn.
+		const Position region {position.left, position.top + static_cast<int>(screen_row) + 1, position.width,
+			static_cast<int>(below)};
+		applyColors();
+		const bool scrolled = PaintContext(*terminal, region, this).scroll(static_cast<int>(delta));
+		terminal->resetColors();
+
+		if (!scrolled)
+			drawRows(screen_row + 1, rows() - 1);
+		else if (0 < delta)
+			drawRows(screen_row + 1, screen_row + distance);
+		else
+			drawRows(rows() - distance, rows() - 1);
+	}
+
+
+// Public instance methods
+
+
+	void TreeView::setProvider(const Provider_f &provider_) {
+		provider = provider_;
+		nodes.clear();
+		nodes.emplace_back();
+		load(ROOT);
+
+		Node &root = nodes.front();
+		root.expanded = true;
+		root.expandable = true;
+		root.rows = root.children.size();
+		top = 0;
+		selected = NONE;
+		draw();
+	}
+
+	void TreeView::expand(size_t id) {
+		at(id);
+		if (!nodes[id].expandable || nodes[id].expanded)
+			return;
+
+		if (!nodes[id].loaded)
+			load(id);
+
+		Node &node = nodes[id];
+		node.expanded = true;
+		const ptrdiff_t delta = node.childRows.total();
+		node.rows += delta;
+		const size_t row = rowOf(id);
+		propagate(id, delta);
+		if (row != NONE)
+			shift(row, delta);
+	}
+
+	void TreeView::collapse(size_t id) {
+		at(id);
+		if (!nodes[id].expanded)
+			return;
+
+		const size_t row = rowOf(id);
+		Node &node = nodes[id];
+		const ptrdiff_t delta = -static_cast<ptrdiff_t>(node.childRows.total());
+		node.expanded = false;
+		node.rows = 1;
+		propagate(id, delta);
+
+		if (selected != NONE) {
+			for (size_t ancestor = nodes[selected].parent; ancestor != ROOT; ancestor = nodes[ancestor].parent) {
+				if (ancestor == id) {
+					// The old selection is no longer on screen, so there's nothing to clear.
+					selected = id;
+					if (onSelect)
+						onSelect(*this, selected);
+					break;
+				}
+			}
+		}
+
+		if (row != NONE)
+			shift(row, delta);
+	}
+
+	void TreeView::toggle(size_t id) {
+		if (isExpanded(id))
+			collapse(id);
+		else
+			expand(id);
+	}
+
+	const std::vector<size_t> & TreeView::getChildren(size_t id) const {
+		return id == ROOT? nodes.front().children : at(id).children;
+	}
+
+	size_t TreeView::nodeAt(size_t row) const {
+		if (getRowCount() <= row)
+			return NONE;
+
+		for (size_t id = ROOT;;) {
+			const Node &node = nodes[id];
+			const size_t index = node.childRows.find(row);
+			id = node.children[index];
+			row -= node.childRows.prefix(index);
+			if (row == 0)
+				return id;
+			// Skip the child's own row to descend into its children.
+			--row;
+		}
+	}
+
+	size_t TreeView::rowOf(size_t id) const {
+		at(id);
+		size_t row = 0;
+		for (; id != ROOT; id = nodes[id].parent) {
+			const Node &parent_node = nodes[nodes[id].parent];
+			if (!parent_node.expanded)
+				return NONE;
+			row += parent_node.childRows.prefix(nodes[id].index);
+			if (nodes[id].parent != ROOT)
+				++row;
+		}
+
+		return row;
+	}
+
+	void TreeView::setTop(size_t new_top) {
+		new_top = std::min(new_top, maxTop());
+		if (new_top == top)
+			return;
+
+		const size_t old_top = top;
+		top = new_top;
+
+		if (!canDraw())
+			return;
+
+		auto lock = terminal->lockRender();
+		const size_t distance = old_top < new_top? new_top - old_top : old_top - new_top;
+		if (rows() <= distance) {
+			draw();
+			return;
+		}
+
+		const int delta = old_top < new_top? -static_cast<int>(distance) : static_cast<int>(distance);
+		applyColors();
+		const bool scrolled = PaintContext(*terminal, position, this).scroll(delta);
+		terminal->resetColors();
+
+		if (!scrolled)
+			draw();
+		else if (old_top < new_top)
+			drawRows(rows() - distance, rows() - 1);
+		else
+			drawRows(0, distance - 1);
+	}
+
+	void TreeView::scrollTo(size_t id) {
+		if (id == NONE || rows() == 0)
+			return;
+
+		const size_t row = rowOf(id);
+		if (row == NONE)
+			return;
+
+		if (row < top)
+			setTop(row);
+		else if (top + rows() <= row)
+			setTop(row - rows() + 1);
+	}
+
+	void TreeView::select(size_t id) {
+		while (id != NONE && rowOf(id) == NONE) {
+			// Expand the outermost collapsed ancestor first so that each expansion is drawn in place.
+			size_t outermost = NONE;
+			for (size_t ancestor = nodes[id].parent; ancestor != ROOT; ancestor = nodes[ancestor].parent)
+				if (!nodes[ancestor].expanded)
+					outermost = ancestor;
+			expand(outermost);
+		}
+
+		if (id == selected)
+			return;
+
+		const size_t old_selected = selected;
+		selected = id;
+		scrollTo(selected);
+		drawNode(old_selected);
+		drawNode(selected);
+
+		if (onSelect)
+			onSelect(*this, selected);
+	}
+
+	void TreeView::listen(Event event, const Listener_f &fn) {
+		if (event == Event::Select) {
+			onSelect = fn;
+		} else if (event == Event::Activate) {
+			onActivate = fn;
+		} else {
+			throw std::invalid_argument("Invalid event type: " + std::to_string(static_cast<int>(event)));
+		}
+	}
+
+	bool TreeView::onMouse(const MouseReport &report) {
+		if (report.action == MouseAction::ScrollUp) {
+			setTop(top < 3? 0 : top - 3);
+			return true;
+		}
+
+		if (report.action == MouseAction::ScrollDown) {
+			setTop(top + 3);
+			return true;
+		}
+
+		Control::focus();
+		if (report.action == MouseAction::Down && report.button == MouseButton::Left) {
+			const size_t id = nodeAt(top + std::max(report.y - position.top, 0L));
+			if (id != NONE) {
+				select(id);
+				// Clicking on the marker toggles the node as well.
+				const long marker = position.left + 2 * static_cast<long>(nodes[id].depth);
+				if (nodes[id].expandable && marker <= report.x && report.x < marker + 2)
+					toggle(id);
+			}
+		}
+
+		return true;
+	}
+
+	bool TreeView::onKey(const Key &key) {
+		if (key.mods.any())
+			return false;
+
+		const size_t row = selected == NONE? NONE : rowOf(selected);
+		const size_t page = std::max<size_t>(rows(), 1);
+
+		switch (key.type) {
+			case KeyType::UpArrow:
+				select(row == NONE? nodeAt(top) : 0 < row? nodeAt(row - 1) : selected);
+				return true;
+			case KeyType::DownArrow:
+				if (row == NONE)
+					select(nodeAt(top));
+				else if (row + 1 < getRowCount())
+					select(nodeAt(row + 1));
+				return true;
+			case KeyType::PageUp:
+				select(nodeAt(row == NONE? top : row < page? 0 : row - page));
+				return true;
+			case KeyType::PageDown:
+				select(nodeAt(row == NONE? top : std::min(row + page, getRowCount() - 1)));
+				return true;
+			case KeyType::Home:
+				select(nodeAt(0));
+				return true;
+			case KeyType::End:
+				select(getRowCount() == 0? NONE : nodeAt(getRowCount() - 1));
+				return true;
+			case KeyType::RightArrow:
+				if (selected != NONE) {
+					if (!nodes[selected].expanded)
+						expand(selected);
+					else if (!nodes[selected].children.empty())
+						select(nodes[selected].children.front());
+				}
+				return true;
+			case KeyType::LeftArrow:
+				if (selected != NONE) {
+					if (nodes[selected].expanded)
+						collapse(selected);
+					else if (nodes[selected].parent != ROOT)
+						select(nodes[selected].parent);
+				}
+				return true;
+			case KeyType::Enter:
+			case KeyType::CarriageReturn:
+				if (selected != NONE) {
+					if (nodes[selected].expandable)
+						toggle(selected);
+					else if (onActivate)
+						onActivate(*this, selected);
+				}
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void TreeView::resize(const Position &new_pos) {
+		Control::resize(new_pos);
+		top = std::min(top, maxTop());
+	}
+
+	void TreeView::draw() {
+		drawRows(0, rows() - 1);
+	}
+
+	bool TreeView::canDraw() const {
+		return Control::canDraw() && !terminal->suppressOutput;
+	}
+}
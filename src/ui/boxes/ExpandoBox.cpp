@@ -1,4 +1,4 @@
-#include <algorithm>
+#include <stdexcept>
 
 #include "haunted/core/Terminal.h"
 #include "haunted/ui/boxes/ExpandoBox.h"
@@ -6,7 +6,7 @@
 namespace Haunted::UI::Boxes {
 	template <>
 	std::pair<Control *&, int &> ExpandoBox::iterator::operator*() const {
-		return {*child_iterator, *size_iterator};
+		return {*child_iterator, size_iterator->size};
 	}
 
 	template <>
@@ -19,7 +19,7 @@ namespace Haunted::UI::Boxes {
 	template <>
 	ExpandoBox::iterator ExpandoBox::iterator::operator++(int) {
 		std::deque<Control *>::iterator new_child_iterator(child_iterator);
-		std::deque<int>::iterator new_size_iterator(size_iterator);
+		std::vector<Flex::Item>::iterator new_size_iterator(size_iterator);
 		return {++new_child_iterator, ++new_size_iterator};
 	}
 
@@ -42,86 +42,61 @@ namespace Haunted::UI::Boxes {
 			p.first->setParent(this);
 			p.first->setTerminal(terminal);
 			children.push_back(p.first);
-			sizes.push_back(p.second);
+			items.push_back({p.second});
 		}
 	}
 
 
-	int ExpandoBox::fixedSum() const {
-		int sum = 0;
-		for (const int size: sizes) {
-			if (size > 0)
-				sum += size;
-		}
+// Private instance methods
+
 
-		return sum;
+	Position ExpandoBox::childPosition(int offset, int size) const {
+		if (orientation == BoxOrientation::Horizontal)
+			return {position.left + offset, position.top, size, position.height};
+		return {position.left, position.top + offset, position.width, size};
 	}
 
-	int ExpandoBox::expandedSize(int order) const {
-		if (children.empty())
-			return 0;
+	void ExpandoBox::layout() {
+		// Children added through Container::addChild expand.
+		if (items.size() < children.size())
+			items.resize(children.size());
 
-		const int sum = fixedSum();
-		const int length = getSize();
+		Flex::layout(items, getSize(), lengths);
+	}
 
-		// If the fixed-size children fill the ExpandoBox or even overflow it,
-		// there's no room for the expanding children.
-		if (length <= sum)
-			return 0;
+	void ExpandoBox::relayout() {
+		std::unique_lock<std::recursive_mutex> lock;
+		if (terminal)
+			lock = terminal->lockRender();
 
-		int expanding_count = 0;
-		for (const int size: sizes) {
-			if (size == -1)
-				++expanding_count;
-		}
-		
-		if (expanding_count == 0)
-			return 0;
-		
-		const int quotient  = (length - sum) / expanding_count;
-		const int remainder = (length - sum) % expanding_count;
+		layout();
 
-		return quotient + (order < remainder? 1 : 0);
-	}
+		int offset = 0;
+		for (size_t i = 0, max = children.size(); i < max; ++i) {
+			const Position child_position = childPosition(offset, lengths[i]);
+			offset += lengths[i];
 
-	void ExpandoBox::resizeChild(Control *child, int offset, int size) {
-		if (orientation == BoxOrientation::Horizontal) {
-			child->resize({position.left + offset, position.top, size, position.height});
-		} else {
-			child->resize({position.left, position.top + offset, position.width, size});
+			Control *child = children[i];
+			if (child->getPosition() != child_position) {
+				child->resize(child_position);
+				child->draw();
+			}
 		}
 	}
 
+
+// Public instance methods
+
+
 	void ExpandoBox::resize(const Position &new_pos) {
 		Control::resize(new_pos);
-		const int size = getSize();
-
-		// Number of times an expanding child has been resized.
-		int expanded = 0;
+		layout();
 
-		// The amount of space that has been allocated to children so far.
 		int offset = 0;
-
 		for (size_t i = 0, max = children.size(); i < max; ++i) {
-		// for (const child_pair p: *this) {
-			// control *child = p.first;
-			Control *child = children[i];
-			const int child_size = sizes.size() <= i? -1 : sizes[i];
-			// const int child_size = p.second;
-			// DBG("child: " << child << ", size: " << child_size);
-
-			if (offset >= size) {
-				// If there's no space left, assign the child a size of zero and place it at the far edge.
-				DBG("Resizing " << child->getID() << " with offset " << getSize() << " and size " << 0 << " (no space left)");
-				resizeChild(child, getSize(), 0);
-			} else {
-				const int assigned = child_size == -1? expandedSize(expanded++) : std::min(child_size, size - offset);
-				resizeChild(child, offset, assigned);
-				offset += assigned;
-			}
+			children[i]->resize(childPosition(offset, lengths[i]));
+			offset += lengths[i];
 		}
-
-		redraw();
 	}
 
 	void ExpandoBox::draw() {
@@ -141,17 +116,15 @@ namespace Haunted::UI::Boxes {
 			if (*iter == child) {
 				DBG("Found child " << child->getID());
 				size_t index = iter - children.begin();
-				Position pos = child->getPosition();
-				if (orientation == BoxOrientation::Vertical) {
-					sizes[index] = height;
-					pos.height = height;
-				} else {
-					sizes[index] = width;
-					pos.width = width;
+				if (items.size() <= index)
+					items.resize(index + 1);
+
+				const int size = orientation == BoxOrientation::Vertical? height : width;
+				if (items[index].size != size) {
+					items[index].size = size;
+					relayout();
 				}
-				child->resize(pos);
-				DBG("new child position: " << pos);
-				resize();
+
 				return true;
 			}
 
@@ -159,25 +132,16 @@ namespace Haunted::UI::Boxes {
 	}
 
 	bool ExpandoBox::addChild(Control *control) {
-		const bool success = Container::addChild(control);
-		if (success) {
-			if (sizes.size() < children.size()) {
-				sizes.push_back(orientation == BoxOrientation::Vertical?
-					control->getPosition().height : control->getPosition().width);
-			} else {
-				sizes[children.size() - 1] = orientation == BoxOrientation::Vertical?
-					control->getPosition().height : control->getPosition().width;
-			}
-		}
-
-		return success;
+		return addChild(control, orientation == BoxOrientation::Vertical?
+			control->getPosition().height : control->getPosition().width);
 	}
 
 	bool ExpandoBox::removeChild(Child *control) {
 		for (size_t i = 0, max = children.size(); i < max; ++i) {
 			if (children[i] == control) {
 				children.erase(std::next(children.begin(), i));
-				sizes.erase(std::next(sizes.begin(), i));
+				if (i < items.size())
+					items.erase(std::next(items.begin(), i));
 				return true;
 			}
 		}
@@ -186,28 +150,57 @@ namespace Haunted::UI::Boxes {
 	}
 
 	bool ExpandoBox::addChild(Control *control, int size) {
+		return addChild(control, Flex::Item {size});
+	}
+
+	bool ExpandoBox::addChild(Control *control, const Flex::Item &item) {
 		const bool success = Container::addChild(control);
 		if (success) {
-			if (sizes.size() < children.size())
-				sizes.push_back(size);
-			else
-				sizes[children.size() - 1] = size;
+			items.resize(children.size() - 1);
+			items.push_back(item);
 		}
 
 		return success;
 	}
 
+	const Flex::Item & ExpandoBox::getItem(Control *child) const {
+		for (size_t i = 0, max = children.size(); i < max; ++i) {
+			if (children[i] == child) {
+				if (items.size() <= i)
+					break;
+				return items[i];
+			}
+		}
+
+		throw std::out_of_range("Control isn't a laid-out child of the ExpandoBox");
+	}
+
+	bool ExpandoBox::setItem(Control *child, const Flex::Item &item) {
+		for (size_t i = 0, max = children.size(); i < max; ++i) {
+			if (children[i] == child) {
+				if (items.size() <= i)
+					items.resize(i + 1);
+				items[i] = item;
+				relayout();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	ExpandoBox & ExpandoBox::operator+=(const ExpandoBox::ChildPair &p) {
+		items.resize(children.size());
 		children.push_back(p.first);
-		sizes.push_back(p.second);
+		items.push_back({p.second});
 		return *this;
 	}
 
 	ExpandoBox::iterator ExpandoBox::begin() {
-		return {children.begin(), sizes.begin()};
+		return {children.begin(), items.begin()};
 	}
 
 	ExpandoBox::iterator ExpandoBox::end() {
-		return {children.end(), sizes.end()};
+		return {children.end(), items.end()};
 	}
 }
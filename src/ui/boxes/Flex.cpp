@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+
+#include "haunted/ui/boxes/Flex.h"
+
+namespace Haunted::UI::Boxes {
+	namespace {
+		/** Clamps a size to an item's limits. If the minimum exceeds the maximum, the minimum wins. */
+		template <typename T>
+		T clamp(T size, const Flex::Item &item) {
+			if (0 <= item.maximum && item.maximum < size)
+				size = item.maximum;
+			return std::max(size, static_cast<T>(item.minimum));
+		}
+	}
+
+
+// Private static methods
+
+
+	double Flex::level(const std::vector<Item> &items, double available, bool constrained) {
+		if (!constrained) {
+			double weights = 0;
+			for (const Item &item: items)
+				if (item.expands() && 0 < item.weight)
+					weights += item.weight;
+			return weights <= 0? 0 : available / weights;
+		}
+
+		// The combined size is constant + slope * level between consecutive breakpoints. An item contributes its minimum
+		// until the level reaches minimum / weight, then weight * level until the level reaches maximum / weight, and
+		// then its maximum.
+		struct Breakpoint {
+			double level, slope, constant;
+			bool operator<(const Breakpoint &other) const { return level < other.level; }
+		};
+
+		std::vector<Breakpoint> breakpoints;
+		double constant = 0, slope = 0;
+
+		for (const Item &item: items) {
+			if (!item.expands())
+				continue;
+
+			const double minimum = item.minimum;
+			constant += minimum;
+			if (item.weight <= 0 || (0 <= item.maximum && item.maximum <= item.minimum))
+				continue;
+
+			breakpoints.push_back({minimum / item.weight, item.weight, -minimum});
+			if (0 <= item.maximum)
+				breakpoints.push_back({item.maximum / item.weight, -item.weight, static_cast<double>(item.maximum)});
+		}
+
+		if (available <= constant)
+			return 0;
+
+		std::sort(breakpoints.begin(), breakpoints.end());
+
+		for (const Breakpoint &breakpoint: breakpoints) {
+			if (0 < slope && available <= constant + slope * breakpoint.level)
+				return (available - constant) / slope;
+			slope += breakpoint.slope;
+			constant += breakpoint.constant;
+		}
+
+		if (0 < slope)
+			return (available - constant) / slope;
+
+		// Every expanding item is at its maximum and there's still space left over.
+		return breakpoints.empty()? 0 : breakpoints.back().level;
+	}
+
+
+// Public static methods
+
+
+	void Flex::layout(const std::vector<Item> &items, int length, std::vector<int> &out) {
+		out.resize(items.size());
+		length = std::max(length, 0);
+
+		int fixed = 0;
+		bool constrained = false;
+		for (const Item &item: items) {
+			if (!item.expands())
+				fixed += clamp(item.size, item);
+			else if (0 < item.minimum || 0 <= item.maximum)
+				constrained = true;
+		}
+
+		const double lvl = level(items, std::max(length - fixed, 0), constrained);
+
+		// The expanding items' shares are rounded by taking the ceiling of their running total, so each share is off
+		// by less than one cell and the rounded shares add up to the rounded total.
+		double total = 0;
+		int rounded = 0, offset = 0;
+
+		for (size_t i = 0, max = items.size(); i < max; ++i) {
+			const Item &item = items[i];
+			int size;
+
+			if (item.expands()) {
+				total += clamp(0 < item.weight? item.weight * lvl : 0.0, item);
+				const int next = static_cast<int>(std::ceil(total - 1e-9 * std::max(total, 1.0)));
+				size = next - rounded;
+				rounded = next;
+			} else {
+				size = clamp(item.size, item);
+			}
+
+			out[i] = std::clamp(size, 0, length - offset);
+			offset += out[i];
+		}
+	}
+}
@@ -9,6 +9,7 @@ namespace Haunted::UI::Boxes {
 		if (orientation != new_orientation) {
 			orientation = new_orientation;
 			resize();
+			draw();
 		}
 	}
 }
@@ -4,49 +4,100 @@
 #include "haunted/ui/boxes/PropoBox.h"
 
 namespace Haunted::UI::Boxes {
-	PropoBox::PropoBox(Container *parent_, const Position &pos_, double ratio_, BoxOrientation orientation_):
-	DualBox(parent_, pos_, orientation_), ratio(ratio_) {
+	PropoBox::PropoBox(Container *parent_, const Position &pos_, BoxOrientation orientation_):
+	OrientedBox(parent_, pos_, orientation_) {
 		if (parent_)
 			parent_->addChild(this);
-
-		if (ratio < 0)
-			throw std::domain_error("Box ratio cannot be negative");
 	}
 
 	PropoBox::PropoBox(Container *parent_, double ratio_, BoxOrientation orientation_, Control *one, Control *two,
-	const Position &pos_): PropoBox(parent_, pos_, ratio_, orientation_) {
+	const Position &pos_): PropoBox(parent_, pos_, orientation_) {
+		if (ratio_ < 0)
+			throw std::domain_error("Box ratio cannot be negative");
+
+		weights = {ratio_, 1.0};
 		for (Control *control: {one, two}) {
-			control->setParent(this);
-			control->setTerminal(terminal);
-			children.push_back(control);
+			if (control) {
+				control->setParent(this);
+				control->setTerminal(terminal);
+				children.push_back(control);
+			}
 		}
 	}
 
+	PropoBox::PropoBox(Container *parent_, BoxOrientation orientation_, std::initializer_list<ChildPair> pairs,
+	const Position &pos_): PropoBox(parent_, pos_, orientation_) {
+		for (const ChildPair &p: pairs) {
+			if (p.second < 0)
+				throw std::domain_error("Box weight cannot be negative");
+			p.first->setParent(this);
+			p.first->setTerminal(terminal);
+			children.push_back(p.first);
+			weights.push_back(p.second);
+		}
+	}
+
+
+// Private instance methods
+
+
+	void PropoBox::layout() {
+		items.resize(children.size());
+		for (size_t i = 0, max = items.size(); i < max; ++i)
+			items[i].weight = getWeight(i);
+		Flex::layout(items, getSize(), lengths);
+	}
+
+
+// Public instance methods
+
+
+	double PropoBox::getRatio() const {
+		const double second = getWeight(1);
+		return second == 0? 0 : getWeight(0) / second;
+	}
+
 	void PropoBox::setRatio(const double ratio_) {
-		if (ratio != ratio_) {
-			ratio = ratio_;
+		if (ratio_ < 0)
+			throw std::domain_error("Box ratio cannot be negative");
+
+		if (weights.size() < 2)
+			weights.resize(2, 1.0);
+
+		if (weights[0] != ratio_ || weights[1] != 1.0) {
+			weights[0] = ratio_;
+			weights[1] = 1.0;
 			resize();
+			draw();
+		}
+	}
+
+	void PropoBox::setWeight(size_t index, double weight) {
+		if (weight < 0)
+			throw std::domain_error("Box weight cannot be negative");
+
+		if (weights.size() <= index)
+			weights.resize(index + 1, 1.0);
+
+		if (weights[index] != weight) {
+			weights[index] = weight;
+			resize();
+			draw();
 		}
 	}
 
 	void PropoBox::resize(const Position &new_pos) {
 		Control::resize(new_pos);
+		layout();
 
-		if (children.size() == 0) {
-			return;
-		} else if (children.size() == 1) {
-			children[0]->resize(new_pos);
-		} else if (children.size() == 2) {
-			if (orientation == BoxOrientation::Horizontal) {
-				children[0]->resize({position.left, position.top, sizeOne(), position.height});
-				children[1]->resize({position.left + sizeOne(), position.top, sizeTwo(), position.height});
-			} else if (orientation == BoxOrientation::Vertical) {
-				children[0]->resize({position.left, position.top, position.width, sizeOne()});
-				children[1]->resize({position.left, position.top + sizeOne(), position.width, sizeTwo()});
-			} else throw std::runtime_error("Unknown orientation: " + std::to_string(static_cast<int>(orientation)));
-		} else throw std::runtime_error("Invalid number of children for PropoBox: " + std::to_string(children.size()));
-
-		redraw();
+		int offset = 0;
+		for (size_t i = 0, max = children.size(); i < max; ++i) {
+			if (orientation == BoxOrientation::Horizontal)
+				children[i]->resize({position.left + offset, position.top, lengths[i], position.height});
+			else
+				children[i]->resize({position.left, position.top + offset, position.width, lengths[i]});
+			offset += lengths[i];
+		}
 	}
 
 	void PropoBox::draw() {
@@ -60,15 +111,41 @@ namespace Haunted::UI::Boxes {
 			child->draw();
 	}
 
-	int PropoBox::sizeOne() const {
-		return getSize() - sizeTwo();
+	bool PropoBox::addChild(Control *control) {
+		const bool success = Container::addChild(control);
+		if (success && weights.size() < children.size())
+			weights.resize(children.size(), 1.0);
+		return success;
+	}
+
+	bool PropoBox::addChild(Control *control, double weight) {
+		if (weight < 0)
+			throw std::domain_error("Box weight cannot be negative");
+
+		const bool success = Container::addChild(control);
+		if (success) {
+			if (weights.size() < children.size())
+				weights.resize(children.size(), 1.0);
+			weights[children.size() - 1] = weight;
+		}
+
+		return success;
 	}
 
-	int PropoBox::sizeTwo() const {
-		return getSize() / (1.0 + ratio);
+	bool PropoBox::removeChild(Child *control) {
+		for (size_t i = 0, max = children.size(); i < max; ++i) {
+			if (children[i] == control) {
+				if (i < weights.size())
+					weights.erase(std::next(weights.begin(), i));
+				return Container::removeChild(control);
+			}
+		}
+
+		return false;
 	}
 
-	int PropoBox::getSize() const {
-		return orientation == BoxOrientation::Horizontal? position.width : position.height;
+	int PropoBox::sizeOf(size_t index) {
+		layout();
+		return index < lengths.size()? lengths[index] : 0;
 	}
 }
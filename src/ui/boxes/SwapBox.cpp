@@ -21,6 +21,105 @@ namespace Haunted::UI::Boxes {
 		}
 	}
 
+	SwapBox::~SwapBox() {
+		if (recordTerminal)
+			recordTerminal->cancelTimer(recordTimer);
+		while (!frames.empty())
+			drop(frames.begin());
+	}
+
+
+// Private static methods
+
+
+	void SwapBox::retarget(Control *control, Terminal *from, Terminal *to) {
+		if (Container *container = control->asContainer()) {
+			for (Control *child: container->getChildren()) {
+				if (child && child->getTerminal() == from) {
+					child->setTerminal(to);
+					retarget(child, from, to);
+				}
+			}
+		}
+	}
+
+
+// Private instance methods
+
+
+	void SwapBox::hide(Control *control) {
+		if (!terminal || frameCapacity == 0) {
+			control->setTerminal(nullptr);
+			return;
+		}
+
+		std::unique_ptr<OffscreenTerminal> offscreen = std::move(spare);
+		if (!offscreen || offscreen->getSource() != terminal)
+			offscreen = std::make_unique<OffscreenTerminal>(*terminal, frameLimit);
+		else
+			offscreen->setLimit(frameLimit);
+
+		retarget(control, terminal, offscreen.get());
+		control->setTerminal(offscreen.get());
+		frames.push_front({control, std::move(offscreen)});
+		while (frameCapacity < frames.size())
+			drop(std::prev(frames.end()));
+
+		if (!terminal->isSingleThreaded()) {
+			record();
+		} else if (recordTerminal != terminal || !recordTimer) {
+			// The timer fires after the switch has been flushed, so recording doesn't delay it.
+			if (recordTerminal)
+				recordTerminal->cancelTimer(recordTimer);
+			recordTerminal = terminal;
+			recordTimer = terminal->setTimeout(TimerWheel::Clock::duration::zero(), [this] {
+				recordTimer = {};
+				recordTerminal = nullptr;
+				record();
+			});
+		}
+	}
+
+	void SwapBox::record() {
+		for (Frame &frame: frames) {
+			if (!frame.recorded) {
+				frame.offscreen->clearRecording();
+				frame.control->draw();
+				frame.recorded = true;
+			}
+		}
+	}
+
+	std::unique_ptr<OffscreenTerminal> SwapBox::release(Control *control, bool &recorded) {
+		for (auto iter = frames.begin(); iter != frames.end(); ++iter) {
+			if (iter->control == control) {
+				std::unique_ptr<OffscreenTerminal> offscreen = std::move(iter->offscreen);
+				recorded = iter->recorded;
+				frames.erase(iter);
+				return offscreen;
+			}
+		}
+
+		recorded = false;
+		return nullptr;
+	}
+
+	void SwapBox::drop(std::list<Frame>::iterator iter) {
+		retarget(iter->control, iter->offscreen.get(), terminal);
+		iter->control->setTerminal(nullptr);
+		frames.erase(iter);
+	}
+
+	void SwapBox::replay(OffscreenTerminal &offscreen) {
+		auto lock = offscreen.lockRender();
+		// Ending the recording with the default colors keeps the terminal's idea of its current colors accurate.
+		offscreen.resetColors();
+		terminal->resetColors();
+		*terminal << offscreen.getRecording();
+		terminal->jumpToFocused();
+		terminal->flush();
+	}
+
 
 // Public instance methods
 
@@ -34,32 +133,82 @@ namespace Haunted::UI::Boxes {
 		if (new_active == active)
 			return;
 
+		// The new child's frame is taken out first so that hiding the old child can't evict it.
+		bool recorded = false;
+		std::unique_ptr<OffscreenTerminal> offscreen = new_active? release(new_active, recorded) : nullptr;
+		Control *old_active = active;
+		if (old_active != nullptr)
+			hide(old_active);
+
 		if (new_active == nullptr) {
-			active->setTerminal(nullptr);
 			active = nullptr;
-
 			clearRect();
-		} else if (new_active != nullptr) {
-			if (active != nullptr) {
-				active->setTerminal(nullptr);
-				if (active->getPosition() != new_active->getPosition())
-					new_active->resize(active->getPosition());
+		} else {
+			bool fresh = offscreen && recorded && !offscreen->hasOverflowed() && offscreen->getSource() == terminal;
+
+			if (offscreen) {
+				retarget(new_active, offscreen.get(), terminal);
+				new_active->setTerminal(nullptr);
+			}
+
+			if (old_active != nullptr && old_active->getPosition() != new_active->getPosition()) {
+				new_active->resize(old_active->getPosition());
+				fresh = false;
 			}
 
 			active = new_active;
 			active->setTerminal(terminal);
 			active->setParent(this);
-			active->draw();
+
+			if (fresh)
+				replay(*offscreen);
+			else
+				active->draw();
+
+			if (offscreen)
+				spare = std::move(offscreen);
 		}
 
-		if (std::find(children.begin(), children.end(), new_active) == children.end())
+		if (new_active && std::find(children.begin(), children.end(), new_active) == children.end())
 			children.push_back(new_active);
 	}
 
+	void SwapBox::setFrameCapacity(size_t capacity) {
+		frameCapacity = capacity;
+		while (frameCapacity < frames.size())
+			drop(std::prev(frames.end()));
+		if (frameCapacity == 0)
+			spare.reset();
+	}
+
+	void SwapBox::setFrameLimit(size_t limit) {
+		frameLimit = limit;
+		for (Frame &frame: frames)
+			frame.offscreen->setLimit(limit);
+	}
+
+	bool SwapBox::hasFrame(const Control *control) const {
+		for (const Frame &frame: frames)
+			if (frame.control == control)
+				return true;
+		return false;
+	}
+
 	Control * SwapBox::childAtOffset(int x, int y) const {
 		return (x - position.left < position.width && y - position.top < position.height)? active : nullptr;
 	}
 
+	bool SwapBox::removeChild(Child *child) {
+		for (auto iter = frames.begin(); iter != frames.end(); ++iter) {
+			if (iter->control == child) {
+				drop(iter);
+				break;
+			}
+		}
+
+		return Container::removeChild(child);
+	}
+
 	void SwapBox::resize(const Position &new_pos) {
 		Control::resize(new_pos);
 		if (active)